@@ -150,6 +150,13 @@ struct autoencoder_id;
 struct updater_id;
 struct early_stopping_id;
 struct early_training_id;
+struct parallel_sgd_id;
+struct augment_threads_id;
+struct streaming_pretrain_id;
+struct compact_storage_id;
+struct async_prefetch_id;
+struct huge_pages_id;
+struct pipelined_epoch_error_id;
 
 /*!
  * \brief Sets the minibatch size
@@ -168,6 +175,19 @@ struct batch_size : value_conf_elt<batch_size_id, size_t, B> {};
 template <size_t B>
 struct big_batch_size : value_conf_elt<big_batch_size_id, size_t, B> {};
 
+/*!
+ * \brief Sets the number of threads used for data-parallel SGD.
+ *
+ * Each mini-batch is split across N worker threads, each with its own
+ * training context. The gradients are then reduced before the weights are
+ * updated. This requires the layers to keep their training state in their
+ * context (batch normalization layers cannot be trained this way).
+ *
+ * \tparam N The number of threads
+ */
+template <size_t N>
+struct parallel_sgd : value_conf_elt<parallel_sgd_id, size_t, N> {};
+
 /*!
  * \brief Sets the updater type
  * \tparam UT The updater type
@@ -343,11 +363,40 @@ struct vertical_mirroring : basic_conf_elt<vertical_mirroring_id> {};
  */
 struct categorical : basic_conf_elt<categorical_id> {};
 
+/*!
+ * \brief Store the samples of a generator as 8-bit values.
+ *
+ * The samples are converted (and pre-processed) into the batch only when
+ * the batch is used. This is only valid for data that is originally 8-bit
+ * (pixels for instance).
+ */
+struct compact_storage : basic_conf_elt<compact_storage_id> {};
+
+/*!
+ * \brief Gather the next batch of a generator in a background thread while
+ * the current batch is used.
+ *
+ * This is only used by non-augmented generators, the augmented generators
+ * already prepare their batches in the background.
+ */
+struct async_prefetch : basic_conf_elt<async_prefetch_id> {};
+
 /*!
  * \brief Use a thread for data augmentation.
  */
 struct threaded : basic_conf_elt<threaded_id> {};
 
+/*!
+ * \brief Sets the number of threads used for data augmentation.
+ *
+ * Each augmentation worker has its own random engine and the workers
+ * fill the batches of the big batch concurrently.
+ *
+ * \tparam N The number of threads
+ */
+template <size_t N>
+struct augment_threads : value_conf_elt<augment_threads_id, size_t, N> {};
+
 /*!
  * \brief Sets the elastic distortion kernel
  * \tparam K The elastic distortion kernel
@@ -439,6 +488,25 @@ struct no_bias : basic_conf_elt<no_bias_id> {};
  */
 struct batch_mode : basic_conf_elt<batch_mode_id> {};
 
+/*!
+ * \brief Compute the inputs of each layer on the fly during pretraining
+ * instead of storing the complete dataset for each layer.
+ */
+struct streaming_pretrain : basic_conf_elt<streaming_pretrain_id> {};
+
+/*!
+ * \brief Back the memory arena of the SGD trainer with transparent huge
+ * pages, when available.
+ */
+struct huge_pages : basic_conf_elt<huge_pages_id> {};
+
+/*!
+ * \brief Compute the training metrics of each epoch from the training
+ * batches and the validation metrics in the background, on a snapshot of
+ * the weights, while the next epoch is trained.
+ */
+struct pipelined_epoch_error : basic_conf_elt<pipelined_epoch_error_id> {};
+
 /*!
  * \brief Conditional shuffle (shuffle if Cond = true)
  */
@@ -245,6 +245,18 @@ void update_convolutional(RBM& rbm, Trainer& t) {
     nan_check_deep(rbm.c);
 }
 
+/*!
+ * \brief Compute the sums of the columns of the difference of two batches.
+ *
+ * \param grad The gradients to set, with one value per column
+ * \param lhs The left hand side batch
+ * \param rhs The right hand side batch
+ */
+template <typename G, typename L, typename R>
+void batch_column_diff(G& grad, const L& lhs, const R& rhs) {
+    grad = etl::bias_batch_sum_2d(lhs - rhs);
+}
+
 /* The training procedures */
 
 /*!
@@ -262,7 +274,6 @@ void compute_gradients_normal(InputBatch& input_batch, ExpectedBatch& expected_b
     cpp_assert(etl::size(t.v1) >= etl::size(input_batch), "Invalid input to compute_gradients_normal");
     cpp_assert(etl::size(t.vf) >= etl::size(expected_batch), "Invalid input to compute_gradients_normal");
 
-    const auto B          = etl::dim<0>(t.v1);
     const size_t IB       = etl::dim<0>(input_batch);
     const bool full_batch = (IB == RBM::batch_size);
 
@@ -309,15 +320,8 @@ void compute_gradients_normal(InputBatch& input_batch, ExpectedBatch& expected_b
         t.w_grad = batch_outer(t.vf, t.h1_a);
         t.w_grad -= batch_outer(t.v2_a, t.h2_a);
 
-        t.b_grad = t.h1_a(0) - t.h2_a(0);
-        for (size_t b = 1; b < B; b++) {
-            t.b_grad += t.h1_a(b) - t.h2_a(b);
-        }
-
-        t.c_grad = t.vf(0) - t.v2_a(0);
-        for (size_t b = 1; b < B; b++) {
-            t.c_grad += t.vf(b) - t.v2_a(b);
-        }
+        batch_column_diff(t.b_grad, t.h1_a, t.h2_a);
+        batch_column_diff(t.c_grad, t.vf, t.v2_a);
     }
 }
 
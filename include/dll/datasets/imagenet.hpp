@@ -8,75 +8,232 @@
 #pragma once
 
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 #include <unordered_map>
 #include <utility>
 #include <string>
+#include <fstream>
+#include <memory>
 
 #include <dirent.h>
 
 // Only for image loading...
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "dll/util/decoder.hpp"
 
 namespace dll {
 
 namespace imagenet {
 
-inline void read_files(std::vector<std::pair<size_t, size_t>>& files, std::unordered_map<size_t, float>& label_map, const std::string& file_path){
-    files.reserve(1200000);
+constexpr size_t image_size = 256; ///< The width and height of the images
 
-    struct dirent* entry;
+using image_t = etl::fast_dyn_matrix<float, 3, image_size, image_size>; ///< The type of an image
+
+/*!
+ * \brief Options of the ImageNet reader
+ */
+struct options {
+    size_t threads = 0;      ///< The number of decoding threads (0 for the hardware concurrency)
+    size_t prefetch = 0;     ///< The number of images decoded ahead (0 for the size of the generator cache)
+    std::string cache;       ///< A folder in which the decoded images are cached (empty for no cache)
+};
+
+/*!
+ * \brief Parse the number at the start of the given string
+ */
+inline size_t parse_number(const char* str) {
+    return std::strtoul(str, nullptr, 10);
+}
+
+inline void read_files(std::vector<std::pair<size_t, size_t>>& files, std::unordered_map<size_t, float>& label_map, const std::string& file_path){
     auto dir = opendir(file_path.c_str());
 
-    while ((entry = readdir(dir))) {
-        std::string file_name(entry->d_name);
+    if (!dir) {
+        std::cerr << "ERROR: Impossible to open ImageNet folder: " << file_path << std::endl;
+        return;
+    }
+
+    std::string sub_path = file_path + "/";
+    const size_t prefix = sub_path.size();
 
-        if (file_name.find("n") != 0) {
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_name[0] != 'n') {
             continue;
         }
 
-        std::string label_name(file_name.begin() + 1, file_name.end());
-        size_t label = std::atoi(label_name.c_str());
+        size_t label = parse_number(entry->d_name + 1);
 
         auto l = label_map.size();
         label_map[label] = l;
 
-        struct dirent* sub_entry;
-        auto sub_dir = opendir((file_path + "/" + file_name).c_str());
+        sub_path.resize(prefix);
+        sub_path += entry->d_name;
 
-        while ((sub_entry = readdir(sub_dir))) {
-            std::string image_name(sub_entry->d_name);
+        auto sub_dir = opendir(sub_path.c_str());
+
+        if (!sub_dir) {
+            continue;
+        }
 
-            if (image_name.find("n") != 0){
+        struct dirent* sub_entry;
+        while ((sub_entry = readdir(sub_dir))) {
+            if (sub_entry->d_name[0] != 'n') {
                 continue;
             }
 
-            std::string image_number(image_name.begin() + image_name.find('_') + 1, image_name.end() - 5);
-            size_t image = std::atoi(image_number.c_str());
+            const char* number = std::strchr(sub_entry->d_name, '_');
+
+            if (number) {
+                files.emplace_back(label, parse_number(number + 1));
+            }
+        }
+
+        closedir(sub_dir);
+    }
+
+    closedir(dir);
+}
+
+/*!
+ * \brief Return the path of the given image
+ */
+inline std::string image_path(const std::string& imagenet_path, const std::pair<size_t, size_t>& image_file) {
+    auto label = std::string("/n") + (image_file.first < 10000000 ? "0" : "") + std::to_string(image_file.first);
+
+    return imagenet_path + "/train" + label + label + "_" + std::to_string(image_file.second) + ".JPEG";
+}
+
+/*!
+ * \brief Convert an interleaved 8-bit image into a planar image.
+ *
+ * The source is traversed row by row and each channel is written
+ * contiguously in its own plane.
+ *
+ * \param mat The source image (1 or 3 channels, 256x256)
+ * \param image The planar destination image
+ */
+inline void convert_planar(const cv::Mat& mat, image_t& image) {
+    constexpr size_t plane = image_size * image_size;
+
+    float* r = image.memory_start();
+    float* g = r + plane;
+    float* b = g + plane;
+
+    if (cpp_likely(mat.channels() == 3)) {
+        for (size_t y = 0; y < image_size; ++y) {
+            const uint8_t* row = mat.ptr<uint8_t>(y);
+
+            for (size_t x = 0; x < image_size; ++x) {
+                r[y * image_size + x] = row[3 * x + 0];
+                g[y * image_size + x] = row[3 * x + 1];
+                b[y * image_size + x] = row[3 * x + 2];
+            }
+        }
+    } else {
+        for (size_t y = 0; y < image_size; ++y) {
+            const uint8_t* row = mat.ptr<uint8_t>(y);
+
+            for (size_t x = 0; x < image_size; ++x) {
+                r[y * image_size + x] = row[x];
+            }
+        }
+
+        std::fill(g, g + 2 * plane, 0.0f);
+    }
+
+    image.invalidate_gpu();
+}
+
+/*!
+ * \brief Decode the given image, using the on-disk cache if enabled
+ * \param imagenet_path The ImageNet folder
+ * \param image_file The image to decode
+ * \param opts The options of the reader
+ * \param image The output image
+ */
+inline void decode_image(const std::string& imagenet_path, const std::pair<size_t, size_t>& image_file, const options& opts, image_t& image) {
+    std::string cache_path;
+    std::vector<uint8_t> bytes(etl::size(image));
+
+    if (!opts.cache.empty()) {
+        cache_path = opts.cache + "/" + std::to_string(image_file.first) + "_" + std::to_string(image_file.second) + ".bin";
+
+        std::ifstream stream(cache_path, std::ios::binary);
 
-            files.emplace_back(label, image);
+        if (stream.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+            std::copy(bytes.begin(), bytes.end(), image.memory_start());
+            image.invalidate_gpu();
+            return;
         }
     }
+
+    auto path = image_path(imagenet_path, image_file);
+
+    auto mat = cv::imread(path.c_str(), cv::IMREAD_ANYCOLOR);
+
+    if (!mat.data || mat.empty()) {
+        std::cerr << "ERROR: Failed to read image: " << path << std::endl;
+        image = 0;
+        return;
+    }
+
+    if (mat.cols != int(image_size) || mat.rows != int(image_size)) {
+        cv::Mat resized;
+        cv::resize(mat, resized, cv::Size(image_size, image_size), 0, 0, cv::INTER_AREA);
+        mat = resized;
+    }
+
+    convert_planar(mat, image);
+
+    if (!cache_path.empty()) {
+        std::copy(image.memory_start(), image.memory_end(), bytes.begin());
+
+        std::ofstream stream(cache_path, std::ios::binary);
+        stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+}
+
+/*!
+ * \brief A pool of threads decoding the images ahead of the reader.
+ */
+using decoder = parallel_decoder<image_t>;
+
+/*!
+ * \brief Create a decoder for the given images
+ * \param imagenet_path The ImageNet folder
+ * \param files The files to decode
+ * \param opts The options of the reader
+ * \param window The number of images decoded ahead
+ */
+inline std::shared_ptr<decoder> make_decoder(const std::string& imagenet_path, std::shared_ptr<std::vector<std::pair<size_t, size_t>>> files, const options& opts, size_t window) {
+    auto decode = [imagenet_path, files, opts](size_t i, image_t& image) {
+        decode_image(imagenet_path, (*files)[i], opts, image);
+    };
+
+    return std::make_shared<decoder>(files->size(), decode, opts.threads, window);
 }
 
 struct image_iterator : std::iterator<
                                      std::input_iterator_tag,
-                                     etl::fast_dyn_matrix<float, 3, 256, 256>,
+                                     image_t,
                                      ptrdiff_t,
-                                     etl::fast_dyn_matrix<float, 3, 256, 256>*,
-                                     etl::fast_dyn_matrix<float, 3, 256, 256>&
+                                     image_t*,
+                                     image_t&
                                  > {
 
-    using value_type = etl::fast_dyn_matrix<float, 3, 256, 256>;
+    using value_type = image_t;
 
-    std::string imagenet_path;
-    std::shared_ptr<std::vector<std::pair<size_t, size_t>>> files;
-    std::shared_ptr<std::unordered_map<size_t, float>> labels;
+    std::shared_ptr<decoder> images;
 
     size_t index;
 
-    image_iterator(const std::string& imagenet_path, std::shared_ptr<std::vector<std::pair<size_t, size_t>>> files, std::shared_ptr<std::unordered_map<size_t, float>> labels, size_t index) :
-        imagenet_path(imagenet_path), files(files), labels(labels), index(index)
-    {
+    image_iterator(std::shared_ptr<decoder> images, size_t index) : images(images), index(index) {
         // Nothing else to init
     }
 
@@ -100,52 +257,7 @@ struct image_iterator : std::iterator<
     }
 
     value_type operator*() {
-        auto& image_file = (*files)[index];
-
-        auto label = std::string("/n") + (image_file.first < 10000000 ? "0" : "") + std::to_string(image_file.first);
-
-        auto image_path =
-            std::string(imagenet_path) + "/train" + label + label +
-            "_" + std::to_string(image_file.second) + ".JPEG";
-
-        auto mat = cv::imread(image_path.c_str(), cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH);
-
-        value_type image;
-
-        if (!mat.data || mat.empty()) {
-            std::cerr << "ERROR: Failed to read image: " << image_path << std::endl;
-            image = 0;
-            return image;
-        }
-
-        if (mat.cols != 256 || mat.rows != 256) {
-            std::cerr << "ERROR: Image of invalid size: " << image_path << std::endl;
-            image = 0;
-            return image;
-        }
-
-        if (cpp_likely(mat.channels() == 3)) {
-            for (size_t x = 0; x < 256; ++x) {
-                for (size_t y = 0; y < 256; ++y) {
-                    auto pixel = mat.at<cv::Vec3b>(y, x);
-
-                    image(0, x, y) = pixel.val[0];
-                    image(1, x, y) = pixel.val[1];
-                    image(2, x, y) = pixel.val[2];
-                }
-            }
-        } else {
-            for (size_t x = 0; x < 256; ++x) {
-                for (size_t y = 0; y < 256; ++y) {
-                    image(0, x, y) = mat.at<unsigned char>(y, x);
-                }
-            }
-
-            image(1) = 0;
-            image(2) = 0;
-        }
-
-        return image;
+        return images->get(index);
     }
 
     bool operator==(const image_iterator& rhs) const {
@@ -209,13 +321,19 @@ struct label_iterator : std::iterator<
 } // end of namespace imagenet
 
 /*!
- * \brief Creates a dataset around CIFAR-10
- * \param folder The folder in which the CIFAR-10 files are
+ * \brief Creates a dataset around ImageNet
+ *
+ * The images are decoded by a pool of threads, ahead of the generator.
+ *
+ * \param folder The folder in which the ImageNet files are
+ * \param opts The options of the reader
  * \param parameters The parameters of the generator
- * \return The CIFAR-10 dataset
+ * \return The ImageNet dataset
  */
 template<typename... Parameters>
-auto make_imagenet_dataset(const std::string& folder, Parameters&&... /*parameters*/){
+auto make_imagenet_dataset(const std::string& folder, const imagenet::options& opts, Parameters&&... /*parameters*/){
+    using desc = dll::outmemory_data_generator_desc<Parameters..., dll::categorical>;
+
     auto train_files = std::make_shared<std::vector<std::pair<size_t, size_t>>>();
     auto labels      = std::make_shared<std::unordered_map<size_t, float>>();
 
@@ -226,17 +344,33 @@ auto make_imagenet_dataset(const std::string& folder, Parameters&&... /*paramete
     std::default_random_engine engine(rd());
     std::shuffle(train_files->begin(), train_files->end(), engine);
 
-    // The image iterators
-    imagenet::image_iterator iit(folder, train_files, labels, 0);
-    imagenet::image_iterator iend(folder, train_files, labels, train_files->size());
+    // By default, decode as many images as the generator can hold
+    const size_t window = opts.prefetch ? opts.prefetch : desc::BigBatchSize * desc::BatchSize;
+
+    // Each generator has its own decoder since they are read independently.
+    // The decoders only start with the first read and the test generator
+    // is read rarely, so it only decodes one batch ahead.
+    auto train_images = imagenet::make_decoder(folder, train_files, opts, window);
+    auto test_images  = imagenet::make_decoder(folder, train_files, opts, desc::BatchSize);
 
     // The label iterators
     imagenet::label_iterator lit(train_files, labels, 0);
     imagenet::label_iterator lend(train_files, labels, train_files->size());
 
     return make_dataset_holder(
-        make_generator(iit, iend, lit, lend, train_files->size(), 1000, dll::outmemory_data_generator_desc<Parameters..., dll::categorical>{}),
-        make_generator(iit, iend, lit, lend, train_files->size(), 1000, dll::outmemory_data_generator_desc<Parameters..., dll::categorical>{}));
+        make_generator(imagenet::image_iterator(train_images, 0), imagenet::image_iterator(train_images, train_files->size()), lit, lend, train_files->size(), 1000, desc{}),
+        make_generator(imagenet::image_iterator(test_images, 0), imagenet::image_iterator(test_images, train_files->size()), lit, lend, train_files->size(), 1000, desc{}));
+}
+
+/*!
+ * \brief Creates a dataset around ImageNet
+ * \param folder The folder in which the ImageNet files are
+ * \param parameters The parameters of the generator
+ * \return The ImageNet dataset
+ */
+template<typename... Parameters, cpp_enable_iff(!cpp::or_u<std::is_same<std::decay_t<Parameters>, imagenet::options>::value...>::value)>
+auto make_imagenet_dataset(const std::string& folder, Parameters&&... parameters){
+    return make_imagenet_dataset(folder, imagenet::options{}, std::forward<Parameters>(parameters)...);
 }
 
 } // end of namespace dll
@@ -91,6 +91,34 @@ struct validate_weight_type {
     static constexpr bool value = validate_weight_type_impl<0, DBN, T>::value;
 };
 
+/*!
+ * \brief Indicates if a scale and shift of the outputs of the layer can be
+ * folded into its weights.
+ */
+template <typename Layer, typename Enable = void>
+struct absorbs_scale_shift : std::false_type {};
+
+template <typename Layer>
+struct absorbs_scale_shift<Layer, std::enable_if_t<Layer::absorbs_scale_shift>> : std::true_type {};
+
+/*!
+ * \brief Indicates if the layer can be folded into the previous layer
+ */
+template <typename Layer, typename Enable = void>
+struct is_foldable : std::false_type {};
+
+template <typename Layer>
+struct is_foldable<Layer, std::enable_if_t<Layer::foldable>> : std::true_type {};
+
+/*!
+ * \brief Indicates if the layer keeps track of a bias folded into it
+ */
+template <typename Layer, typename Enable = void>
+struct has_folded_bias : std::false_type {};
+
+template <typename Layer>
+struct has_folded_bias<Layer, decltype(void(std::declval<Layer&>().folded_bias))> : std::true_type {};
+
 // Compute the distance between two iterators, only if random_access
 
 template <typename Iterator>
@@ -88,6 +88,10 @@ struct dbn final {
         "batch_mode dbn does not support shuffle in layers");
     static_assert(!dbn_traits<this_type>::shuffle_pretrain() || dbn_traits<this_type>::batch_mode(),
         "shuffle_pre is only compatible with batch mode, for normal mode, use shuffle in layers");
+    // The workers of parallel_sgd only use the layers as const, the layers
+    // modifying themselves during training cannot be shared between them
+    static_assert(!(dbn_traits<this_type>::sgd_threads() > 1 && layers_t::is_stateful),
+        "parallel_sgd does not support layers with a training state (batch normalization)");
 
     template <size_t N>
     using layer_type = detail::layer_type_t<N, layers_t>; ///< The type of the layer at index Nth
@@ -355,6 +359,36 @@ public:
         });
     }
 
+    /*!
+     * \brief Fold the batch normalization layers into the previous layers,
+     * for inference.
+     *
+     * Each batch normalization layer directly following a dense or a
+     * convolutional layer without activation function is folded into the
+     * weights and biases of this layer. The folded layers are then skipped
+     * by the forward pass of the network. The network should not be trained
+     * anymore after this.
+     *
+     * \return The number of folded layers
+     */
+    size_t fold_batch_normalization() {
+        size_t folded = 0;
+
+        for_each_layer_pair([&folded](auto& layer_1, auto& layer_2) {
+            using layer_1_t = std::decay_t<decltype(layer_1)>;
+            using layer_2_t = std::decay_t<decltype(layer_2)>;
+
+            cpp::static_if<dbn_detail::absorbs_scale_shift<layer_1_t>::value && dbn_detail::is_foldable<layer_2_t>::value>([&](auto f) {
+                if (!f(layer_2).folded) {
+                    f(layer_2).fold_into(f(layer_1));
+                    ++folded;
+                }
+            });
+        });
+
+        return folded;
+    }
+
     /*!
      * \brief Store the network weights to the given file.
      * \param file The path to the file
@@ -400,6 +434,16 @@ public:
             });
         });
 
+        // The layers without bias must know if a bias has been folded into them
+        for_each_layer_pair([](auto& layer_1, auto& layer_2) {
+            using layer_1_t = std::decay_t<decltype(layer_1)>;
+            using layer_2_t = std::decay_t<decltype(layer_2)>;
+
+            cpp::static_if<dbn_detail::has_folded_bias<layer_1_t>::value && dbn_detail::is_foldable<layer_2_t>::value>([&](auto f) {
+                f(layer_1).folded_bias = layer_1_t::no_bias && f(layer_2).folded;
+            });
+        });
+
 #ifdef DLL_SVM_SUPPORT
         svm_load(*this, is);
 #endif //DLL_SVM_SUPPORT
@@ -750,10 +794,57 @@ public:
      */
     template <size_t LS, size_t L, typename Input, cpp_enable_iff((L != LS))>
     decltype(auto) test_forward_batch_impl(Input&& sample) const {
+        return test_forward_batch_skip<LS, L>(sample, cpp::bool_constant<skippable_layer<LS, L, Input>()>{});
+    }
+
+    /*
+     * \brief Return the test representation for the given input batch,
+     * forwarded through the layer L.
+     */
+    template <size_t LS, size_t L, typename Input>
+    decltype(auto) test_forward_batch_skip(Input& sample, std::false_type /*skippable*/) const {
+        decltype(auto) next = layer_get<L>().test_forward_batch(sample);
+        return test_forward_batch_impl<LS, L+1>(next);
+    }
+
+    /*
+     * \brief Return the test representation for the given input batch. The
+     * layer L is skipped if it has been folded into the previous layer.
+     */
+    template <size_t LS, size_t L, typename Input>
+    decltype(auto) test_forward_batch_skip(Input& sample, std::true_type /*skippable*/) const {
+        if (layer_get<L>().folded) {
+            // The layer would only copy its input
+            return test_forward_batch_impl<LS, L+1>(sample);
+        }
+
         decltype(auto) next = layer_get<L>().test_forward_batch(sample);
         return test_forward_batch_impl<LS, L+1>(next);
     }
 
+    /*
+     * \brief Indicates if the layer L can be skipped when it is folded into
+     * the previous layer: the next layers must give the same type of
+     * representation from its input as from its output.
+     */
+    template <size_t LS, size_t L, typename Input, cpp_enable_iff((L > 0 && dbn_detail::is_foldable<layer_type<L>>::value))>
+    static constexpr bool skippable_layer() {
+        using input_t = std::remove_reference_t<Input>;
+        using next_t  = std::remove_reference_t<decltype(std::declval<const layer_type<L>&>().test_forward_batch(std::declval<input_t&>()))>;
+
+        return std::is_same<
+            decltype(std::declval<const this_type&>().template test_forward_batch_impl<LS, L + 1>(std::declval<input_t&>())),
+            decltype(std::declval<const this_type&>().template test_forward_batch_impl<LS, L + 1>(std::declval<next_t&>()))>::value;
+    }
+
+    /*
+     * \copydoc skippable_layer
+     */
+    template <size_t LS, size_t L, typename Input, cpp_disable_if((L > 0 && dbn_detail::is_foldable<layer_type<L>>::value))>
+    static constexpr bool skippable_layer() {
+        return false;
+    }
+
     /*
      * \brief Return the test representation for the given input batch.
      *
@@ -1468,9 +1559,7 @@ public:
      */
     template <typename Samples, typename Labels>
     void evaluate(const Samples&  samples, const Labels& labels){
-        auto generator = make_generator(samples, labels, samples.size(), output_size(), categorical_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(samples.begin(), samples.end(), labels.begin(), labels.end(), output_size(), categorical_generator_t{});
 
         return evaluate(*generator);
     }
@@ -1487,9 +1576,7 @@ public:
      */
     template <typename InputIterator, typename LabelIterator>
     void evaluate(InputIterator&& iit, InputIterator&& iend, LabelIterator&& lit, LabelIterator&& lend){
-        auto generator = make_generator(iit, iend, lit, lend, std::distance(lit, lend), output_size(), categorical_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(iit, iend, lit, lend, output_size(), categorical_generator_t{});
 
         evaluate(*generator);
     }
@@ -1518,9 +1605,7 @@ public:
      */
     template <typename Samples, cpp_enable_iff(!is_generator<Samples>)>
     void evaluate_ae(const Samples&  samples){
-        auto generator = make_generator(samples, samples, samples.size(), output_size(), ae_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(samples.begin(), samples.end(), samples.begin(), samples.end(), output_size(), ae_generator_t{});
 
         return evaluate(*generator);
     }
@@ -1537,9 +1622,7 @@ public:
      */
     template <typename InputIterator>
     void evaluate_ae(InputIterator&& iit, InputIterator&& iend){
-        auto generator = make_generator(iit, iend, iit, iend, std::distance(iit, iend), output_size(), ae_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(iit, iend, iit, iend, output_size(), ae_generator_t{});
 
         evaluate(*generator);
     }
@@ -1572,9 +1655,7 @@ public:
      */
     template <typename Samples, typename Labels>
     double evaluate_error(const Samples&  samples, const Labels& labels){
-        auto generator = make_generator(samples, labels, samples.size(), output_size(), categorical_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(samples.begin(), samples.end(), labels.begin(), labels.end(), output_size(), categorical_generator_t{});
 
         return evaluate_error(*generator);
     }
@@ -1592,9 +1673,7 @@ public:
      */
     template <typename InputIterator, typename LabelIterator>
     double evaluate_error(InputIterator&& iit, InputIterator&& iend, LabelIterator&& lit, LabelIterator&& lend){
-        auto generator = make_generator(iit, iend, lit, lend, std::distance(lit, lend), output_size(), categorical_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(iit, iend, lit, lend, output_size(), categorical_generator_t{});
 
         return evaluate_error(*generator);
     }
@@ -1627,9 +1706,7 @@ public:
      */
     template <typename Samples, cpp_enable_iff(!is_generator<Samples>)>
     double evaluate_error_ae(const Samples&  samples){
-        auto generator = make_generator(samples, samples, samples.size(), output_size(), ae_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(samples.begin(), samples.end(), samples.begin(), samples.end(), output_size(), ae_generator_t{});
 
         return evaluate_error(*generator);
     }
@@ -1647,9 +1724,7 @@ public:
      */
     template <typename InputIterator>
     double evaluate_error_ae(InputIterator&& iit, InputIterator&& iend){
-        auto generator = make_generator(iit, iend, iit, iend, std::distance(iit, iend), output_size(), ae_generator_t{});
-
-        generator->set_safe();
+        auto generator = make_batch_adapter(iit, iend, iit, iend, output_size(), ae_generator_t{});
 
         return evaluate_error(*generator);
     }
@@ -2043,6 +2118,21 @@ private:
         generator.reset();
         generator.set_test();
 
+        cpp::static_if<dbn_traits<this_type>::streaming_pretrain()>([&](auto f) {
+            // Compute the inputs of the layer I + 2 on the fly
+            auto next_generator = make_forward_generator(generator, layer, next_layer);
+
+            f(this)->template pretrain_layer<I + 2>(*next_generator, watcher, max_epochs);
+        }).else_([&](auto f) {
+            f(this)->template inline_layer_pretrain_stored<I>(generator, watcher, max_epochs);
+        });
+    }
+
+    template <size_t I, typename Generator>
+    void inline_layer_pretrain_stored(Generator& generator, watcher_t& watcher, size_t max_epochs) {
+        decltype(auto) layer = layer_get<I>();
+        decltype(auto) next_layer = layer_get<I + 1>();
+
         // Need one output in order to create the generator
         auto one = prepare_one_ready_output(layer, generator.data_batch()(0));
         auto two = prepare_one_ready_output(next_layer, one);
@@ -2103,38 +2193,52 @@ private:
             generator.reset();
             generator.set_test();
 
-            // Need one output in order to create the generator
-            auto one = prepare_one_ready_output(layer, generator.data_batch()(0));
+            cpp::static_if<dbn_traits<this_type>::streaming_pretrain()>([&](auto f) {
+                // Compute the inputs of the next layer on the fly
+                auto next_generator = make_forward_generator(generator, layer);
+
+                f(this)->template pretrain_layer<I + 1>(*next_generator, watcher, max_epochs);
+            }).else_([&](auto f) {
+                f(this)->template pretrain_next_layer_stored<I>(generator, watcher, max_epochs);
+            });
+        }
+    }
 
-            // Prepare a generator to hold the data
-            auto next_generator = prepare_generator(
-                one, one,
-                generator.size(), output_size(),
-                get_rbm_ingenerator_inner_desc());
+    template <size_t I, typename Generator>
+    void pretrain_next_layer_stored(Generator& generator, watcher_t& watcher, size_t max_epochs) {
+        decltype(auto) layer = layer_get<I>();
 
-            next_generator->set_safe();
+        // Need one output in order to create the generator
+        auto one = prepare_one_ready_output(layer, generator.data_batch()(0));
 
-            // Compute the input of the next layer
-            // using batch activation
+        // Prepare a generator to hold the data
+        auto next_generator = prepare_generator(
+            one, one,
+            generator.size(), output_size(),
+            get_rbm_ingenerator_inner_desc());
 
-            size_t i = 0;
-            while(generator.has_next_batch()){
-                auto next_batch = layer.train_forward_batch(generator.data_batch());
+        next_generator->set_safe();
 
-                next_generator->set_data_batch(i, next_batch);
-                next_generator->set_label_batch(i, next_batch);
+        // Compute the input of the next layer
+        // using batch activation
 
-                i += etl::dim<0>(next_batch);
+        size_t i = 0;
+        while(generator.has_next_batch()){
+            auto next_batch = layer.train_forward_batch(generator.data_batch());
 
-                generator.next_batch();
-            }
+            next_generator->set_data_batch(i, next_batch);
+            next_generator->set_label_batch(i, next_batch);
 
-            // Release the memory if possible
-            generator.clear();
+            i += etl::dim<0>(next_batch);
 
-            //Pass the output to the next layer
-            this->template pretrain_layer<I + 1>(*next_generator, watcher, max_epochs);
+            generator.next_batch();
         }
+
+        // Release the memory if possible
+        generator.clear();
+
+        //Pass the output to the next layer
+        this->template pretrain_layer<I + 1>(*next_generator, watcher, max_epochs);
     }
 
     //Stop template recursion
@@ -2164,40 +2268,54 @@ private:
             generator.reset();
             generator.set_test();
 
-            // Need one output in order to create the generator
-            auto one_n = prepare_one_ready_output(layer, generator.data_batch()(0));
-            auto one_c = prepare_one_ready_output(layer, generator.label_batch()(0));
+            cpp::static_if<dbn_traits<this_type>::streaming_pretrain()>([&](auto f) {
+                // Compute the noisy and clean inputs of the next layer on the fly
+                auto next_generator = make_forward_generator<true>(generator, layer);
 
-            // Prepare a generator to hold the data
-            auto next_generator = prepare_generator(
-                one_n, one_c,
-                generator.size(), output_size(),
-                get_rbm_ingenerator_inner_desc());
+                f(this)->template pretrain_layer_denoising<I + 1>(*next_generator, watcher, max_epochs);
+            }).else_([&](auto f) {
+                f(this)->template pretrain_next_layer_denoising_stored<I>(generator, watcher, max_epochs);
+            });
+        }
+    }
 
-            next_generator->set_safe();
+    template <size_t I, typename Generator>
+    void pretrain_next_layer_denoising_stored(Generator& generator, watcher_t& watcher, size_t max_epochs) {
+        decltype(auto) layer = layer_get<I>();
 
-            // Compute the input of the next layer
-            // using batch activation
+        // Need one output in order to create the generator
+        auto one_n = prepare_one_ready_output(layer, generator.data_batch()(0));
+        auto one_c = prepare_one_ready_output(layer, generator.label_batch()(0));
 
-            size_t i = 0;
-            while(generator.has_next_batch()){
-                auto next_batch_n = layer.train_forward_batch(generator.data_batch());
-                auto next_batch_c = layer.train_forward_batch(generator.label_batch());
+        // Prepare a generator to hold the data
+        auto next_generator = prepare_generator(
+            one_n, one_c,
+            generator.size(), output_size(),
+            get_rbm_ingenerator_inner_desc());
 
-                next_generator->set_data_batch(i, next_batch_n);
-                next_generator->set_label_batch(i, next_batch_c);
+        next_generator->set_safe();
 
-                i += etl::dim<0>(next_batch_n);
+        // Compute the input of the next layer
+        // using batch activation
 
-                generator.next_batch();
-            }
+        size_t i = 0;
+        while(generator.has_next_batch()){
+            auto next_batch_n = layer.train_forward_batch(generator.data_batch());
+            auto next_batch_c = layer.train_forward_batch(generator.label_batch());
 
-            // Release the memory if possible
-            generator.clear();
+            next_generator->set_data_batch(i, next_batch_n);
+            next_generator->set_label_batch(i, next_batch_c);
 
-            //In the standard case, pass the output to the next layer
-            pretrain_layer_denoising<I + 1>(*next_generator, watcher, max_epochs);
+            i += etl::dim<0>(next_batch_n);
+
+            generator.next_batch();
         }
+
+        // Release the memory if possible
+        generator.clear();
+
+        //In the standard case, pass the output to the next layer
+        pretrain_layer_denoising<I + 1>(*next_generator, watcher, max_epochs);
     }
 
     //Stop template recursion
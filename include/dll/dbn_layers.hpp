@@ -65,6 +65,46 @@ struct has_shuffle_helper <Layer, std::enable_if_t<!layer_traits<Layer>::is_rbm_
 template <typename... Layers>
 struct has_shuffle_layer : cpp::or_u<has_shuffle_helper<Layers>::value...> {};
 
+/*!
+ * \brief Indicates if the layer updates an inner state during training
+ */
+template <typename Layer, typename Enable = void>
+struct is_stateful_helper : std::false_type {};
+
+/*!
+ * \brief Indicates if the layer updates an inner state during training
+ */
+template <typename Layer>
+struct is_stateful_helper<Layer, std::enable_if_t<Layer::stateful>> : std::true_type {};
+
+/*!
+ * \brief Helper traits indicate if the set contains layers updating an
+ * inner state during training
+ */
+template <typename... Layers>
+constexpr const bool is_stateful = cpp::or_u<is_stateful_helper<Layers>::value...>::value;
+
+/*!
+ * \brief Indicates if the test forward pass of the layer can run
+ * concurrently on several threads
+ */
+template <typename Layer, typename Enable = void>
+struct is_reentrant_helper : std::false_type {};
+
+/*!
+ * \brief Indicates if the test forward pass of the layer can run
+ * concurrently on several threads
+ */
+template <typename Layer>
+struct is_reentrant_helper<Layer, std::enable_if_t<Layer::reentrant>> : std::true_type {};
+
+/*!
+ * \brief Helper traits indicate if the test forward pass of all the layers
+ * of the set can run concurrently on several threads
+ */
+template <typename... Layers>
+constexpr const bool is_reentrant = cpp::and_u<is_reentrant_helper<Layers>::value...>::value;
+
 // TODO validate_layer_pair should be made more robust when
 // transform layer are present between layers
 
@@ -164,6 +204,8 @@ struct layers <false, Layers...> {
     static constexpr bool is_convolutional  = detail::is_convolutional<Layers...>;  ///< Indicates if the set contains convolutional layers
     static constexpr bool is_denoising      = detail::is_denoising<Layers...>;      ///< Indicates if the set contains denoising layers
     static constexpr bool has_shuffle_layer = detail::has_shuffle_layer<Layers...>(); ///< Indicates if the set contains shuffle layers
+    static constexpr bool is_stateful       = detail::is_stateful<Layers...>;       ///< Indicates if the set contains layers with a training state
+    static constexpr bool is_reentrant      = detail::is_reentrant<Layers...>;      ///< Indicates if the test forward pass of the set can run concurrently
 
     static_assert(size > 0, "A network must have at least 1 layer");
     static_assert(detail::are_layers_valid<Layers...>(), "The inner sizes of the layers must correspond");
@@ -185,6 +227,8 @@ struct layers <true, Layers...> {
     static constexpr bool is_convolutional  = false;                                  ///< Indicates if the set contains convolutional layers
     static constexpr bool is_denoising      = false;                                  ///< Indicates if the set contains denoising layers
     static constexpr bool has_shuffle_layer = detail::has_shuffle_layer<Layers...>(); ///< Indicates if the set contains shuffle layers
+    static constexpr bool is_stateful       = false;                                  ///< Indicates if the set contains layers with a training state
+    static constexpr bool is_reentrant      = detail::is_reentrant<Layers...>;        ///< Indicates if the test forward pass of the set can run concurrently
 
     static_assert(size > 0, "A network must have at least 1 layer");
     static_assert(detail::validate_label_layers<Layers...>::value, "The inner sizes of RBM must correspond");
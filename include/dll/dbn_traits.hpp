@@ -48,6 +48,14 @@ struct dbn_traits {
         return desc::parameters::template contains<dll::batch_mode>();
     }
 
+    /*!
+     * \brief Indicates if the DBN computes the inputs of the layers on the
+     * fly during pretraining.
+     */
+    static constexpr bool streaming_pretrain() noexcept {
+        return desc::parameters::template contains<dll::streaming_pretrain>();
+    }
+
     /*!
      * \brief Indicates if the DBN computes error on epoch.
      */
@@ -93,6 +101,27 @@ struct dbn_traits {
         return desc::parameters::template contains<serial>();
     }
 
+    /*!
+     * \brief Returns the number of threads used for data-parallel SGD
+     */
+    static constexpr size_t sgd_threads() noexcept {
+        return desc::ParallelSGD;
+    }
+
+    /*!
+     * \brief Indicates if the SGD trainer uses huge pages for its memory arena
+     */
+    static constexpr bool huge_pages() noexcept {
+        return desc::parameters::template contains<dll::huge_pages>();
+    }
+
+    /*!
+     * \brief Indicates if the epoch metrics are computed in a pipelined way
+     */
+    static constexpr bool pipelined_epoch_error() noexcept {
+        return desc::parameters::template contains<dll::pipelined_epoch_error>();
+    }
+
     /*!
      * \brief Indicates if the DBN is verbose
      */
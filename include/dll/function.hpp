@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <cmath>
+
 namespace dll {
 
 /*!
@@ -92,6 +94,138 @@ decltype(auto) f_activate(E&& expr) {
     return etl::stable_softmax(std::forward<E>(expr));
 }
 
+/*!
+ * \brief Indicates if the given activation function is computed element-wise.
+ *
+ * An element-wise activation can be fused with other element-wise
+ * operations in a single sweep over the output.
+ */
+constexpr bool is_elementwise(function f) {
+    return f != function::SOFTMAX;
+}
+
+/*!
+ * \brief Computes the activation of one value using the specified
+ * element-wise activation function
+ * \param x The input value
+ * \tparam F The activation function to use
+ * \return The activation of the value
+ */
+template <function F, typename T, cpp_enable_iff(F == function::IDENTITY || F == function::SOFTMAX)>
+T f_activate_value(T x) {
+    return x;
+}
+
+/*!
+ * \copydoc f_activate_value
+ */
+template <function F, typename T, cpp_enable_iff(F == function::SIGMOID)>
+T f_activate_value(T x) {
+    return T(1) / (T(1) + std::exp(-x));
+}
+
+/*!
+ * \copydoc f_activate_value
+ */
+template <function F, typename T, cpp_enable_iff(F == function::TANH)>
+T f_activate_value(T x) {
+    return std::tanh(x);
+}
+
+/*!
+ * \copydoc f_activate_value
+ */
+template <function F, typename T, cpp_enable_iff(F == function::RELU)>
+T f_activate_value(T x) {
+    return x > T(0) ? x : T(0);
+}
+
+/*!
+ * \brief Add the bias to a batch of 2D outputs and apply the activation
+ * function, in place.
+ *
+ * For element-wise activation functions, this is done in a single sweep
+ * over the output, while it is still hot from the previous operation.
+ * Softmax needs the whole output and is applied by ETL after the sweep.
+ *
+ * \param output The batch of output to update
+ * \param b The bias (one per output)
+ * \param bias Indicates if the bias must be added
+ * \tparam F The activation function to use
+ */
+template <function F, typename O, typename B>
+void f_bias_activate_2d(O&& output, const B& b, bool bias = true) {
+    using T = etl::value_t<std::decay_t<O>>;
+
+    const size_t N = etl::dim<0>(output);
+    const size_t M = etl::dim<1>(output);
+
+    if (bias || (is_elementwise(F) && F != function::IDENTITY)) {
+        output.ensure_cpu_up_to_date();
+        b.ensure_cpu_up_to_date();
+
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < M; ++j) {
+                const T x = bias ? T(output(i, j) + b(j)) : T(output(i, j));
+
+                output(i, j) = f_activate_value<F>(x);
+            }
+        }
+
+        output.invalidate_gpu();
+    }
+
+    if /*constexpr*/ (F == function::SOFTMAX) {
+        output = f_activate<F>(output);
+    }
+}
+
+/*!
+ * \brief Add the bias to a batch of 4D outputs and apply the activation
+ * function, in place.
+ *
+ * For element-wise activation functions, this is done in a single sweep
+ * over the output, while it is still hot from the previous operation.
+ * Softmax needs the whole output and is applied by ETL after the sweep.
+ *
+ * \param output The batch of output to update
+ * \param b The bias (one per output channel)
+ * \param bias Indicates if the bias must be added
+ * \tparam F The activation function to use
+ */
+template <function F, typename O, typename B>
+void f_bias_activate_4d(O&& output, const B& b, bool bias = true) {
+    using T = etl::value_t<std::decay_t<O>>;
+
+    const size_t N = etl::dim<0>(output);
+    const size_t K = etl::dim<1>(output);
+    const size_t H = etl::dim<2>(output);
+    const size_t W = etl::dim<3>(output);
+
+    if (bias || (is_elementwise(F) && F != function::IDENTITY)) {
+        output.ensure_cpu_up_to_date();
+        b.ensure_cpu_up_to_date();
+
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t k = 0; k < K; ++k) {
+                const T bk = bias ? T(b(k)) : T(0);
+
+                for (size_t h = 0; h < H; ++h) {
+                    for (size_t w = 0; w < W; ++w) {
+                        output(i, k, h, w) = f_activate_value<F>(T(output(i, k, h, w) + bk));
+                    }
+                }
+            }
+        }
+
+        output.invalidate_gpu();
+    }
+
+    if /*constexpr*/ (F == function::SOFTMAX) {
+        output = f_activate<F>(output);
+    }
+}
+
 /*!
  * \brief Computes the derivatives from the given output using the specified activation function
  * \param expr The input expression
@@ -58,3 +58,6 @@ static constexpr bool is_threaded = Desc::Threaded;
 
 #include "dll/generators/inmemory_data_generator.hpp"
 #include "dll/generators/outmemory_data_generator.hpp"
+#include "dll/generators/forward_generator.hpp"
+#include "dll/generators/batch_adapter.hpp"
+#include "dll/generators/mmap_data_generator.hpp"
@@ -67,8 +67,22 @@ struct random_cropper<Desc, std::enable_if_t<Desc::random_crop_x != 0 && Desc::r
      */
     template <typename O, typename T>
     void transform_first(O&& target, const T& image) {
-        const size_t y_offset = dist_y(dll::rand_engine());
-        const size_t x_offset = dist_x(dll::rand_engine());
+        transform_first(target, image, dll::rand_engine());
+    }
+
+    /*!
+     * \brief Transform an image using the given random engine.
+     *
+     * This is used as the first step for data augmentation.
+     *
+     * \param target The target output
+     * \param image The input image
+     * \param g The random engine
+     */
+    template <typename O, typename T, typename G>
+    void transform_first(O&& target, const T& image, G& g) {
+        const size_t y_offset = dist_y(g);
+        const size_t x_offset = dist_x(g);
 
         for (size_t c = 0; c < etl::dim<0>(image); ++c) {
             for (size_t y = 0; y < random_crop_y; ++y) {
@@ -137,6 +151,22 @@ struct random_cropper<Desc, std::enable_if_t<Desc::random_crop_x == 0 || Desc::r
         target = image;
     }
 
+    /*!
+     * \brief Transform an image using the given random engine.
+     *
+     * This is used as the first step for data augmentation.
+     *
+     * \param target The target output
+     * \param image The input image
+     * \param g The random engine
+     */
+    template <typename O, typename T, typename G>
+    void transform_first(O&& target, const T& image, G& g) {
+        cpp_unused(g);
+
+        target = image;
+    }
+
     /*!
      * \brief Transform an image for test.
      *
@@ -202,7 +232,17 @@ struct random_mirrorer<Desc, std::enable_if_t<Desc::HorizontalMirroring || Desc:
      */
     template <typename O>
     void transform(O&& target) {
-        auto choice = dist(dll::rand_engine());
+        transform(target, dll::rand_engine());
+    }
+
+    /*!
+     * \brief Apply the transform on the input using the given random engine
+     * \param target The input to transform
+     * \param g The random engine
+     */
+    template <typename O, typename G>
+    void transform(O&& target, G& g) {
+        auto choice = dist(g);
 
         if (horizontal && vertical && choice == 1) {
             for (size_t c = 0; c < etl::dim<0>(target); ++c) {
@@ -258,6 +298,17 @@ struct random_mirrorer<Desc, std::enable_if_t<!Desc::HorizontalMirroring && !Des
     static void transform(O&& target) {
         cpp_unused(target);
     }
+
+    /*!
+     * \brief Apply the transform on the input using the given random engine
+     * \param target The input to transform
+     * \param g The random engine
+     */
+    template <typename O, typename G>
+    static void transform(O&& target, G& g) {
+        cpp_unused(target);
+        cpp_unused(g);
+    }
 };
 
 /*!
@@ -298,8 +349,16 @@ struct random_noise<Desc, std::enable_if_t<Desc::Noise != 0>> {
      */
     template <typename O>
     void transform(O&& target) {
-        auto& g = dll::rand_engine();
+        transform(target, dll::rand_engine());
+    }
 
+    /*!
+     * \brief Apply the transform on the input using the given random engine
+     * \param target The input to transform
+     * \param g The random engine
+     */
+    template <typename O, typename G>
+    void transform(O&& target, G& g) {
         for (auto& v : target) {
             v *= dist(g) < N * 10 ? 0.0 : 1.0;
         }
@@ -336,6 +395,17 @@ struct random_noise<Desc, std::enable_if_t<Desc::Noise == 0>> {
     static void transform(O&& target) {
         cpp_unused(target);
     }
+
+    /*!
+     * \brief Apply the transform on the input using the given random engine
+     * \param target The input to transform
+     * \param g The random engine
+     */
+    template <typename O, typename G>
+    static void transform(O&& target, G& g) {
+        cpp_unused(target);
+        cpp_unused(g);
+    }
 };
 
 /*!
@@ -399,6 +469,16 @@ struct elastic_distorter<Desc, std::enable_if_t<Desc::ElasticDistortion != 0>> {
      */
     template <typename O>
     void transform(O&& target) {
+        transform(target, dll::rand_engine());
+    }
+
+    /*!
+     * \brief Apply the transform on the input using the given random engine
+     * \param target The input to transform
+     * \param g The random engine
+     */
+    template <typename O, typename G>
+    void transform(O&& target, G& g) {
         const size_t width  = etl::dim<1>(target);
         const size_t height = etl::dim<2>(target);
 
@@ -407,8 +487,8 @@ struct elastic_distorter<Desc, std::enable_if_t<Desc::ElasticDistortion != 0>> {
         etl::dyn_matrix<weight> d_x(width, height);
         etl::dyn_matrix<weight> d_y(width, height);
 
-        d_x = etl::uniform_generator(dll::rand_engine(), -1.0, 1.0);
-        d_y = etl::uniform_generator(dll::rand_engine(), -1.0, 1.0);
+        d_x = etl::uniform_generator(g, -1.0, 1.0);
+        d_y = etl::uniform_generator(g, -1.0, 1.0);
 
         // 1. Gaussian blur the displacement fields
 
@@ -515,6 +595,17 @@ struct elastic_distorter<Desc, std::enable_if_t<Desc::ElasticDistortion == 0>> {
     static void transform(O&& target) {
         cpp_unused(target);
     }
+
+    /*!
+     * \brief Apply the transform on the input using the given random engine
+     * \param target The input to transform
+     * \param g The random engine
+     */
+    template <typename O, typename G>
+    static void transform(O&& target, G& g) {
+        cpp_unused(target);
+        cpp_unused(g);
+    }
 };
 
 } //end of dll namespace
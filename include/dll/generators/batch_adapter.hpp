@@ -0,0 +1,272 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Implementation of a generator streaming the batches directly from
+ * the ranges of the caller.
+ */
+
+#pragma once
+
+#include <iterator>
+#include <limits>
+#include <memory>
+
+namespace dll {
+
+/*!
+ * \brief A lightweight generator building its batches directly from the
+ * iterators of the samples and of the labels.
+ *
+ * Contrary to the in-memory generator, the data set is never copied, only
+ * the current batch is gathered (and pre-processed) in a staging buffer
+ * that is reused for each batch. This is only meant for evaluation: there
+ * is no shuffling and no augmentation.
+ */
+template <typename Iterator, typename LIterator, typename Desc>
+struct batch_adapter {
+    using desc                 = Desc;                                                              ///< The generator descriptor
+    using weight               = etl::value_t<typename std::iterator_traits<Iterator>::value_type>; ///< The data type
+    using data_cache_helper_t  = cache_helper<Desc, Iterator>;                                      ///< The helper for the data batch
+    using label_cache_helper_t = label_cache_helper<Desc, weight, LIterator>;                       ///< The helper for the label batch
+
+    using batch_type       = typename data_cache_helper_t::cache_type;  ///< The type of the data batches
+    using label_batch_type = typename label_cache_helper_t::cache_type; ///< The type of the label batches
+
+    static constexpr bool dll_generator = true; ///< Simple flag to indicate that the class is a DLL generator
+
+    static constexpr size_t batch_size = desc::BatchSize; ///< The size of the generated batches
+
+    static constexpr size_t no_batch = std::numeric_limits<size_t>::max(); ///< Marker for an empty staging buffer
+
+    static_assert(!is_augmented<Desc>, "batch_adapter does not support augmentation");
+
+    Iterator first;   ///< The beginning of the samples
+    LIterator lfirst; ///< The beginning of the labels
+    Iterator it;      ///< The first sample of the current batch
+    LIterator lit;    ///< The first label of the current batch
+
+    const size_t n; ///< The number of samples
+
+    mutable batch_type staging_input;       ///< The staging buffer for the current input batch
+    mutable label_batch_type staging_label; ///< The staging buffer for the current label batch
+    mutable size_t staged = no_batch;       ///< The index of the batch in the staging buffers
+
+    size_t current = 0; ///< The current index
+
+    /*!
+     * \brief Construct a new batch_adapter
+     * \param first The beginning of the samples
+     * \param last The end of the samples
+     * \param lfirst The beginning of the labels
+     * \param llast The end of the labels
+     * \param n_classes The number of classes
+     */
+    batch_adapter(Iterator first, Iterator last, LIterator lfirst, LIterator llast, size_t n_classes)
+            : first(first), lfirst(lfirst), it(first), lit(lfirst), n(std::distance(first, last)) {
+        cpp_assert(size_t(std::distance(lfirst, llast)) == n, "There must be as many labels as samples");
+        cpp_unused(llast);
+
+        if (n) {
+            data_cache_helper_t::init(std::min(batch_size, n), first, staging_input);
+            label_cache_helper_t::init(std::min(batch_size, n), n_classes, lfirst, staging_label);
+        }
+    }
+
+    batch_adapter(const batch_adapter& rhs) = delete;
+    batch_adapter operator=(const batch_adapter& rhs) = delete;
+
+    /*!
+     * \brief Display a description of the generator in the given stream
+     * \param stream The stream to print to
+     * \return stream
+     */
+    std::ostream& display(std::ostream& stream) const {
+        stream << "Batch Adapter" << std::endl;
+        stream << "              Size: " << size() << std::endl;
+        stream << "           Batches: " << batches() << std::endl;
+
+        return stream;
+    }
+
+    /*!
+     * \brief Display a description of the generator in the standard output.
+     */
+    void display() const {
+        display(std::cout);
+    }
+
+    /*!
+     * \brief Nothing is stored in this generator
+     */
+    void set_safe() {}
+
+    /*!
+     * \brief Nothing is stored in this generator
+     */
+    void clear() {}
+
+    /*!
+     * brief Sets the generator in test mode
+     */
+    void set_test() {
+        // Nothing to do, there is no augmentation
+    }
+
+    /*!
+     * brief Sets the generator in train mode
+     */
+    void set_train() {
+        // Nothing to do, there is no augmentation
+    }
+
+    /*!
+     * \brief Reset the generator to the beginning
+     */
+    void reset() {
+        it      = first;
+        lit     = lfirst;
+        current = 0;
+        staged  = no_batch;
+    }
+
+    /*!
+     * \brief Return the index of the current batch in the generation
+     * \return The current batch index
+     */
+    size_t current_batch() const {
+        return current / batch_size;
+    }
+
+    /*!
+     * \brief Returns the number of elements in the generator
+     * \return The number of elements in the generator
+     */
+    size_t size() const {
+        return n;
+    }
+
+    /*!
+     * \brief Returns the augmented number of elements in the generator.
+     * \return The augmented number of elements in the generator
+     */
+    size_t augmented_size() const {
+        return n;
+    }
+
+    /*!
+     * \brief Returns the number of batches in the generator.
+     * \return The number of batches in the generator
+     */
+    size_t batches() const {
+        return size() / batch_size + (size() % batch_size == 0 ? 0 : 1);
+    }
+
+    /*!
+     * \brief Indicates if the generator has a next batch or not
+     * \return true if the generator has a next batch, false otherwise
+     */
+    bool has_next_batch() const {
+        return current < size();
+    }
+
+    /*!
+     * \brief Moves to the next batch.
+     *
+     * This should only be called if the generator has a next batch.
+     */
+    void next_batch() {
+        const size_t b = std::min(current + batch_size, size()) - current;
+
+        std::advance(it, b);
+        std::advance(lit, b);
+
+        current += b;
+    }
+
+    /*!
+     * \brief Returns the current data batch
+     * \return a a batch of data.
+     */
+    auto data_batch() const {
+        stage();
+
+        return etl::slice(staging_input, 0, std::min(current + batch_size, size()) - current);
+    }
+
+    /*!
+     * \brief Returns the current label batch
+     * \return a a batch of label.
+     */
+    auto label_batch() const {
+        stage();
+
+        return etl::slice(staging_label, 0, std::min(current + batch_size, size()) - current);
+    }
+
+    /*!
+     * \brief Returns the number of dimensions of the input.
+     * \return The number of dimensions of the input.
+     */
+    static constexpr size_t dimensions() {
+        return etl::dimensions<batch_type>() - 1;
+    }
+
+private:
+    /*!
+     * \brief Gather the current batch in the staging buffers, with the
+     * same pre-processing as the in-memory generator.
+     */
+    void stage() const {
+        if (staged == current) {
+            return;
+        }
+
+        const size_t b = std::min(current + batch_size, size()) - current;
+
+        auto sit  = it;
+        auto slit = lit;
+
+        for (size_t i = 0; i < b; ++i, ++sit, ++slit) {
+            staging_input(i) = *sit;
+
+            pre_scaler<desc>::transform(staging_input(i));
+            pre_normalizer<desc>::transform(staging_input(i));
+            pre_binarizer<desc>::transform(staging_input(i));
+
+            label_cache_helper_t::set(i, slit, staging_label);
+
+            // In case of auto-encoders, the label images also need to be transformed
+            cpp::static_if<desc::AutoEncoder>([&](auto f) {
+                pre_scaler<desc>::transform(f(staging_label)(i));
+                pre_normalizer<desc>::transform(f(staging_label)(i));
+                pre_binarizer<desc>::transform(f(staging_label)(i));
+            });
+        }
+
+        staged = current;
+    }
+};
+
+/*!
+ * \brief Make a batch adapter around the given ranges
+ * \param first The beginning of the samples
+ * \param last The end of the samples
+ * \param lfirst The beginning of the labels
+ * \param llast The end of the labels
+ * \param n_classes The number of classes
+ * \param desc The descriptor of the generator giving the batch size and the pre-processing
+ */
+template <typename Iterator, typename LIterator, typename Desc>
+auto make_batch_adapter(Iterator first, Iterator last, LIterator lfirst, LIterator llast, size_t n_classes, const Desc& desc) {
+    cpp_unused(desc);
+
+    return std::make_unique<batch_adapter<Iterator, LIterator, Desc>>(first, last, lfirst, llast, n_classes);
+}
+
+} //end of namespace dll
@@ -28,8 +28,9 @@ template <typename Desc, typename Iterator>
 struct cache_helper<Desc, Iterator, std::enable_if_t<etl::is_1d<typename std::iterator_traits<Iterator>::value_type>>> {
     using T = etl::value_t<typename std::iterator_traits<Iterator>::value_type>; ///< Input type
 
-    using cache_type     = etl::dyn_matrix<T, 2>; ///< The type of the cache
-    using big_cache_type = etl::dyn_matrix<T, 3>; ///< The type of the big cache
+    using cache_type     = etl::dyn_matrix<T, 2>;       ///< The type of the cache
+    using compact_type   = etl::dyn_matrix<uint8_t, 2>; ///< The type of the compact cache
+    using big_cache_type = etl::dyn_matrix<T, 3>;       ///< The type of the big cache
 
     static constexpr size_t batch_size     = Desc::BatchSize;    ///< The size of the generated batches
     static constexpr size_t big_batch_size = Desc::BigBatchSize; ///< The number of batches kept in cache
@@ -40,9 +41,21 @@ struct cache_helper<Desc, Iterator, std::enable_if_t<etl::is_1d<typename std::it
      * \param it An iterator to an element
      * \param cache The cache to initialize
      */
-    static void init(size_t n, const Iterator& it, cache_type& cache) {
+    template <typename Cache = cache_type>
+    static void init(size_t n, const Iterator& it, Cache& cache) {
         auto one = *it;
-        cache    = cache_type(n, etl::dim<0>(one));
+        cache    = Cache(n, etl::dim<0>(one));
+    }
+
+    /*!
+     * \brief Init a batch buffer for the samples of the given cache
+     * \param n The size of the batch buffer
+     * \param source The cache holding the samples
+     * \param cache The batch buffer to initialize
+     */
+    template <typename Cache, typename Source>
+    static void init_batch(size_t n, const Source& source, Cache& cache) {
+        cache = Cache(n, etl::dim<1>(source));
     }
 
     /*!
@@ -63,8 +76,9 @@ template <typename Desc, typename Iterator>
 struct cache_helper<Desc, Iterator, std::enable_if_t<etl::is_3d<typename std::iterator_traits<Iterator>::value_type>>> {
     using T = etl::value_t<typename std::iterator_traits<Iterator>::value_type>; ///< Input type
 
-    using cache_type     = etl::dyn_matrix<T, 4>; ///< The type of the cache
-    using big_cache_type = etl::dyn_matrix<T, 5>; ///< The type of the big cache
+    using cache_type     = etl::dyn_matrix<T, 4>;       ///< The type of the cache
+    using compact_type   = etl::dyn_matrix<uint8_t, 4>; ///< The type of the compact cache
+    using big_cache_type = etl::dyn_matrix<T, 5>;       ///< The type of the big cache
 
     static constexpr size_t batch_size     = Desc::BatchSize;    ///< The size of the generated batches
     static constexpr size_t big_batch_size = Desc::BigBatchSize; ///< The number of batches kept in cache
@@ -75,9 +89,21 @@ struct cache_helper<Desc, Iterator, std::enable_if_t<etl::is_3d<typename std::it
      * \param it An iterator to an element
      * \param cache The cache to initialize
      */
-    static void init(size_t n, const Iterator& it, cache_type& cache) {
+    template <typename Cache = cache_type>
+    static void init(size_t n, const Iterator& it, Cache& cache) {
         auto one = *it;
-        cache    = cache_type(n, etl::dim<0>(one), etl::dim<1>(one), etl::dim<2>(one));
+        cache    = Cache(n, etl::dim<0>(one), etl::dim<1>(one), etl::dim<2>(one));
+    }
+
+    /*!
+     * \brief Init a batch buffer for the samples of the given cache
+     * \param n The size of the batch buffer
+     * \param source The cache holding the samples
+     * \param cache The batch buffer to initialize
+     */
+    template <typename Cache, typename Source>
+    static void init_batch(size_t n, const Source& source, Cache& cache) {
+        cache = Cache(n, etl::dim<1>(source), etl::dim<2>(source), etl::dim<3>(source));
     }
 
     /*!
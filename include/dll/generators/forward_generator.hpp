@@ -0,0 +1,280 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Implementation of a generator forwarding the batches of another
+ * generator through some layers.
+ */
+
+#pragma once
+
+#include <limits>
+#include <tuple>
+
+namespace dll {
+
+namespace detail {
+
+/*!
+ * \brief Forward a batch through the layers, starting from layer I
+ * \param layers The layers to forward through
+ * \param input The batch to forward
+ * \return The output of the last layer
+ */
+template <size_t I, typename Layers, typename Input, cpp_enable_iff((I == std::tuple_size<Layers>::value - 1))>
+auto forward_layers(const Layers& layers, const Input& input) {
+    return std::get<I>(layers).train_forward_batch(input);
+}
+
+/*!
+ * \brief Forward a batch through the layers, starting from layer I
+ * \param layers The layers to forward through
+ * \param input The batch to forward
+ * \return The output of the last layer
+ */
+template <size_t I, typename Layers, typename Input, cpp_enable_iff((I < std::tuple_size<Layers>::value - 1))>
+auto forward_layers(const Layers& layers, const Input& input) {
+    return forward_layers<I + 1>(layers, std::get<I>(layers).train_forward_batch(input));
+}
+
+} // end of namespace detail
+
+/*!
+ * \brief A generator computing the batches of another generator through
+ * some layers, on the fly.
+ *
+ * This is used for streaming pretraining, in which case the inputs of a layer
+ * are never completely stored in memory, only the current batch is.
+ *
+ * \tparam Generator The source generator
+ * \tparam Denoising Indicates if the labels of the source are forwarded (true) or if the labels are the data (false)
+ * \tparam Layers The layers to forward the batches through
+ */
+template <typename Generator, bool Denoising, typename... Layers>
+struct forward_generator {
+    using source_t = Generator; ///< The type of the source generator
+
+    static constexpr bool dll_generator = true; ///< Simple flag to indicate that the class is a DLL generator
+
+    static constexpr size_t batch_size = source_t::batch_size; ///< The size of the generated batches
+
+    static constexpr size_t no_batch = std::numeric_limits<size_t>::max(); ///< Marker for an empty batch cache
+
+    using layers_t = std::tuple<const Layers&...>; ///< The type of the tuple of layers
+
+    /*!
+     * \brief The type of a forwarded batch
+     */
+    using batch_t = decltype(detail::forward_layers<0>(std::declval<const layers_t&>(), std::declval<source_t&>().data_batch()));
+
+    source_t& source; ///< The source generator
+    layers_t layers;  ///< The layers to forward through
+
+    mutable batch_t data;                ///< The current data batch
+    mutable batch_t labels;              ///< The current label batch (only in denoising mode)
+    mutable size_t computed = no_batch;  ///< The index of the computed batch
+
+    size_t current = 0; ///< The current batch
+
+    /*!
+     * \brief Construct a new forward_generator
+     * \param source The source generator
+     * \param layers The layers to forward through
+     */
+    forward_generator(source_t& source, const Layers&... layers) : source(source), layers(layers...) {
+        // The layers are only computing inputs, no augmentation must be done
+        source.set_test();
+    }
+
+    forward_generator(const forward_generator& rhs) = delete;
+    forward_generator operator=(const forward_generator& rhs) = delete;
+
+    /*!
+     * \brief Display a description of the generator in the given stream
+     * \param stream The stream to print to
+     * \return stream
+     */
+    std::ostream& display(std::ostream& stream) const {
+        stream << "Forward Generator" << std::endl;
+        stream << "              Size: " << size() << std::endl;
+        stream << "           Batches: " << batches() << std::endl;
+        stream << "            Layers: " << sizeof...(Layers) << std::endl;
+
+        return stream;
+    }
+
+    /*!
+     * \brief Display a description of the generator in the standard output.
+     */
+    void display() const {
+        display(std::cout);
+    }
+
+    /*!
+     * \brief Nothing is stored in this generator
+     */
+    void set_safe() {}
+
+    /*!
+     * \brief Nothing is stored in this generator
+     */
+    void clear() {}
+
+    /*!
+     * brief Sets the generator in test mode
+     */
+    void set_test() {
+        // Nothing to do, the source is always in test mode
+    }
+
+    /*!
+     * brief Sets the generator in train mode
+     */
+    void set_train() {
+        // Nothing to do, the source is always in test mode
+    }
+
+    /*!
+     * \brief Reset the generator to the beginning
+     */
+    void reset() {
+        current  = 0;
+        computed = no_batch;
+
+        source.reset();
+    }
+
+    /*!
+     * \brief Reset the generator and shuffle the order of samples
+     */
+    void reset_shuffle() {
+        current  = 0;
+        computed = no_batch;
+
+        source.reset_shuffle();
+    }
+
+    /*!
+     * \brief Prepare the dataset for an epoch
+     */
+    void prepare_epoch() {
+        source.prepare_epoch();
+    }
+
+    /*!
+     * \brief Return the index of the current batch in the generation
+     * \return The current batch index
+     */
+    size_t current_batch() const {
+        return current;
+    }
+
+    /*!
+     * \brief Returns the number of elements in the generator
+     * \return The number of elements in the generator
+     */
+    size_t size() const {
+        return source.size();
+    }
+
+    /*!
+     * \brief Returns the augmented number of elements in the generator.
+     * \return The augmented number of elements in the generator
+     */
+    size_t augmented_size() const {
+        return source.size();
+    }
+
+    /*!
+     * \brief Returns the number of batches in the generator.
+     * \return The number of batches in the generator
+     */
+    size_t batches() const {
+        return source.batches();
+    }
+
+    /*!
+     * \brief Indicates if the generator has a next batch or not
+     * \return true if the generator has a next batch, false otherwise
+     */
+    bool has_next_batch() const {
+        return source.has_next_batch();
+    }
+
+    /*!
+     * \brief Moves to the next batch.
+     *
+     * This should only be called if the generator has a next batch.
+     */
+    void next_batch() {
+        ++current;
+
+        source.next_batch();
+    }
+
+    /*!
+     * \brief Returns the current data batch
+     * \return a a batch of data.
+     */
+    const batch_t& data_batch() const {
+        compute();
+
+        return data;
+    }
+
+    /*!
+     * \brief Returns the current label batch
+     * \return a a batch of label.
+     */
+    const batch_t& label_batch() const {
+        compute();
+
+        return Denoising ? labels : data;
+    }
+
+private:
+    /*!
+     * \brief Compute the current batch if not already computed
+     */
+    void compute() const {
+        if (computed != current) {
+            data = detail::forward_layers<0>(layers, source.data_batch());
+
+            if (Denoising) {
+                labels = detail::forward_layers<0>(layers, source.label_batch());
+            }
+
+            computed = current;
+        }
+    }
+};
+
+/*!
+ * \brief Display the given generator on the given stream
+ * \param os The output stream
+ * \param generator The generator to display
+ * \return os
+ */
+template <typename Generator, bool Denoising, typename... Layers>
+std::ostream& operator<<(std::ostream& os, forward_generator<Generator, Denoising, Layers...>& generator) {
+    return generator.display(os);
+}
+
+/*!
+ * \brief Make a generator forwarding the batches of the given generator
+ * through the given layers.
+ *
+ * \param generator The source generator
+ * \param layers The layers to forward through
+ */
+template <bool Denoising = false, typename Generator, typename... Layers>
+auto make_forward_generator(Generator& generator, const Layers&... layers) {
+    return std::make_unique<forward_generator<Generator, Denoising, Layers...>>(generator, layers...);
+}
+
+} //end of dll namespace
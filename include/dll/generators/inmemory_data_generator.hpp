@@ -14,6 +14,11 @@
 
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <numeric>
+#include <algorithm>
 
 namespace dll {
 
@@ -33,24 +38,62 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
     using data_cache_helper_t  = cache_helper<Desc, Iterator>;                                      ///< The helper for the data cache
     using label_cache_helper_t = label_cache_helper<Desc, weight, LIterator>;                       ///< The helper for the label cache
 
-    using data_cache_type  = typename data_cache_helper_t::cache_type;  ///< The type of the data cache
+    using batch_type       = typename data_cache_helper_t::cache_type;  ///< The type of the data batches
     using label_cache_type = typename label_cache_helper_t::cache_type; ///< The type of the label cache
 
+    /*!
+     * \brief The type of the data cache
+     */
+    using data_cache_type = std::conditional_t<desc::CompactStorage, typename data_cache_helper_t::compact_type, batch_type>;
+
     static constexpr bool dll_generator = true; ///< Simple flag to indicate that the class is a DLL generator
 
     static constexpr size_t batch_size = desc::BatchSize; ///< The size of the generated batches
 
+    static constexpr size_t no_batch = std::numeric_limits<size_t>::max(); ///< Marker for an empty staging buffer
+
     data_cache_type input_cache;  ///< The input cache
     label_cache_type label_cache; ///< The label cache
 
+    // When the generator is shuffled, only the order of the samples is
+    // shuffled and the batches are gathered in the staging buffers.
+    // With compact storage, the data batches are always expanded in the
+    // staging buffer.
+
+    std::vector<size_t> order;              ///< The order of the samples
+    mutable batch_type staging_input;       ///< The staging buffer for the current input batch
+    mutable label_cache_type staging_label; ///< The staging buffer for the current label batch
+    mutable size_t staged = no_batch;       ///< The index of the batch in the staging buffers
+
+    // With asynchronous prefetching, a thread gathers the next batch in one
+    // of two buffers while the current batch is being used
+
+    mutable batch_type prefetch_input[2];       ///< The prefetch buffers for the input batches
+    mutable label_cache_type prefetch_label[2]; ///< The prefetch buffers for the label batches
+
+    mutable size_t prefetched[2] = {no_batch, no_batch}; ///< The batch ready in each prefetch buffer
+    mutable size_t queued[2]     = {no_batch, no_batch}; ///< The batch requested in each prefetch buffer
+    mutable size_t busy          = no_batch;             ///< The prefetch buffer being filled
+    mutable size_t busy_batch    = no_batch;             ///< The batch being filled
+
+    mutable std::mutex prefetch_lock;                      ///< The lock protecting the prefetch state
+    mutable std::condition_variable prefetch_condition;    ///< The condition variable for the thread to wait for requests
+    mutable std::condition_variable prefetched_condition;  ///< The condition variable to wait for prefetched batches
+
+    bool stop_flag = false;      ///< Indicates to the prefetch thread to stop
+    std::thread prefetch_thread; ///< The prefetch thread
+
     size_t current = 0;     ///< The current index
     bool is_safe   = false; ///< Indicates if the generator is safe to reclaim memory from
+    bool shuffled  = false; ///< Indicates if the samples are read in shuffled order
 
     template <typename Input, typename Label>
     inmemory_data_generator(const Input& input, const Label& label, size_t n, size_t n_classes){
         // Initialize both caches for enough elements
         data_cache_helper_t::init(n, &input, input_cache);
         label_cache_helper_t::init(n, n_classes, &label, label_cache);
+
+        start_prefetch();
     }
 
     /*!
@@ -64,11 +107,7 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
 
         size_t i = 0;
         while (first != last) {
-            input_cache(i) = *first;
-
-            pre_scaler<desc>::transform(input_cache(i));
-            pre_normalizer<desc>::transform(input_cache(i));
-            pre_binarizer<desc>::transform(input_cache(i));
+            store_sample(i, *first);
 
             label_cache_helper_t::set(i, lfirst, label_cache);
 
@@ -85,6 +124,8 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
         }
 
         cpp_unused(llast);
+
+        start_prefetch();
     }
 
     inmemory_data_generator(const inmemory_data_generator& rhs) = delete;
@@ -93,6 +134,19 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
     inmemory_data_generator(inmemory_data_generator&& rhs) = delete;
     inmemory_data_generator operator=(inmemory_data_generator&& rhs) = delete;
 
+    /*!
+     * \brief Destructs the inmemory_data_generator
+     */
+    ~inmemory_data_generator() {
+        if (prefetch_thread.joinable()) {
+            cpp::with_lock(prefetch_lock, [this] { stop_flag = true; });
+
+            prefetch_condition.notify_all();
+
+            prefetch_thread.join();
+        }
+    }
+
     /*!
      * \brief Display a description of the generator in the given stream
      * \param stream The stream to print to
@@ -129,8 +183,18 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     void clear() {
         if (is_safe) {
+            cancel_prefetch();
+
+            prefetch_input[0].clear();
+            prefetch_input[1].clear();
+            prefetch_label[0].clear();
+            prefetch_label[1].clear();
+
             input_cache.clear();
             label_cache.clear();
+            staging_input.clear();
+            staging_label.clear();
+            order.clear();
         }
     }
 
@@ -153,6 +217,9 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     void reset() {
         current = 0;
+        staged  = no_batch;
+
+        restart_prefetch();
     }
 
     /*!
@@ -160,18 +227,39 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     void reset_shuffle() {
         current = 0;
+        staged  = no_batch;
         shuffle();
     }
 
     /*!
      * \brief Shuffle the order of the samples.
      *
+     * Only the indices of the samples are shuffled, the caches are never
+     * modified. The batches are then gathered from the caches.
+     *
      * This should only be done when the generator is at the beginning.
      */
     void shuffle() {
         cpp_assert(!current, "Shuffle should only be performed on start of generation");
 
-        etl::parallel_shuffle(input_cache, label_cache, dll::random_engine());
+        // The order must not change while batches are gathered
+        cancel_prefetch();
+
+        // The caches may have been filled after construction
+        if (order.size() != size()) {
+            order.resize(size());
+            std::iota(order.begin(), order.end(), 0);
+
+            data_cache_helper_t::init_batch(std::min(batch_size, size()), input_cache, staging_input);
+            staging_label = label_cache_type(etl::slice(label_cache, 0, std::min(batch_size, size())));
+        }
+
+        std::shuffle(order.begin(), order.end(), dll::rand_engine());
+
+        shuffled = true;
+        staged   = no_batch;
+
+        restart_prefetch();
     }
 
     /*!
@@ -233,6 +321,11 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     void next_batch() {
         current += batch_size;
+
+        // The buffer of the previous batch can now be reused
+        if (desc::AsyncPrefetch) {
+            request_prefetch(current + batch_size);
+        }
     }
 
     /*!
@@ -240,7 +333,19 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      * \return a a batch of data.
      */
     auto data_batch() const {
-        return etl::slice(input_cache, current, std::min(current + batch_size, size()));
+        const size_t n = std::min(current + batch_size, size()) - current;
+
+        if (desc::AsyncPrefetch) {
+            const batch_type& source = prefetch_input[wait_prefetch()];
+
+            return etl::slice(source, 0, n);
+        }
+
+        stage();
+
+        const size_t first = (shuffled || desc::CompactStorage) ? 0 : current;
+
+        return etl::slice(data_source(), first, first + n);
     }
 
     /*!
@@ -248,7 +353,52 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      * \return a a batch of label.
      */
     auto label_batch() const {
-        return etl::slice(label_cache, current, std::min(current + batch_size, size()));
+        const size_t n = std::min(current + batch_size, size()) - current;
+
+        if (desc::AsyncPrefetch) {
+            const label_cache_type& source = prefetch_label[wait_prefetch()];
+
+            return etl::slice(source, 0, n);
+        }
+
+        stage();
+
+        const size_t first = shuffled ? 0 : current;
+        const size_t last  = first + n;
+
+        const label_cache_type& source = shuffled ? staging_label : label_cache;
+
+        return etl::slice(source, first, last);
+    }
+
+    /*!
+     * \brief Gather the current batch in the staging buffers if the
+     * generator is shuffled or if the storage is compact.
+     */
+    void stage() const {
+        if (!shuffled && !desc::CompactStorage) {
+            return;
+        }
+
+        if (staged != current) {
+            const size_t n = std::min(current + batch_size, size()) - current;
+
+            if (!etl::size(staging_input)) {
+                data_cache_helper_t::init_batch(std::min(batch_size, size()), input_cache, staging_input);
+            }
+
+            for (size_t i = 0; i < n; ++i) {
+                const size_t j = shuffled ? order[current + i] : current + i;
+
+                stage_sample(staging_input, i, j);
+
+                if (shuffled) {
+                    staging_label(i) = label_cache(j);
+                }
+            }
+
+            staged = current;
+        }
     }
 
     /*!
@@ -258,7 +408,15 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     template <typename Input>
     void set_data_batch(size_t i, Input&& input_batch) {
-        etl::slice(input_cache, i, i + etl::dim<0>(input_batch)) = input_batch;
+        cancel_prefetch();
+
+        cpp::static_if<desc::CompactStorage>([&](auto f) {
+            for (size_t b = 0; b < etl::dim<0>(input_batch); ++b) {
+                detail::store_compact(f(input_cache)(i + b), input_batch(b));
+            }
+        }).else_([&](auto f) {
+            etl::slice(f(input_cache), i, i + etl::dim<0>(input_batch)) = input_batch;
+        });
     }
 
     /*!
@@ -268,6 +426,8 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     template <typename Input>
     void set_label_batch(size_t i, Input&& input_batch) {
+        cancel_prefetch();
+
         etl::slice(label_cache, i, i + etl::dim<0>(input_batch)) = input_batch;
     }
 
@@ -276,9 +436,12 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
      */
     void finalize_prepared_data() {
         for (size_t i = 0; i < size(); ++i) {
-            pre_scaler<desc>::transform(input_cache(i));
-            pre_normalizer<desc>::transform(input_cache(i));
-            pre_binarizer<desc>::transform(input_cache(i));
+            // With compact storage, the inputs are transformed when staged
+            cpp::static_if<!desc::CompactStorage>([&](auto f) {
+                pre_scaler<desc>::transform(f(input_cache)(i));
+                pre_normalizer<desc>::transform(f(input_cache)(i));
+                pre_binarizer<desc>::transform(f(input_cache)(i));
+            });
 
             // In case of auto-encoders, the label images also need to be transformed
             cpp::static_if<desc::AutoEncoder>([&](auto f) {
@@ -296,6 +459,225 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
     static constexpr size_t dimensions() {
         return etl::dimensions<data_cache_type>() - 1;
     }
+
+private:
+    /*!
+     * \brief Store a sample in the input cache
+     * \param i The index of the sample in the cache
+     * \param sample The sample to store
+     */
+    template <typename Sample, typename DD = desc, cpp_enable_iff(!DD::CompactStorage)>
+    void store_sample(size_t i, const Sample& sample) {
+        input_cache(i) = sample;
+
+        pre_scaler<desc>::transform(input_cache(i));
+        pre_normalizer<desc>::transform(input_cache(i));
+        pre_binarizer<desc>::transform(input_cache(i));
+    }
+
+    /*!
+     * \copydoc store_sample
+     */
+    template <typename Sample, typename DD = desc, cpp_enable_iff(DD::CompactStorage)>
+    void store_sample(size_t i, const Sample& sample) {
+        detail::store_compact(input_cache(i), sample);
+    }
+
+    /*!
+     * \brief Copy a sample of the input cache into a staging buffer
+     * \param target The staging buffer
+     * \param i The index in the staging buffer
+     * \param j The index in the input cache
+     */
+    template <typename DD = desc, cpp_enable_iff(!DD::CompactStorage)>
+    void stage_sample(batch_type& target, size_t i, size_t j) const {
+        target(i) = input_cache(j);
+    }
+
+    /*!
+     * \brief Expand a sample of the compact input cache into a staging
+     * buffer and pre-process it.
+     *
+     * \param target The staging buffer
+     * \param i The index in the staging buffer
+     * \param j The index in the input cache
+     */
+    template <typename DD = desc, cpp_enable_iff(DD::CompactStorage)>
+    void stage_sample(batch_type& target, size_t i, size_t j) const {
+        const size_t n = etl::size(input_cache) / etl::dim<0>(input_cache);
+
+        detail::expand_compact(input_cache.memory_start() + j * n, target.memory_start() + i * n, n, weight(desc::ScalePre ? desc::ScalePre : 1));
+
+        target.invalidate_gpu();
+
+        pre_normalizer<desc>::transform(target(i));
+        pre_binarizer<desc>::transform(target(i));
+    }
+
+    /*!
+     * \brief Start the prefetch thread, if enabled
+     */
+    void start_prefetch() {
+        if (!desc::AsyncPrefetch) {
+            return;
+        }
+
+        prefetch_thread = std::thread([this] {
+            while (true) {
+                size_t k;
+                size_t batch;
+
+                {
+                    std::unique_lock<std::mutex> ulock(prefetch_lock);
+
+                    prefetch_condition.wait(ulock, [this] { return stop_flag || queued[0] != no_batch || queued[1] != no_batch; });
+
+                    if (stop_flag) {
+                        return;
+                    }
+
+                    // Fill the first batch first
+                    k     = queued[0] <= queued[1] ? 0 : 1;
+                    batch = queued[k];
+
+                    queued[k]  = no_batch;
+                    busy       = k;
+                    busy_batch = batch;
+                }
+
+                fill_prefetch(k, batch);
+
+                {
+                    std::unique_lock<std::mutex> ulock(prefetch_lock);
+
+                    prefetched[k] = batch;
+                    busy          = no_batch;
+                    busy_batch    = no_batch;
+
+                    prefetched_condition.notify_all();
+                }
+            }
+        });
+    }
+
+    /*!
+     * \brief Gather a batch in a prefetch buffer.
+     *
+     * The rows after the end of a partial batch are set to zero.
+     *
+     * \param k The prefetch buffer
+     * \param batch The index of the first sample of the batch
+     */
+    void fill_prefetch(size_t k, size_t batch) const {
+        const size_t n = std::min(batch + batch_size, size()) - batch;
+
+        if (!etl::size(prefetch_input[k])) {
+            data_cache_helper_t::init_batch(std::min(batch_size, size()), input_cache, prefetch_input[k]);
+            prefetch_label[k] = label_cache_type(etl::slice(label_cache, 0, std::min(batch_size, size())));
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const size_t j = shuffled ? order[batch + i] : batch + i;
+
+            stage_sample(prefetch_input[k], i, j);
+            prefetch_label[k](i) = label_cache(j);
+        }
+
+        for (size_t i = n; i < etl::dim<0>(prefetch_input[k]); ++i) {
+            prefetch_input[k](i) = 0;
+            prefetch_label[k](i) = 0;
+        }
+    }
+
+    /*!
+     * \brief Request the prefetch of the given batch
+     * \param batch The index of the first sample of the batch
+     */
+    void request_prefetch(size_t batch) const {
+        if (batch >= size()) {
+            return;
+        }
+
+        const size_t k = (batch / batch_size) % 2;
+
+        std::unique_lock<std::mutex> ulock(prefetch_lock);
+
+        // The buffer may still be filled with an older batch
+        prefetched_condition.wait(ulock, [this, k] { return busy != k; });
+
+        prefetched[k] = no_batch;
+        queued[k]     = batch;
+
+        prefetch_condition.notify_one();
+    }
+
+    /*!
+     * \brief Wait for the current batch to be prefetched
+     * \return The prefetch buffer holding the current batch
+     */
+    size_t wait_prefetch() const {
+        const size_t k = (current / batch_size) % 2;
+
+        std::unique_lock<std::mutex> ulock(prefetch_lock);
+
+        if (prefetched[k] != current && queued[k] != current && busy_batch != current) {
+            ulock.unlock();
+            request_prefetch(current);
+            ulock.lock();
+        }
+
+        prefetched_condition.wait(ulock, [this, k] { return prefetched[k] == current; });
+
+        return k;
+    }
+
+    /*!
+     * \brief Cancel all the pending prefetches and wait for the prefetch
+     * thread to be idle.
+     */
+    void cancel_prefetch() {
+        if (!desc::AsyncPrefetch) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> ulock(prefetch_lock);
+
+        queued[0] = queued[1] = no_batch;
+
+        prefetched_condition.wait(ulock, [this] { return busy == no_batch; });
+
+        prefetched[0] = prefetched[1] = no_batch;
+    }
+
+    /*!
+     * \brief Restart the prefetching from the current batch
+     */
+    void restart_prefetch() {
+        if (!desc::AsyncPrefetch) {
+            return;
+        }
+
+        cancel_prefetch();
+
+        request_prefetch(current);
+        request_prefetch(current + batch_size);
+    }
+
+    /*!
+     * \brief Returns the buffer from which the data batches are taken
+     */
+    template <typename DD = desc, cpp_enable_iff(!DD::CompactStorage)>
+    const batch_type& data_source() const {
+        return shuffled ? staging_input : input_cache;
+    }
+
+    /*!
+     * \copydoc data_source
+     */
+    template <typename DD = desc, cpp_enable_iff(DD::CompactStorage)>
+    const batch_type& data_source() const {
+        return staging_input;
+    }
 };
 
 /*!
@@ -303,6 +685,8 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<!is_a
  */
 template <typename Iterator, typename LIterator, typename Desc>
 struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_augmented<Desc>>> {
+    static_assert(!Desc::CompactStorage, "compact_storage is not supported with data augmentation");
+
     using desc                 = Desc;                                        ///< The generator descriptor
     using weight               = etl::value_t<typename Iterator::value_type>; ///< The data type
     using data_cache_helper_t  = cache_helper<desc, Iterator>;                ///< The helper for the data cache
@@ -314,13 +698,43 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
 
     static constexpr bool dll_generator    = true;               ///< Simple flag to indicate that the class is a DLL generator
 
-    static constexpr size_t batch_size     = desc::BatchSize;    ///< The size of the generated batches
-    static constexpr size_t big_batch_size = desc::BigBatchSize; ///< The number of batches kept in cache
+    static constexpr size_t batch_size      = desc::BatchSize;      ///< The size of the generated batches
+    static constexpr size_t big_batch_size  = desc::BigBatchSize;   ///< The number of batches kept in cache
+    static constexpr size_t augment_threads = desc::AugmentThreads; ///< The number of augmentation threads
+
+    static constexpr size_t no_batch = std::numeric_limits<size_t>::max(); ///< Marker for a slot without a ready batch
+
+    /*!
+     * \brief The state of an augmentation worker.
+     *
+     * Each worker has its own copy of the augmenters and its own random
+     * engine in order to augment batches independently of the others.
+     */
+    struct augment_worker {
+        random_cropper<Desc> cropper;      ///< The random cropper
+        random_mirrorer<Desc> mirrorer;    ///< The random mirrorer
+        elastic_distorter<Desc> distorter; ///< The elastic distorter
+        random_noise<Desc> noiser;         ///< The random noiser
+
+        dll::random_engine engine; ///< The random engine of the worker
+
+        /*!
+         * \brief Construct a new worker from the augmenters of the generator
+         */
+        augment_worker(const inmemory_data_generator& generator, size_t seed)
+                : cropper(generator.cropper), mirrorer(generator.mirrorer), distorter(generator.distorter), noiser(generator.noiser), engine(seed) {
+            // Nothing else to init
+        }
+    };
 
     data_cache_type input_cache;  ///< The data cache
     big_cache_type batch_cache;   ///< The data batch cache
     label_cache_type label_cache; ///< The label cache
 
+    std::vector<size_t> order;              ///< The order of the samples
+    mutable label_cache_type staging_label; ///< The staging buffer for the current label batch
+    mutable size_t staged = no_batch;       ///< The index of the batch in the label staging buffer
+
     random_cropper<Desc> cropper;      ///< The random cropper
     random_mirrorer<Desc> mirrorer;    ///< The random mirrorer
     elastic_distorter<Desc> distorter; ///< The elastic distorter
@@ -330,17 +744,31 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
     size_t current = 0;     ///< The current index
     bool is_safe   = false; ///< Indicates if the generator is safe to reclaim memory from
 
-    mutable volatile bool status[big_batch_size];    ///< Status of each batch
-    mutable volatile size_t indices[big_batch_size]; ///< Indices of each batch
+    // The batch cache is used as a lock-free ring of big_batch_size slots.
+    // Batch i of the generation is always augmented in slot i % big_batch_size.
+    // Workers take tickets (batch numbers) and the reader consumes the
+    // batches in order. A slot can be filled once the batch that was in it
+    // has been consumed and is ready when it contains the expected batch.
+
+    mutable std::atomic<size_t> ready[big_batch_size]; ///< The batch ready in each slot (no_batch if none)
+
+    std::atomic<size_t> next_ticket{0}; ///< The next batch to augment
+    std::atomic<size_t> consumed{0};    ///< The number of batches consumed in the current generation
+    std::atomic<size_t> generation{0};  ///< The current generation
+    std::atomic<size_t> busy{0};        ///< The number of workers holding a ticket
+    std::atomic<bool> stop_flag{false}; ///< Boolean flag indicating to the threads to stop
+    std::atomic<bool> train_mode{false}; ///< The train mode status
 
-    mutable std::mutex main_lock;                    ///< The main lock
-    mutable std::condition_variable condition;       ///< The condition variable for the thread to wait for some space
-    mutable std::condition_variable ready_condition; ///< The condition variable for a reader to wait for ready data
+    const size_t random_stream = dll::new_random_stream(); ///< The random stream of the generator
 
-    volatile bool stop_flag = false; ///< Boolean flag indicating to the thread to stop
+    // The lock is only used to put threads to sleep when they have nothing to do
 
-    std::thread main_thread; ///< The main thread
-    bool train_mode = false; ///< The train mode status
+    mutable std::mutex wait_lock;                   ///< The lock to wait on
+    mutable std::condition_variable wait_condition; ///< The condition variable to wait on
+    mutable std::atomic<size_t> waiters{0};         ///< The number of sleeping threads
+
+    std::vector<augment_worker> workers; ///< The augmentation workers
+    std::vector<std::thread> threads;    ///< The augmentation threads
 
     /*!
      * \brief Construct an inmemory data generator
@@ -377,93 +805,26 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
         }
 
         for (size_t b = 0; b < big_batch_size; ++b) {
-            status[b]  = false;
-            indices[b] = b;
+            ready[b] = no_batch;
         }
 
-        cpp_unused(llast);
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0);
 
-        main_thread = std::thread([this] {
-            while (true) {
-                // The index of the batch inside the batch cache
-                size_t index = 0;
+        staging_label = label_cache_type(etl::slice(label_cache, 0, std::min(batch_size, n)));
 
-                {
-                    std::unique_lock<std::mutex> ulock(main_lock);
-
-                    bool found = false;
-
-                    // Try to find a read batch first
-                    for (size_t b = 0; b < big_batch_size; ++b) {
-                        if (!status[b] && indices[b] * batch_size < size()) {
-                            index = b;
-                            found = true;
-                            break;
-                        }
-                    }
-
-                    // if not found, wait for a ready to compute batch
-
-                    if (!found) {
-                        // Wait for the end or for some work
-                        condition.wait(ulock, [this, &index] {
-                            if (stop_flag) {
-                                return true;
-                            }
-
-                            for (size_t b = 0; b < big_batch_size; ++b) {
-                                if (!status[b] && indices[b] * batch_size < size()) {
-                                    index = b;
-                                    return true;
-                                }
-                            }
-
-                            return false;
-                        });
-
-                        // If there is no more thread for the thread, exit
-                        if (stop_flag) {
-                            return;
-                        }
-                    }
-                }
-
-                // Get the batch that needs to be read
-                const size_t batch = indices[index];
-
-                // Get the index from where to read inside the input cache
-                const size_t input_n = batch * batch_size;
-
-                for (size_t i = 0; i < batch_size && input_n < size(); ++i) {
-                    if (train_mode) {
-                        // Random crop the image
-                        cropper.transform_first(batch_cache(index)(i), input_cache(input_n + i));
-
-                        // Mirror the image
-                        mirrorer.transform(batch_cache(index)(i));
-
-                        // Distort the image
-                        distorter.transform(batch_cache(index)(i));
-
-                        // Noise the image
-                        noiser.transform(batch_cache(index)(i));
-                    } else {
-                        // Center crop the image
-                        cropper.transform_first_test(batch_cache(index)(i), input_cache(input_n + i));
-                    }
-                }
-
-                // Notify a waiter that one batch is ready
+        cpp_unused(llast);
 
-                {
-                    std::unique_lock<std::mutex> ulock(main_lock);
+        workers.reserve(augment_threads);
+        threads.reserve(augment_threads);
 
-                    status[index] = true;
+        for (size_t t = 0; t < augment_threads; ++t) {
+            workers.emplace_back(*this, dll::stream_seed(random_stream));
+        }
 
-                    ready_condition.notify_one();
-                }
-            }
-        });
+        for (size_t t = 0; t < augment_threads; ++t) {
+            threads.emplace_back([this, t] { augment_loop(workers[t]); });
+        }
     }
 
     inmemory_data_generator(const inmemory_data_generator& rhs) = delete;
@@ -482,6 +843,7 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
         stream << "              Size: " << size() << std::endl;
         stream << "           Batches: " << batches() << std::endl;
         stream << "    Augmented Size: " << augmented_size() << std::endl;
+        stream << "           Threads: " << augment_threads << std::endl;
 
         return stream;
     }
@@ -511,6 +873,8 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
             input_cache.clear();
             batch_cache.clear();
             label_cache.clear();
+            staging_label.clear();
+            order.clear();
         }
     }
 
@@ -532,25 +896,23 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
      * \brief Destructs the inmemory_data_generator
      */
     ~inmemory_data_generator() {
-        cpp::with_lock(main_lock, [this] { stop_flag = true; });
+        stop_flag = true;
 
-        condition.notify_all();
+        cpp::with_lock(wait_lock, [this] { wait_condition.notify_all(); });
 
-        main_thread.join();
+        for (auto& thread : threads) {
+            thread.join();
+        }
     }
 
     /*!
      * \brief Reset the generation to its beginning
      */
     void reset_generation() {
-        std::unique_lock<std::mutex> ulock(main_lock);
+        stop_generation();
+        start_generation();
 
-        for (size_t b = 0; b < big_batch_size; ++b) {
-            status[b]  = false;
-            indices[b] = b;
-        }
-
-        condition.notify_one();
+        staged = no_batch;
     }
 
     /*!
@@ -566,19 +928,27 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
      */
     void reset_shuffle() {
         current = 0;
+
+        // The workers must not read the order while it is shuffled
+        stop_generation();
         shuffle();
-        reset_generation();
+        start_generation();
+
+        staged = no_batch;
     }
 
     /*!
      * \brief Shuffle the order of the samples.
      *
+     * Only the indices of the samples are shuffled, the caches are never
+     * modified.
+     *
      * This should only be done when the generator is at the beginning.
      */
     void shuffle() {
         cpp_assert(!current, "Shuffle should only be performed on start of generation");
 
-        etl::parallel_shuffle(input_cache, label_cache, dll::random_engine());
+        std::shuffle(order.begin(), order.end(), dll::rand_engine());
     }
 
     /*!
@@ -638,18 +1008,10 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
      * This should only be called if the generator has a next batch.
      */
     void next_batch() {
-        // Get information from batch that has been consumed
-        const auto batch = current / batch_size;
-        const auto b     = batch % big_batch_size;
-
-        {
-            std::unique_lock<std::mutex> ulock(main_lock);
+        // Release the slot of the batch that has been consumed
+        consumed = current / batch_size + 1;
 
-            status[b] = false;
-            indices[b] += big_batch_size;
-
-            condition.notify_one();
-        }
+        wake();
 
         current += batch_size;
     }
@@ -659,26 +1021,12 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
      * \return a a batch of data.
      */
     auto data_batch() const {
-        std::unique_lock<std::mutex> ulock(main_lock);
-
         const auto batch = current / batch_size;
         const auto b     = batch % big_batch_size;
 
-        if (status[b]) {
-            const auto input_n = indices[b] * batch_size + batch_size;
-
-            if (input_n > size()) {
-                return etl::slice(batch_cache(b), 0, batch_size - (input_n - size()));
-            } else {
-                return etl::slice(batch_cache(b), 0, batch_size);
-            }
-        }
-
-        ready_condition.wait(ulock, [this, b] {
-            return status[b];
-        });
+        wait([this, b, batch] { return ready[b] == batch; });
 
-        const auto input_n = indices[b] * batch_size + batch_size;
+        const auto input_n = batch * batch_size + batch_size;
 
         if (input_n > size()) {
             return etl::slice(batch_cache(b), 0, batch_size - (input_n - size()));
@@ -692,7 +1040,17 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
      * \return a a batch of label.
      */
     auto label_batch() const {
-        return etl::slice(label_cache, current, std::min(current + batch_size, size()));
+        const size_t n = std::min(current + batch_size, size()) - current;
+
+        if (staged != current) {
+            for (size_t i = 0; i < n; ++i) {
+                staging_label(i) = label_cache(order[current + i]);
+            }
+
+            staged = current;
+        }
+
+        return etl::slice(staging_label, 0, n);
     }
 
     /*!
@@ -702,6 +1060,135 @@ struct inmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_au
     static constexpr size_t dimensions() {
         return etl::dimensions<data_cache_type>() - 1;
     }
+
+private:
+    /*!
+     * \brief Put the current thread to sleep until the given condition is true
+     * \param condition The condition to wait for
+     */
+    template <typename C>
+    void wait(C condition) const {
+        if (condition()) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> ulock(wait_lock);
+
+        ++waiters;
+        wait_condition.wait(ulock, condition);
+        --waiters;
+    }
+
+    /*!
+     * \brief Wake the sleeping threads so that they can check their condition again
+     */
+    void wake() const {
+        if (waiters) {
+            std::unique_lock<std::mutex> ulock(wait_lock);
+            wait_condition.notify_all();
+        }
+    }
+
+    /*!
+     * \brief Stop the current generation and wait for the workers to
+     * finish the batches they are augmenting.
+     */
+    void stop_generation() {
+        // No more tickets can be taken
+        next_ticket = batches();
+
+        // Abort the workers waiting for a slot
+        ++generation;
+
+        wake();
+
+        wait([this] { return busy == 0; });
+    }
+
+    /*!
+     * \brief Start a new generation from the first batch
+     */
+    void start_generation() {
+        for (size_t b = 0; b < big_batch_size; ++b) {
+            ready[b] = no_batch;
+        }
+
+        consumed    = 0;
+        next_ticket = 0;
+
+        wake();
+    }
+
+    /*!
+     * \brief The main loop of an augmentation worker
+     * \param worker The worker state
+     */
+    void augment_loop(augment_worker& worker) {
+        while (true) {
+            // Wait for the end or for some work
+            wait([this] { return stop_flag || next_ticket < batches(); });
+
+            if (stop_flag) {
+                return;
+            }
+
+            ++busy;
+
+            const size_t gen   = generation;
+            const size_t batch = next_ticket++;
+
+            if (batch < batches()) {
+                const size_t b = batch % big_batch_size;
+
+                // Wait for the previous batch of the slot to be consumed
+                wait([this, batch, gen] { return stop_flag || generation != gen || consumed + big_batch_size > batch; });
+
+                if (!stop_flag && generation == gen) {
+                    augment_batch(worker, b, batch, gen);
+
+                    ready[b] = batch;
+                }
+            }
+
+            --busy;
+
+            wake();
+        }
+    }
+
+    /*!
+     * \brief Augment a batch of the input cache into a slot of the batch cache
+     * \param worker The worker state
+     * \param b The slot in the batch cache
+     * \param batch The batch to augment
+     * \param gen The generation of the batch
+     */
+    void augment_batch(augment_worker& worker, size_t b, size_t batch, size_t gen) {
+        // Get the index from where to read inside the input cache
+        const size_t input_n = batch * batch_size;
+
+        // The augmentation of a batch does not depend on the worker augmenting it
+        worker.engine = dll::random_engine(dll::stream_seed(random_stream, gen * batches() + batch));
+
+        for (size_t i = 0; i < batch_size && input_n + i < size(); ++i) {
+            if (train_mode) {
+                // Random crop the image
+                worker.cropper.transform_first(batch_cache(b)(i), input_cache(order[input_n + i]), worker.engine);
+
+                // Mirror the image
+                worker.mirrorer.transform(batch_cache(b)(i), worker.engine);
+
+                // Distort the image
+                worker.distorter.transform(batch_cache(b)(i), worker.engine);
+
+                // Noise the image
+                worker.noiser.transform(batch_cache(b)(i), worker.engine);
+            } else {
+                // Center crop the image
+                worker.cropper.transform_first_test(batch_cache(b)(i), input_cache(order[input_n + i]));
+            }
+        }
+    }
 };
 
 /*!
@@ -790,8 +1277,24 @@ struct inmemory_data_generator_desc {
      */
     static constexpr bool AutoEncoder = parameters::template contains<autoencoder>();
 
+    /*!
+     * \brief The number of threads for data augmentation
+     */
+    static constexpr size_t AugmentThreads = detail::get_value_v<augment_threads<1>, Parameters...>;
+
+    /*!
+     * \brief Indicates if the samples are stored as 8-bit values
+     */
+    static constexpr bool CompactStorage = parameters::template contains<compact_storage>();
+
+    /*!
+     * \brief Indicates if the next batch is gathered in the background
+     */
+    static constexpr bool AsyncPrefetch = parameters::template contains<async_prefetch>();
+
     static_assert(BatchSize > 0, "The batch size must be larger than one");
     static_assert(BigBatchSize > 0, "The big batch size must be larger than one");
+    static_assert(AugmentThreads > 0, "There must be at least one augmentation thread");
     static_assert(!(AutoEncoder && (random_crop_x || random_crop_y)), "autoencoder mode is not compatible with random crop");
 
     //Make sure only valid types are passed to the configuration list
@@ -799,7 +1302,8 @@ struct inmemory_data_generator_desc {
         detail::is_valid_v<
             cpp::type_list<
                 batch_size_id, big_batch_size_id, horizontal_mirroring_id, vertical_mirroring_id, random_crop_id, elastic_distortion_id,
-                categorical_id, noise_id, nop_id, normalize_pre_id, binarize_pre_id, scale_pre_id, autoencoder_id>,
+                categorical_id, noise_id, nop_id, normalize_pre_id, binarize_pre_id, scale_pre_id, autoencoder_id, augment_threads_id,
+                compact_storage_id, async_prefetch_id>,
             Parameters...>,
         "Invalid parameters type for rbm_desc");
 
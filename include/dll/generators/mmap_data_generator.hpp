@@ -0,0 +1,462 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Implementation of a generator reading batches directly from a
+ * memory-mapped shard file.
+ */
+
+#pragma once
+
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "dll/util/shard.hpp"
+#include "dll/util/random.hpp"
+
+namespace dll {
+
+/*!
+ * \brief A generator reading its batches from a memory-mapped shard.
+ *
+ * When the shard contains float values and no pre-processing is
+ * configured, the data batches are views directly into the mapped file,
+ * nothing is copied. Otherwise, the samples of the current batch are
+ * converted into a staging buffer.
+ *
+ * The returned batches are read-only views.
+ *
+ * In order to keep the batches contiguous, shuffling only shuffles the
+ * order of the batches. The samples should be shuffled once when the shard
+ * is written.
+ *
+ * \tparam D The number of dimensions of one sample
+ * \tparam Desc The generator descriptor
+ */
+template <size_t D, typename Desc>
+struct mmap_data_generator {
+    using desc   = Desc;  ///< The generator descriptor
+    using weight = float; ///< The data type
+
+    using data_batch_t  = etl::custom_dyn_matrix<weight, D + 1>; ///< The type of a data batch
+    using data_stage_t  = etl::dyn_matrix<weight, D + 1>;        ///< The type of the data staging buffer
+    using label_batch_t = etl::custom_dyn_matrix<weight, desc::Categorical ? 2 : 1>; ///< The type of a label batch
+    using label_stage_t = etl::dyn_matrix<weight, 2>;            ///< The type of the label staging buffer
+
+    static constexpr bool dll_generator = true; ///< Simple flag to indicate that the class is a DLL generator
+
+    static constexpr size_t batch_size = desc::BatchSize; ///< The size of the generated batches
+
+    static constexpr size_t no_batch = std::numeric_limits<size_t>::max(); ///< Marker for an empty staging buffer
+
+    /*!
+     * \brief Indicates if the samples are transformed when read
+     */
+    static constexpr bool preprocessed = desc::ScalePre || desc::NormalizePre || desc::BinarizePre;
+
+    mapped_shard shard; ///< The mapped shard
+
+    std::vector<size_t> order; ///< The order of the batches
+
+    mutable data_stage_t staging_input;  ///< The staging buffer for the data
+    mutable label_stage_t staging_label; ///< The staging buffer for the categorical labels
+    mutable size_t staged_input = no_batch; ///< The batch in the data staging buffer
+    mutable size_t staged_label = no_batch; ///< The batch in the label staging buffer
+
+    size_t current = 0;     ///< The current batch
+    bool zero_copy = false; ///< Indicates if the batches are read directly from the mapping
+
+    /*!
+     * \brief Construct a generator around the given shard file
+     *
+     * The labels are validated against the number of classes of the shard
+     * for categorical generators.
+     *
+     * \param path The path to the shard file
+     * \throw std::runtime_error if the shard cannot be opened or is invalid
+     */
+    explicit mmap_data_generator(const std::string& path) {
+        if (!shard.open(path)) {
+            throw std::runtime_error("Impossible to open shard: " + path);
+        }
+
+        auto& header = shard.header();
+
+        if (header.dimensions != D) {
+            throw std::runtime_error("Invalid number of dimensions in shard: " + path);
+        }
+
+        if (desc::Categorical) {
+            if (!header.classes) {
+                throw std::runtime_error("Categorical labels need the number of classes in shard: " + path);
+            }
+
+            for (size_t i = 0; i < header.samples; ++i) {
+                const float label = *shard.labels(i);
+
+                if (!(label >= 0.0f) || size_t(label) >= header.classes) {
+                    throw std::runtime_error("Invalid label in shard: " + path);
+                }
+            }
+        }
+
+        zero_copy = header.type == uint32_t(shard_type::FLOAT) && !preprocessed;
+
+        if (!zero_copy) {
+            staging_input = make_stage(std::make_index_sequence<D>());
+        }
+
+        if (desc::Categorical) {
+            staging_label = label_stage_t(batch_size, header.classes);
+        }
+
+        order.resize(batches());
+        std::iota(order.begin(), order.end(), 0);
+    }
+
+    mmap_data_generator(const mmap_data_generator& rhs) = delete;
+    mmap_data_generator operator=(const mmap_data_generator& rhs) = delete;
+
+    /*!
+     * \brief Display a description of the generator in the given stream
+     * \param stream The stream to print to
+     * \return stream
+     */
+    std::ostream& display(std::ostream& stream) const {
+        stream << "Memory-Mapped Data Generator" << std::endl;
+        stream << "              Size: " << size() << std::endl;
+        stream << "           Batches: " << batches() << std::endl;
+        stream << "         Zero-Copy: " << (zero_copy ? "yes" : "no") << std::endl;
+
+        return stream;
+    }
+
+    /*!
+     * \brief Display a description of the generator in the standard output.
+     */
+    void display() const {
+        display(std::cout);
+    }
+
+    /*!
+     * \brief Nothing is stored in this generator
+     */
+    void set_safe() {}
+
+    /*!
+     * \brief Nothing is stored in this generator
+     */
+    void clear() {}
+
+    /*!
+     * brief Sets the generator in test mode
+     */
+    void set_test() {
+        // Nothing to do
+    }
+
+    /*!
+     * brief Sets the generator in train mode
+     */
+    void set_train() {
+        // Nothing to do
+    }
+
+    /*!
+     * \brief Reset the generator to the beginning
+     */
+    void reset() {
+        current = 0;
+
+        prefetch();
+    }
+
+    /*!
+     * \brief Reset the generator and shuffle the order of the batches
+     */
+    void reset_shuffle() {
+        current = 0;
+
+        std::shuffle(order.begin(), order.end(), dll::rand_engine());
+
+        prefetch();
+    }
+
+    /*!
+     * \brief Prepare the dataset for an epoch
+     */
+    void prepare_epoch() {
+        // Nothing to do
+    }
+
+    /*!
+     * \brief Return the index of the current batch in the generation
+     * \return The current batch index
+     */
+    size_t current_batch() const {
+        return current;
+    }
+
+    /*!
+     * \brief Returns the number of elements in the generator
+     * \return The number of elements in the generator
+     */
+    size_t size() const {
+        return shard.is_open() ? shard.header().samples : 0;
+    }
+
+    /*!
+     * \brief Returns the augmented number of elements in the generator.
+     * \return The augmented number of elements in the generator
+     */
+    size_t augmented_size() const {
+        return size();
+    }
+
+    /*!
+     * \brief Returns the number of batches in the generator.
+     * \return The number of batches in the generator
+     */
+    size_t batches() const {
+        return size() / batch_size + (size() % batch_size == 0 ? 0 : 1);
+    }
+
+    /*!
+     * \brief Indicates if the generator has a next batch or not
+     * \return true if the generator has a next batch, false otherwise
+     */
+    bool has_next_batch() const {
+        return current < batches();
+    }
+
+    /*!
+     * \brief Moves to the next batch.
+     *
+     * This should only be called if the generator has a next batch.
+     */
+    void next_batch() {
+        ++current;
+
+        prefetch();
+    }
+
+    /*!
+     * \brief Returns the current data batch
+     * \return a a batch of data.
+     */
+    data_batch_t data_batch() const {
+        const size_t first = order[current] * batch_size;
+        const size_t n     = std::min(first + batch_size, size()) - first;
+
+        if (zero_copy) {
+            return make_view(const_cast<weight*>(shard.template data<weight>(first)), n, std::make_index_sequence<D>());
+        }
+
+        if (staged_input != order[current]) {
+            stage_input(first, n);
+            staged_input = order[current];
+        }
+
+        return make_view(staging_input.memory_start(), n, std::make_index_sequence<D>());
+    }
+
+    /*!
+     * \brief Returns the current label batch
+     * \return a a batch of label.
+     */
+    decltype(auto) label_batch() const {
+        return label_batch_impl();
+    }
+
+    /*!
+     * \brief Returns the number of dimensions of the input.
+     * \return The number of dimensions of the input.
+     */
+    static constexpr size_t dimensions() {
+        return D;
+    }
+
+private:
+    /*!
+     * \brief Ask the kernel to start reading the next batch
+     */
+    void prefetch() const {
+        if (current + 1 < batches()) {
+            const size_t first = order[current + 1] * batch_size;
+            shard.prefetch(first, std::min(first + batch_size, size()));
+        }
+    }
+
+    /*!
+     * \brief Create the data staging buffer
+     */
+    template <size_t... I>
+    data_stage_t make_stage(std::index_sequence<I...> /*seq*/) const {
+        return data_stage_t(batch_size, size_t(shard.header().dims[I])...);
+    }
+
+    /*!
+     * \brief Create a data batch view over the given memory
+     */
+    template <size_t... I>
+    data_batch_t make_view(weight* memory, size_t n, std::index_sequence<I...> /*seq*/) const {
+        return data_batch_t(memory, n, size_t(shard.header().dims[I])...);
+    }
+
+    /*!
+     * \brief Convert the given samples into the data staging buffer
+     * \param first The first sample
+     * \param n The number of samples
+     */
+    void stage_input(size_t first, size_t n) const {
+        const size_t sample_size = shard.header().sample_size();
+
+        weight* out = staging_input.memory_start();
+
+        if (shard.header().type == uint32_t(shard_type::UINT8)) {
+            const uint8_t* in = shard.template data<uint8_t>(first);
+            std::transform(in, in + n * sample_size, out, [](uint8_t v) { return weight(v); });
+        } else {
+            const weight* in = shard.template data<weight>(first);
+            std::copy(in, in + n * sample_size, out);
+        }
+
+        staging_input.invalidate_gpu();
+
+        for (size_t i = 0; i < n; ++i) {
+            pre_scaler<desc>::transform(staging_input(i));
+            pre_normalizer<desc>::transform(staging_input(i));
+            pre_binarizer<desc>::transform(staging_input(i));
+        }
+    }
+
+    /*!
+     * \brief Returns the current label batch (auto-encoder)
+     */
+    template <typename DD = desc, cpp_enable_iff(DD::AutoEncoder)>
+    data_batch_t label_batch_impl() const {
+        return data_batch();
+    }
+
+    /*!
+     * \brief Returns the current label batch (categorical)
+     */
+    template <typename DD = desc, cpp_enable_iff(!DD::AutoEncoder && DD::Categorical)>
+    label_batch_t label_batch_impl() const {
+        const size_t first = order[current] * batch_size;
+        const size_t n     = std::min(first + batch_size, size()) - first;
+
+        if (staged_label != order[current]) {
+            staging_label = weight(0);
+
+            for (size_t i = 0; i < n; ++i) {
+                staging_label(i, size_t(*shard.labels(first + i))) = weight(1);
+            }
+
+            staged_label = order[current];
+        }
+
+        return label_batch_t(staging_label.memory_start(), n, size_t(shard.header().classes));
+    }
+
+    /*!
+     * \brief Returns the current label batch (scalar labels)
+     */
+    template <typename DD = desc, cpp_enable_iff(!DD::AutoEncoder && !DD::Categorical)>
+    label_batch_t label_batch_impl() const {
+        const size_t first = order[current] * batch_size;
+        const size_t n     = std::min(first + batch_size, size()) - first;
+
+        return label_batch_t(const_cast<weight*>(shard.labels(first)), n);
+    }
+};
+
+/*!
+ * \brief Display the given generator on the given stream
+ * \param os The output stream
+ * \param generator The generator to display
+ * \return os
+ */
+template <size_t D, typename Desc>
+std::ostream& operator<<(std::ostream& os, mmap_data_generator<D, Desc>& generator) {
+    return generator.display(os);
+}
+
+/*!
+ * \brief Descriptor for a mmap_data_generator
+ */
+template <typename... Parameters>
+struct mmap_data_generator_desc {
+    /*!
+     * A list of all the parameters of the descriptor
+     */
+    using parameters = cpp::type_list<Parameters...>;
+
+    /*!
+     * \brief The size of a batch
+     */
+    static constexpr size_t BatchSize = detail::get_value_v<batch_size<1>, Parameters...>;
+
+    /*!
+     * \brief Indicates if the generators must make the labels categorical
+     */
+    static constexpr bool Categorical = parameters::template contains<categorical>();
+
+    /*!
+     * \brief The scaling
+     */
+    static constexpr size_t ScalePre = detail::get_value_v<scale_pre<0>, Parameters...>;
+
+    /*!
+     * \brief The scaling
+     */
+    static constexpr size_t BinarizePre = detail::get_value_v<binarize_pre<0>, Parameters...>;
+
+    /*!
+     * \brief Indicates if input are normalized
+     */
+    static constexpr bool NormalizePre = parameters::template contains<normalize_pre>();
+
+    /*!
+     * \brief Indicates if this is an auto-encoder task
+     */
+    static constexpr bool AutoEncoder = parameters::template contains<autoencoder>();
+
+    static_assert(BatchSize > 0, "The batch size must be larger than one");
+
+    //Make sure only valid types are passed to the configuration list
+    static_assert(
+        detail::is_valid_v<
+            cpp::type_list<
+                batch_size_id, categorical_id, nop_id, normalize_pre_id, binarize_pre_id, scale_pre_id, autoencoder_id>,
+            Parameters...>,
+        "Invalid parameters type for mmap_data_generator_desc");
+
+    /*!
+     * The generator type
+     *
+     * \tparam D The number of dimensions of one sample
+     */
+    template <size_t D>
+    using generator_t = mmap_data_generator<D, mmap_data_generator_desc<Parameters...>>;
+};
+
+/*!
+ * \brief Make a generator reading batches from a shard file
+ * \param path The path to the shard file
+ * \tparam D The number of dimensions of one sample
+ */
+template <size_t D, typename... Parameters>
+auto make_mmap_generator(const std::string& path, const mmap_data_generator_desc<Parameters...>& /*desc*/) {
+    using generator_t = typename mmap_data_generator_desc<Parameters...>::template generator_t<D>;
+    return std::make_unique<generator_t>(path);
+}
+
+} //end of dll namespace
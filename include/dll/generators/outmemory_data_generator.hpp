@@ -336,6 +336,8 @@ struct outmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_a
     elastic_distorter<Desc> distorter; ///< The elastic distorter
     random_noise<Desc> noiser;         ///< The random noiser
 
+    dll::random_engine engine{dll::stream_seed(dll::new_random_stream())}; ///< The random engine of the augmentation thread
+
     /*!
      * \brief Construct an outmemory_data_generator
      * \param first The iterator on the beginning on data
@@ -354,6 +356,9 @@ struct outmemory_data_generator<Iterator, LIterator, Desc, std::enable_if_t<is_a
         cpp_unused(llast);
 
         main_thread = std::thread([this] {
+            // The augmentation does not depend on the thread running it
+            dll::random_engine_scope engine_scope(engine);
+
             while (true) {
                 // The index of the batch inside the batch cache
                 size_t index = 0;
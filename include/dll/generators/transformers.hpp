@@ -9,9 +9,15 @@
 
 #include <atomic>
 #include <thread>
+#include <cstring>
+#include <algorithm>
 
 #include "cpp_utils/data.hpp"
 
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
 namespace dll {
 
 /*!
@@ -128,4 +134,67 @@ struct pre_normalizer <Desc, std::enable_if_t<!Desc::NormalizePre>> {
     }
 };
 
+namespace detail {
+
+/*!
+ * \brief Expand 8-bit values into floating point values, divided by the
+ * given scale.
+ *
+ * \param in The 8-bit values
+ * \param out The output values
+ * \param n The number of values
+ * \param scale The scale to divide the values by
+ */
+template <typename T>
+void expand_compact(const uint8_t* in, T* out, size_t n, T scale) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = T(in[i]) / scale;
+    }
+}
+
+/*!
+ * \copydoc expand_compact
+ */
+inline void expand_compact(const uint8_t* in, float* out, size_t n, float scale) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256 s = _mm256_set1_ps(scale);
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        _mm256_storeu_ps(out + i, _mm256_div_ps(values, s));
+    }
+#elif defined(__SSE4_1__)
+    const __m128 s = _mm_set1_ps(scale);
+
+    for (; i + 4 <= n; i += 4) {
+        int32_t packed;
+        std::memcpy(&packed, in + i, sizeof(packed));
+
+        __m128 values = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+        _mm_storeu_ps(out + i, _mm_div_ps(values, s));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        out[i] = float(in[i]) / scale;
+    }
+}
+
+/*!
+ * \brief Store a sample into 8-bit storage
+ * \param target The 8-bit sample
+ * \param sample The sample to store
+ */
+template <typename Target, typename Sample>
+void store_compact(Target&& target, const Sample& sample) {
+    for (size_t i = 0; i < etl::size(target); ++i) {
+        target[i] = uint8_t(std::min(std::max(double(sample[i]), 0.0), 255.0) + 0.5);
+    }
+}
+
+} // end of namespace detail
+
 } //end of dll namespace
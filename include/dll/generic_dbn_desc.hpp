@@ -48,6 +48,11 @@ struct generic_dbn_desc {
      */
     static constexpr size_t BigBatchSize = detail::get_value_v<big_batch_size<1>, Parameters...>;
 
+    /*!
+     * \brief The number of threads for data-parallel SGD
+     */
+    static constexpr size_t ParallelSGD = detail::get_value_v<parallel_sgd<1>, Parameters...>;
+
     /*!
      * \brief The pre scaling factor
      */
@@ -99,6 +104,8 @@ struct generic_dbn_desc {
 
     static_assert(BatchSize > 0, "Batch size must be at least 1");
     static_assert(BigBatchSize > 0, "Big Batch size must be at least 1");
+    static_assert(ParallelSGD > 0, "Parallel SGD needs at least 1 thread");
+    static_assert(ParallelSGD <= BatchSize, "Parallel SGD cannot use more threads than samples in a batch");
 
     //Make sure only valid types are passed to the configuration list
     static_assert(
@@ -107,7 +114,8 @@ struct generic_dbn_desc {
                 trainer_id, watcher_id, weight_decay_id, big_batch_size_id, batch_size_id, verbose_id, no_epoch_error_id,
                 batch_mode_id, svm_concatenate_id, svm_scale_id, serial_id, shuffle_id, shuffle_pre_id, loss_id,
                 normalize_pre_id, binarize_pre_id, scale_pre_id, autoencoder_id, updater_id,
-                early_stopping_id, early_training_id, clip_gradients_id>,
+                early_stopping_id, early_training_id, clip_gradients_id, parallel_sgd_id, streaming_pretrain_id, huge_pages_id,
+                pipelined_epoch_error_id>,
             Parameters...>,
         "Invalid parameters type");
 };
@@ -36,6 +36,8 @@ template <typename Parent>
 struct layer {
     using parent_t = Parent; ///< The CRTP parent layer
 
+    static constexpr bool reentrant = true; ///< Indicates that the test forward pass can run concurrently on several threads
+
     //No copying
     layer(const layer& rbm) = delete;
     layer& operator=(const layer& rbm) = delete;
@@ -22,6 +22,8 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
 
     static constexpr size_t Input = desc::Input; ///< The input size
     static constexpr weight e     = 1e-8;        ///< Epsilon for numerical stability
+    static constexpr bool foldable = true; ///< Indicates that the layer can be folded into the previous layer
+    static constexpr bool stateful = true; ///< Indicates that the training updates the running statistics of the layer
 
     using input_one_t  = etl::fast_dyn_matrix<weight, Input>; ///< The type of one input
     using output_one_t = etl::fast_dyn_matrix<weight, Input>; ///< The type of one output
@@ -42,6 +44,8 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
 
     weight momentum = 0.9;
 
+    bool folded = false; ///< Indicates if the layer has been folded into the previous layer
+
     //Backup gamma and beta
     std::unique_ptr<etl::fast_matrix<weight, Input>> bak_gamma; ///< Backup gamma
     std::unique_ptr<etl::fast_matrix<weight, Input>> bak_beta;  ///< Backup beta
@@ -102,6 +106,12 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
      */
     template <typename Input, typename Output>
     void test_forward_batch(Output& output, const Input& input) const {
+        if (folded) {
+            // The normalization is already done by the previous layer
+            output = input;
+            return;
+        }
+
         const auto B = etl::dim<0>(input);
 
         auto inv_var = etl::force_temporary(1.0 / etl::sqrt(var + e));
@@ -111,6 +121,25 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
         }
     }
 
+    /*!
+     * \brief Fold the normalization into the weights and biases of the
+     * given layer, which is the previous layer in the network.
+     *
+     * After this, the layer simply forwards its input in test mode. The
+     * layer should not be trained anymore once folded.
+     *
+     * \param layer The previous layer
+     */
+    template <typename Layer>
+    void fold_into(Layer& layer) {
+        auto scale = etl::force_temporary(gamma / etl::sqrt(var + e));
+        auto shift = etl::force_temporary(beta - (mean >> scale));
+
+        layer.fold_scale_shift(scale, shift);
+
+        folded = true;
+    }
+
     /*!
      * \brief Apply the layer to the batch of input
      * \param output The batch of output
@@ -118,6 +147,8 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
      */
     template <typename Input, typename Output>
     void train_forward_batch(Output& output, const Input& input) {
+        cpp_assert(!folded, "A folded batch normalization layer cannot be trained");
+
         const auto B = etl::dim<0>(input);
 
         last_mean          = etl::mean_l(input);
@@ -157,7 +188,7 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
      */
     template<typename H, typename C>
     void backward_batch(H&& output, C& context) const {
-        const auto B = etl::dim<0>(context.input);
+        const auto B = etl::dim<0>(sgd_input(context));
 
         auto dxhat        = etl::force_temporary(context.errors >> etl::rep_l(gamma, B));
         auto dxhat_l      = etl::force_temporary(etl::sum_l(dxhat));
@@ -235,6 +266,31 @@ struct batch_normalization_2d_layer_impl : neural_layer<batch_normalization_2d_l
         gamma = *bak_gamma;
         beta  = *bak_beta;
     }
+
+    using base_type::store;
+    using base_type::load;
+
+    /*!
+     * \brief Store the weights, the running statistics and the folding state into the given stream
+     */
+    void store(std::ostream& os) const {
+        cpp::binary_write_all(os, gamma);
+        cpp::binary_write_all(os, beta);
+        cpp::binary_write_all(os, mean);
+        cpp::binary_write_all(os, var);
+        cpp::binary_write(os, folded);
+    }
+
+    /*!
+     * \brief Load the weights, the running statistics and the folding state from the given stream
+     */
+    void load(std::istream& is) {
+        cpp::binary_load_all(is, gamma);
+        cpp::binary_load_all(is, beta);
+        cpp::binary_load_all(is, mean);
+        cpp::binary_load_all(is, var);
+        cpp::binary_load(is, folded);
+    }
 };
 
 // Declare the traits for the layer
@@ -36,6 +36,8 @@ struct conv_layer_impl final : neural_layer<conv_layer_impl<Desc>, Desc> {
     static constexpr auto activation_function = desc::activation_function; ///< The activation function
     static constexpr auto no_bias             = desc::parameters::template contains<dll::no_bias>(); ///< Disable the biases
 
+    static constexpr bool absorbs_scale_shift = activation_function == function::IDENTITY; ///< Indicates if a scale and shift of the outputs can be folded into the layer
+
     using w_initializer = typename desc::w_initializer; ///< The initializer for the weights
     using b_initializer = typename desc::b_initializer; ///< The initializer for the biases
 
@@ -51,6 +53,8 @@ struct conv_layer_impl final : neural_layer<conv_layer_impl<Desc>, Desc> {
     w_type w; ///< Weights
     b_type b; ///< Hidden biases
 
+    bool folded_bias = false; ///< Indicates if a bias has been folded into the layer (only used with no_bias)
+
     //Backup weights and biases
     std::unique_ptr<w_type> bak_w; ///< Backup Weights
     std::unique_ptr<b_type> bak_b; ///< Backup Hidden biases
@@ -115,13 +119,7 @@ struct conv_layer_impl final : neural_layer<conv_layer_impl<Desc>, Desc> {
 
         output = etl::ml::convolution_forward(v, w);
 
-        if /*constexpr*/ (!no_bias) {
-            output = bias_add_4d(output, b);
-        }
-
-        if /*constexpr*/ (activation_function != function::IDENTITY) {
-            output = f_activate<activation_function>(output);
-        }
+        f_bias_activate_4d<activation_function>(output, b, !no_bias || folded_bias);
     }
 
     /*!
@@ -136,12 +134,32 @@ struct conv_layer_impl final : neural_layer<conv_layer_impl<Desc>, Desc> {
 
         output = etl::ml::convolution_forward(etl::reshape(v, etl::dim<0>(v), NC, NV1, NV2), w);
 
-        if /*constexpr*/ (!no_bias) {
-            output = bias_add_4d(output, b);
+        f_bias_activate_4d<activation_function>(output, b, !no_bias || folded_bias);
+    }
+
+    /*!
+     * \brief Fold a scale and a shift of each output into the weights and
+     * the biases of the layer.
+     *
+     * This is only valid for layers without activation function
+     * (absorbs_scale_shift).
+     *
+     * \param scale The scale of each output
+     * \param shift The shift of each output
+     */
+    template <typename S, typename T>
+    void fold_scale_shift(const S& scale, const T& shift) {
+        cpp_assert(etl::size(scale) == etl::size(b), "Invalid number of outputs");
+
+        for (size_t k = 0; k < etl::dim<0>(w); ++k) {
+            w(k) *= scale(k);
         }
 
-        if /*constexpr*/ (activation_function != function::IDENTITY) {
-            output = f_activate<activation_function>(output);
+        if (no_bias && !folded_bias) {
+            b           = shift;
+            folded_bias = true;
+        } else {
+            b = (b >> scale) + shift;
         }
     }
 
@@ -211,7 +229,7 @@ struct conv_layer_impl final : neural_layer<conv_layer_impl<Desc>, Desc> {
     void compute_gradients(C& context) const {
         dll::auto_timer timer("conv:compute_gradients");
 
-        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter(context.input, context.errors);
+        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter(sgd_input(context), context.errors);
 
         if /*constexpr*/ (!no_bias) {
             std::get<1>(context.up.context)->grad = etl::bias_batch_sum_4d(context.errors);
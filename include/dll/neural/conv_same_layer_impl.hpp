@@ -38,6 +38,8 @@ struct conv_same_layer_impl final : neural_layer<conv_same_layer_impl<Desc>, Des
 
     static constexpr auto activation_function = desc::activation_function; ///< The layer's activation function
 
+    static constexpr bool absorbs_scale_shift = activation_function == function::IDENTITY; ///< Indicates if a scale and shift of the outputs can be folded into the layer
+
     using w_initializer = typename desc::w_initializer; ///< The initializer for the weights
     using b_initializer = typename desc::b_initializer; ///< The initializer for the biases
 
@@ -113,8 +115,7 @@ struct conv_same_layer_impl final : neural_layer<conv_same_layer_impl<Desc>, Des
         dll::auto_timer timer("conv:forward_batch");
 
         output = etl::ml::convolution_forward<1, 1, P1, P2>(v, w);
-        output = bias_add_4d(output, b);
-        output = f_activate<activation_function>(output);
+        f_bias_activate_4d<activation_function>(output, b);
     }
 
     /*!
@@ -128,8 +129,28 @@ struct conv_same_layer_impl final : neural_layer<conv_same_layer_impl<Desc>, Des
         dll::auto_timer timer("conv:forward_batch");
 
         output = etl::ml::convolution_forward<1, 1, P1, P2>(etl::reshape(v, etl::dim<0>(v), NC, NV1, NV2), w);
-        output = bias_add_4d(output, b);
-        output = f_activate<activation_function>(output);
+        f_bias_activate_4d<activation_function>(output, b);
+    }
+
+    /*!
+     * \brief Fold a scale and a shift of each output into the weights and
+     * the biases of the layer.
+     *
+     * This is only valid for layers without activation function
+     * (absorbs_scale_shift).
+     *
+     * \param scale The scale of each output
+     * \param shift The shift of each output
+     */
+    template <typename S, typename T>
+    void fold_scale_shift(const S& scale, const T& shift) {
+        cpp_assert(etl::size(scale) == etl::size(b), "Invalid number of outputs");
+
+        for (size_t k = 0; k < etl::dim<0>(w); ++k) {
+            w(k) *= scale(k);
+        }
+
+        b = (b >> scale) + shift;
     }
 
     template <typename Input>
@@ -195,7 +216,7 @@ struct conv_same_layer_impl final : neural_layer<conv_same_layer_impl<Desc>, Des
     void compute_gradients(C& context) const {
         dll::auto_timer timer("conv_same:compute_gradients");
 
-        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter<1, 1, P1, P2>(context.input, context.errors);
+        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter<1, 1, P1, P2>(sgd_input(context), context.errors);
         std::get<1>(context.up.context)->grad = etl::bias_batch_sum_4d(context.errors);
     }
 };
@@ -18,7 +18,8 @@ struct dropout_layer_desc {
     static_assert(D < 101, "Invalid dropout factor");
 
     /*!
-     * \brief Drop percentage
+     * \brief Drop percentage. The kept units are scaled by 1 / (1 - Drop / 100)
+     * during training.
      */
     static constexpr size_t Drop  = D;
 
@@ -8,11 +8,18 @@
 #pragma once
 
 #include "dll/transform/transform_layer.hpp"
+#include "dll/util/random.hpp"
+#include "dll/util/timers.hpp"
 
 namespace dll {
 
 /*!
  * \brief Dropout layer
+ *
+ * During training, each unit is dropped with a probability of p (the Drop
+ * percentage of the descriptor) and the kept units are scaled by 1 / (1 - p)
+ * so that the expectation of the output is the input. At test time, the
+ * layer is the identity.
  */
 template <typename Desc>
 struct dropout_layer_impl : transform_layer<dropout_layer_impl<Desc>> {
@@ -61,13 +68,129 @@ struct dropout_layer_impl : transform_layer<dropout_layer_impl<Desc>> {
      */
     template <typename Input, typename Output>
     static void train_forward_batch(Output& output, const Input& input) {
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        auto& g = dll::rand_engine();
+        dll::auto_timer timer("dropout:train:forward");
+
+        using T = etl::value_t<Output>;
+
+        const size_t n = etl::size(input);
+
+        const uint32_t key = mask_key();
+        const T scale      = mask_scale<T>();
 
         output = input;
 
-        for(size_t i = 0; i < etl::size(output); ++i){
-            output[i] = dist(g) < p ? 0.0 : (input[i] / p);
+        // The mask is not needed after the forward pass, it is applied as it is generated
+        for (size_t w = 0; w < (n + 63) / 64; ++w) {
+            const uint64_t bits = mask_word(key, w);
+
+            for (size_t i = w * 64; i < std::min(n, w * 64 + 64); ++i) {
+                output[i] = (bits >> (i % 64)) & 1 ? output[i] * scale : T(0);
+            }
+        }
+    }
+
+    /*!
+     * \brief Apply the layer to the batch of input and keep the mask in the
+     * context for the backward pass. The mask of the context is reused from
+     * batch to batch
+     * \param output The batch of output
+     * \param input The batch of input to apply the layer to
+     * \param context The training context
+     */
+    template <typename Input, typename Output, typename C>
+    static void train_forward_batch(Output& output, const Input& input, C& context) {
+        train_forward_batch(output, input, context.mask);
+    }
+
+    /*!
+     * \brief Generate a new dropout mask and apply it to the batch of input
+     * \param output The batch of output
+     * \param input The batch of input to apply the layer to
+     * \param mask The bitmask of kept units to fill
+     */
+    template <typename Input, typename Output>
+    static void train_forward_batch(Output& output, const Input& input, std::vector<uint64_t>& mask) {
+        dll::auto_timer timer("dropout:train:forward");
+
+        const size_t n = etl::size(input);
+
+        generate_mask(mask, n);
+
+        output = input;
+
+        apply_mask(output, mask, n);
+    }
+
+    /*!
+     * \brief Fill the bitmask with a new random dropout mask.
+     *
+     * The random bits are generated with a counter-based generator, the
+     * global random engine is only used once for the key of the batch.
+     *
+     * \param mask The bitmask to fill (a set bit is a kept unit)
+     * \param n The number of units
+     */
+    static void generate_mask(std::vector<uint64_t>& mask, size_t n) {
+        const uint32_t key = mask_key();
+
+        mask.resize((n + 63) / 64);
+
+        for (size_t w = 0; w < mask.size(); ++w) {
+            mask[w] = mask_word(key, w);
+        }
+    }
+
+    /*!
+     * \brief Draw the key of the mask of a new batch from the random engine
+     */
+    static uint32_t mask_key() {
+        return static_cast<uint32_t>(dll::rand_engine()());
+    }
+
+    /*!
+     * \brief Compute a word of 64 units of the mask
+     * \param key The key of the mask
+     * \param w The index of the word
+     * \return The bits of the word (a set bit is a kept unit)
+     */
+    static uint64_t mask_word(uint32_t key, size_t w) {
+        // The probability to drop a unit in 32-bit fixed-point
+        const uint32_t threshold = static_cast<uint32_t>(std::min(4294967295.0, double(p) * 4294967296.0));
+
+        const uint32_t base = static_cast<uint32_t>(w * 64);
+
+        uint64_t bits = 0;
+
+        for (uint32_t j = 0; j < 64; ++j) {
+            bits |= uint64_t(dll::counter_random(key, base + j) >= threshold) << j;
+        }
+
+        return bits;
+    }
+
+    /*!
+     * \brief Returns the scaling factor of the kept units
+     */
+    template <typename T>
+    static T mask_scale() {
+        // Scale the kept units to keep the same expectation
+        return p < 1.0f ? T(1.0f / (1.0f - p)) : T(0);
+    }
+
+    /*!
+     * \brief Apply the mask to the given values, scaling the kept units
+     * \param values The values to mask
+     * \param mask The bitmask of kept units
+     * \param n The number of units
+     */
+    template <typename V>
+    static void apply_mask(V&& values, const std::vector<uint64_t>& mask, size_t n) {
+        using T = etl::value_t<std::decay_t<V>>;
+
+        const T scale = mask_scale<T>();
+
+        for (size_t i = 0; i < n; ++i) {
+            values[i] = (mask[i / 64] >> (i % 64)) & 1 ? values[i] * scale : T(0);
         }
     }
 
@@ -90,7 +213,12 @@ struct dropout_layer_impl : transform_layer<dropout_layer_impl<Desc>> {
      */
     template<typename H, typename C>
     void backward_batch(H&& output, C& context) const {
+        dll::auto_timer timer("dropout:backward");
+
         output = context.errors;
+
+        // Only the kept units propagate errors
+        apply_mask(output, context.mask, etl::size(output));
     }
 
     /*!
@@ -135,6 +263,8 @@ struct sgd_context<DBN, dropout_layer_impl<Desc>, L> {
     inputs_t output; ///< A batch of output
     inputs_t errors; ///< A batch of errors
 
+    std::vector<uint64_t> mask; ///< The bitmask of the units kept during the last forward pass
+
     sgd_context(layer_t& /*layer*/){}
 };
 
@@ -26,6 +26,8 @@ struct dyn_conv_same_layer_impl final : neural_layer<dyn_conv_same_layer_impl<De
 
     static constexpr auto activation_function = desc::activation_function; ///< The layer's activation function
 
+    static constexpr bool absorbs_scale_shift = activation_function == function::IDENTITY; ///< Indicates if a scale and shift of the outputs can be folded into the layer
+
     using w_initializer = typename desc::w_initializer; ///< The initializer for the weights
     using b_initializer = typename desc::b_initializer; ///< The initializer for the biases
 
@@ -150,8 +152,7 @@ struct dyn_conv_same_layer_impl final : neural_layer<dyn_conv_same_layer_impl<De
         dll::auto_timer timer("conv:forward_batch");
 
         output = etl::ml::convolution_forward(v, w, 1, 1, p1, p2);
-        output = bias_add_4d(output, b);
-        output = f_activate<activation_function>(output);
+        f_bias_activate_4d<activation_function>(output, b);
     }
 
     /*!
@@ -165,8 +166,28 @@ struct dyn_conv_same_layer_impl final : neural_layer<dyn_conv_same_layer_impl<De
         dll::auto_timer timer("conv:forward_batch");
 
         output = etl::ml::convolution_forward(etl::reshape(v, etl::dim<0>(v), nc, nv1, nv2), w, 1, 1, p1, p2);
-        output = bias_add_4d(output, b);
-        output = f_activate<activation_function>(output);
+        f_bias_activate_4d<activation_function>(output, b);
+    }
+
+    /*!
+     * \brief Fold a scale and a shift of each output into the weights and
+     * the biases of the layer.
+     *
+     * This is only valid for layers without activation function
+     * (absorbs_scale_shift).
+     *
+     * \param scale The scale of each output
+     * \param shift The shift of each output
+     */
+    template <typename S, typename T>
+    void fold_scale_shift(const S& scale, const T& shift) {
+        cpp_assert(etl::size(scale) == etl::size(b), "Invalid number of outputs");
+
+        for (size_t k = 0; k < etl::dim<0>(w); ++k) {
+            w(k) *= scale(k);
+        }
+
+        b = (b >> scale) + shift;
     }
 
     void prepare_input(input_one_t& input) const {
@@ -241,7 +262,7 @@ struct dyn_conv_same_layer_impl final : neural_layer<dyn_conv_same_layer_impl<De
      */
     template<typename C>
     void compute_gradients(C& context) const {
-        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter(context.input, context.errors, 1, 1, p1, p2);
+        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter(sgd_input(context), context.errors, 1, 1, p1, p2);
         std::get<1>(context.up.context)->grad = etl::bias_batch_sum_4d(context.errors);
     }
 };
@@ -26,6 +26,8 @@ struct dyn_dense_layer_impl final : neural_layer<dyn_dense_layer_impl<Desc>, Des
     static constexpr auto activation_function = desc::activation_function;                           ///< The layer's activation function
     static constexpr auto no_bias             = desc::parameters::template contains<dll::no_bias>(); ///< Disable the biases
 
+    static constexpr bool absorbs_scale_shift = activation_function == function::IDENTITY; ///< Indicates if a scale and shift of the outputs can be folded into the layer
+
     using w_initializer = typename desc::w_initializer; ///< The initializer for the weights
     using b_initializer = typename desc::b_initializer; ///< The initializer for the biases
 
@@ -41,6 +43,8 @@ struct dyn_dense_layer_impl final : neural_layer<dyn_dense_layer_impl<Desc>, Des
     w_type w; ///< Weights
     b_type b; ///< Hidden biases
 
+    bool folded_bias = false; ///< Indicates if a bias has been folded into the layer (only used with no_bias)
+
     //Backup Weights and biases
     std::unique_ptr<w_type> bak_w; ///< Backup Weights
     std::unique_ptr<b_type> bak_b; ///< Backup Hidden biases
@@ -118,11 +122,30 @@ struct dyn_dense_layer_impl final : neural_layer<dyn_dense_layer_impl<Desc>, Des
 
         output = etl::reshape(input, Batch, num_visible) * w;
 
-        if /*constexpr*/ (!no_bias) {
-            output = bias_add_2d(output, b);
-        }
+        f_bias_activate_2d<activation_function>(output, b, !no_bias || folded_bias);
+    }
 
-        output = f_activate<activation_function>(output);
+    /*!
+     * \brief Fold a scale and a shift of each output into the weights and
+     * the biases of the layer.
+     *
+     * This is only valid for layers without activation function
+     * (absorbs_scale_shift).
+     *
+     * \param scale The scale of each output
+     * \param shift The shift of each output
+     */
+    template <typename S, typename T>
+    void fold_scale_shift(const S& scale, const T& shift) {
+        cpp_assert(etl::size(scale) == etl::size(b), "Invalid number of outputs");
+
+        w = w >> etl::rep_l(scale, etl::dim<0>(w));
+        if (no_bias && !folded_bias) {
+            b           = shift;
+            folded_bias = true;
+        } else {
+            b = (b >> scale) + shift;
+        }
     }
 
     /*!
@@ -199,7 +222,7 @@ struct dyn_dense_layer_impl final : neural_layer<dyn_dense_layer_impl<Desc>, Des
     void compute_gradients(C& context) const {
         dll::auto_timer timer("dyn_dense:compute_gradients");
 
-        std::get<0>(context.up.context)->grad = batch_outer(context.input, context.errors);
+        std::get<0>(context.up.context)->grad = batch_outer(sgd_input(context), context.errors);
 
         if /*constexpr*/ (!no_bias) {
             std::get<1>(context.up.context)->grad = bias_batch_sum_2d(context.errors);
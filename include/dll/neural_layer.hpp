@@ -81,7 +81,7 @@ struct neural_layer : layer<Derived> {
      */
     void store(const std::string& file) const {
         std::ofstream os(file, std::ofstream::binary);
-        store(os);
+        as_derived().store(os);
     }
 
     /*!
@@ -89,7 +89,7 @@ struct neural_layer : layer<Derived> {
      */
     void load(const std::string& file) {
         std::ifstream is(file, std::ifstream::binary);
-        load(is);
+        as_derived().load(is);
     }
 
     /*!
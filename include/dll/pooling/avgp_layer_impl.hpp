@@ -81,7 +81,7 @@ struct avgp_2d_layer_impl final : pooling_2d_layer<avgp_2d_layer_impl<Desc>, Des
         static constexpr size_t C2 = base::C2; ///< The pooling second dimension
         static constexpr size_t C3 = base::C3; ///< The pooling second dimension
 
-        output = etl::ml::avg_pool_backward<C1, C2, C3>(context.input, context.output, context.errors);
+        output = etl::ml::avg_pool_backward<C1, C2, C3>(sgd_input(context), context.output, context.errors);
     }
 
     /*!
@@ -207,7 +207,7 @@ struct avgp_3d_layer_impl final : pooling_3d_layer<avgp_3d_layer_impl<Desc>, Des
         static constexpr size_t C2 = base::C2; ///< The pooling second dimension
         static constexpr size_t C3 = base::C3; ///< The pooling third dimension
 
-        output = etl::ml::avg_pool_3d_backward<C1, C2, C3>(context.input, context.output, context.errors);
+        output = etl::ml::avg_pool_3d_backward<C1, C2, C3>(sgd_input(context), context.output, context.errors);
     }
 
     /*!
@@ -81,7 +81,7 @@ struct dyn_avgp_2d_layer_impl final : dyn_pooling_2d_layer<dyn_avgp_2d_layer_imp
         size_t c1 = base::c1;
         size_t c2 = base::c2;
 
-        output = etl::ml::avg_pool_backward(context.input, context.output, context.errors, c1, c2);
+        output = etl::ml::avg_pool_backward(sgd_input(context), context.output, context.errors, c1, c2);
     }
 
     /*!
@@ -203,7 +203,7 @@ struct dyn_avgp_3d_layer_impl final : dyn_pooling_3d_layer<dyn_avgp_3d_layer_imp
         size_t c2 = base::c2;
         size_t c3 = base::c3;
 
-        output = etl::ml::avg_pool_3d_backward(context.input, context.output, context.errors, c1, c2, c3);
+        output = etl::ml::avg_pool_3d_backward(sgd_input(context), context.output, context.errors, c1, c2, c3);
     }
 
     /*!
@@ -86,7 +86,7 @@ struct mp_2d_layer_impl final : pooling_2d_layer<mp_2d_layer_impl<Desc>, Desc> {
         static constexpr size_t C1 = base::C1; ///< The pooling first dimension
         static constexpr size_t C2 = base::C2; ///< The pooling second dimension
 
-        output = etl::ml::max_pool_backward<C1, C2>(context.input, context.output, context.errors);
+        output = etl::ml::max_pool_backward<C1, C2>(sgd_input(context), context.output, context.errors);
     }
 
     /*!
@@ -216,7 +216,7 @@ struct mp_3d_layer_impl final : pooling_3d_layer<mp_3d_layer_impl<Desc>, Desc> {
         static constexpr size_t C2 = base::C2; ///< The pooling second dimension
         static constexpr size_t C3 = base::C3; ///< The pooling third dimension
 
-        output = etl::ml::max_pool_3d_backward<C1, C2, C3>(context.input, context.output, context.errors);
+        output = etl::ml::max_pool_3d_backward<C1, C2, C3>(sgd_input(context), context.output, context.errors);
     }
 
     /*!
@@ -23,6 +23,7 @@
 #include "dll/neural/conv_layer.hpp"
 #include "dll/dbn.hpp"
 #include "dll/text_reader.hpp"
+#include "dll/test.hpp"
 
 #include "mnist/mnist_reader.hpp"
 #include "mnist/mnist_utils.hpp"
@@ -37,6 +38,11 @@ struct options {
     bool cublas = false;
     bool cufft  = false;
     bool cache  = false;
+
+    bool runtime = false; ///< Run the precompiled networks without compilation when possible
+
+    std::string cache_dir;  ///< The directory of the compilation cache (empty for the default)
+    size_t cache_size = 64; ///< The maximum number of binaries in the compilation cache
 };
 
 template <typename LastLayer, typename Enable = void>
@@ -105,6 +111,7 @@ struct training_desc {
     double l2_weight_cost = stupid_default;
 
     std::string trainer = "none";
+    std::string updater = "none";
 
     bool verbose = false;
 };
@@ -321,22 +328,14 @@ void execute(DBN& dbn, task& task, const std::vector<std::string>& actions) {
 
             auto classes = dbn.output_size();
 
-            etl::dyn_matrix<size_t, 2> conf(classes, classes, 0.0);
+            // Batched (and parallel) evaluation of the test set
+            auto conf = dll::test_confusion(dbn, test_samples, test_labels);
 
             size_t n  = test_samples.size();
             size_t tp = 0;
 
-            for (size_t i = 0; i < test_samples.size(); ++i) {
-                auto sample = test_samples[i];
-                auto label  = test_labels[i];
-
-                auto predicted = dbn.predict(sample);
-
-                if (predicted == label) {
-                    ++tp;
-                }
-
-                ++conf(label, predicted);
+            for (size_t l = 0; l < classes; ++l) {
+                tp += conf(l, l);
             }
 
             double test_error = (n - tp) / double(n);
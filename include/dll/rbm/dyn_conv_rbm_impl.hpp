@@ -243,7 +243,7 @@ struct dyn_conv_rbm_impl final : public standard_crbm<dyn_conv_rbm_impl<Desc>, D
      */
     template<typename C>
     void compute_gradients(C& context) const {
-        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter(context.input, context.errors);
+        std::get<0>(context.up.context)->grad = etl::ml::convolution_backward_filter(sgd_input(context), context.errors);
         std::get<1>(context.up.context)->grad = etl::bias_batch_sum_4d(context.errors);
     }
 
@@ -219,7 +219,7 @@ struct dyn_rbm_impl final : public standard_rbm<dyn_rbm_impl<Desc>, Desc> {
      */
     template<typename C>
     void compute_gradients(C& context) const {
-        std::get<0>(context.up.context)->grad = batch_outer(context.input, context.errors);
+        std::get<0>(context.up.context)->grad = batch_outer(sgd_input(context), context.errors);
         std::get<1>(context.up.context)->grad = bias_batch_sum_2d(context.errors);
     }
 };
@@ -323,8 +323,8 @@ struct cg_context<dyn_rbm_impl<Desc>> {
     etl::dyn_matrix<weight, 2> gr_w_tmp;
     etl::dyn_matrix<weight, 1> gr_b_tmp;
 
-    std::vector<etl::dyn_vector<weight>> gr_probs_a;
-    std::vector<etl::dyn_vector<weight>> gr_probs_s;
+    etl::dyn_matrix<weight, 2> gr_probs_a;
+    etl::dyn_matrix<weight, 2> gr_diffs;
 
     cg_context(size_t num_visible, size_t num_hidden) :
         gr_w_incs(num_visible, num_hidden), gr_b_incs(num_hidden),
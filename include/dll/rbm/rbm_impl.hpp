@@ -184,7 +184,7 @@ struct rbm_impl final : public standard_rbm<rbm_impl<Desc>, Desc> {
      */
     template<typename C>
     void compute_gradients(C& context) const {
-        std::get<0>(context.up.context)->grad = batch_outer(context.input, context.errors);
+        std::get<0>(context.up.context)->grad = batch_outer(sgd_input(context), context.errors);
         std::get<1>(context.up.context)->grad = bias_batch_sum_2d(context.errors);
     }
 };
@@ -302,8 +302,8 @@ struct cg_context<rbm_impl<Desc>> {
     etl::fast_matrix<weight, num_visible, num_hidden> gr_w_tmp;
     etl::fast_vector<weight, num_hidden> gr_b_tmp;
 
-    std::vector<etl::dyn_vector<weight>> gr_probs_a;
-    std::vector<etl::dyn_vector<weight>> gr_probs_s;
+    etl::dyn_matrix<weight, 2> gr_probs_a;
+    etl::dyn_matrix<weight, 2> gr_diffs;
 };
 
 } //end of dll namespace
@@ -68,6 +68,14 @@ struct standard_conv_rbm : public rbm_base<Parent, Desc> {
         reconstruct(items, as_derived());
     }
 
+    /*!
+     * \brief Initalize the weights using the training inputs
+     */
+    template <typename Generator>
+    void init_weights(Generator& generator) {
+        init_weights(generator, as_derived());
+    }
+
     /*!
      * \brief Display the current visible unit activations
      */
@@ -147,6 +155,56 @@ struct standard_conv_rbm : public rbm_base<Parent, Desc> {
         return free_energy(as_derived().v1);
     }
 
+    /*!
+     * \brief Compute the energy of each joint configuration of the given batch
+     * \param v The batch of inputs
+     * \param h The batch of outputs
+     * \param e The energies to fill (one per sample)
+     */
+    template <typename V, typename H, typename E, cpp_enable_iff(etl::dimensions<V>() == 4)>
+    void batch_energy(const V& v, const H& h, E&& e) const {
+        as_derived().batch_energy_impl(v, h, e);
+    }
+
+    /*!
+     * \copydoc batch_energy
+     */
+    template <typename V, typename H, typename E, cpp_enable_iff(etl::dimensions<V>() == 2)>
+    void batch_energy(const V& v, const H& h, E&& e) const {
+        decltype(auto) rbm = as_derived();
+        rbm.batch_energy_impl(etl::reshape(v, etl::dim<0>(v), get_nc(rbm), get_nv1(rbm), get_nv2(rbm)), h, e);
+    }
+
+    /*!
+     * \brief Compute the free energy of each input of the given batch
+     * \param v The batch of inputs
+     * \param f The free energies to fill (one per sample)
+     */
+    template <typename V, typename F, cpp_enable_iff(etl::dimensions<V>() == 4)>
+    void batch_free_energy(const V& v, F&& f) const {
+        as_derived().batch_free_energy_impl(v, f);
+    }
+
+    /*!
+     * \copydoc batch_free_energy
+     */
+    template <typename V, typename F, cpp_enable_iff(etl::dimensions<V>() == 2)>
+    void batch_free_energy(const V& v, F&& f) const {
+        decltype(auto) rbm = as_derived();
+        rbm.batch_free_energy_impl(etl::reshape(v, etl::dim<0>(v), get_nc(rbm), get_nv1(rbm), get_nv2(rbm)), f);
+    }
+
+    /*!
+     * \brief Return the sum of the free energies of the inputs of the given batch
+     * \param v The batch of inputs
+     */
+    template <typename V>
+    weight batch_free_energy(const V& v) const {
+        etl::dyn_vector<weight> f(etl::dim<0>(v));
+        batch_free_energy(v, f);
+        return etl::sum(f);
+    }
+
     friend base_type;
 
 private:
@@ -170,6 +228,49 @@ private:
         return etl::mean((rbm.v1 - rbm.v2_a) >> (rbm.v1 - rbm.v2_a));
     }
 
+    /*!
+     * \brief Initalize the weights using the training inputs
+     *
+     * The visible biases are shared by all the units of a channel, they are
+     * initialized from the mean activation of the units of the channel.
+     */
+    template <typename Generator>
+    static void init_weights(Generator& generator, parent_t& rbm) {
+        const size_t nc = get_nc(rbm);
+        const size_t nv = get_nv1(rbm) * get_nv2(rbm);
+
+        // Count the activations of all the visible units in one pass
+
+        std::vector<size_t> counts(nc, 0);
+
+        generator.reset();
+
+        while (generator.has_next_batch()) {
+            auto labels = generator.label_batch();
+
+            for (size_t b = 0; b < etl::dim<0>(labels); ++b) {
+                for (size_t channel = 0; channel < nc; ++channel) {
+                    for (size_t i = 0; i < nv; ++i) {
+                        if (labels(b)[channel * nv + i] == 1) {
+                            ++counts[channel];
+                        }
+                    }
+                }
+            }
+
+            generator.next_batch();
+        }
+
+        //Initialize the visible biases to log(pi/(1-pi))
+        for (size_t channel = 0; channel < nc; ++channel) {
+            auto pi = static_cast<double>(counts[channel]) / (generator.size() * nv);
+            pi += 0.0001;
+            rbm.c(channel) = log(pi / (1.0 - pi));
+
+            cpp_assert(std::isfinite(rbm.c(channel)), "NaN verify");
+        }
+    }
+
     /*!
      * \brief Reconstruct the given input
      */
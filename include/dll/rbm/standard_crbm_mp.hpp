@@ -351,6 +351,56 @@ private:
         }
     }
 
+    template <typename V, typename H, typename E>
+    void batch_energy_impl(const V& v, const H& h, E&& e) const {
+        dll::auto_timer timer("crbm:mp:batch_energy");
+
+        const auto B = etl::dim<0>(v);
+
+        // A single convolution for the whole batch
+        auto tmp = etl::force_temporary(etl::conv_4d_valid_flipped(v, as_derived().w));
+
+        auto b_rep = as_derived().get_b_rep();
+
+        if /*constexpr*/ (desc::visible_unit == unit_type::BINARY && desc::hidden_unit == unit_type::BINARY) {
+            for (size_t i = 0; i < B; ++i) {
+                e[i] = -etl::sum(as_derived().c >> etl::sum_r(v(i))) - etl::sum((h(i) >> tmp(i)) + (b_rep >> h(i)));
+            }
+        } else if /*constexpr*/ (desc::visible_unit == unit_type::GAUSSIAN && desc::hidden_unit == unit_type::BINARY) {
+            auto c_rep = as_derived().get_c_rep();
+
+            for (size_t i = 0; i < B; ++i) {
+                e[i] = sum(etl::pow(v(i) - c_rep, 2) / 2.0) - etl::sum((h(i) >> tmp(i)) + (b_rep >> h(i)));
+            }
+        } else {
+            e = 0.0;
+        }
+    }
+
+    template <typename V, typename F>
+    void batch_free_energy_impl(const V& v, F&& f) const {
+        dll::auto_timer timer("crbm:mp:batch_free_energy");
+
+        const auto B = etl::dim<0>(v);
+
+        // A single convolution for the whole batch
+        auto x = etl::force_temporary(as_derived().get_batch_b_rep(v) + etl::conv_4d_valid_flipped(v, as_derived().w));
+
+        if /*constexpr*/ (desc::visible_unit == unit_type::BINARY && desc::hidden_unit == unit_type::BINARY) {
+            for (size_t i = 0; i < B; ++i) {
+                f[i] = -etl::sum(as_derived().c >> etl::sum_r(v(i))) - etl::sum(etl::log(1.0 + etl::exp(x(i))));
+            }
+        } else if /*constexpr*/ (desc::visible_unit == unit_type::GAUSSIAN && desc::hidden_unit == unit_type::BINARY) {
+            auto c_rep = as_derived().get_c_rep();
+
+            for (size_t i = 0; i < B; ++i) {
+                f[i] = -sum(etl::pow(v(i) - c_rep, 2) / 2.0) - etl::sum(etl::log(1.0 + etl::exp(x(i))));
+            }
+        } else {
+            f = 0.0;
+        }
+    }
+
     /*!
      * \brief Returns a reference to the derived object, i.e. the object using the CRTP injector.
      * \return a reference to the derived object.
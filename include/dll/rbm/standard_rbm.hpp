@@ -21,12 +21,66 @@
 
 #include "dll/util/checks.hpp"    //NaN checks
 #include "dll/util/timers.hpp"    //auto_timer
+#include "dll/util/random.hpp"    //counter_random
 #include "dll/rbm/rbm_base.hpp"       //The base class
 #include "dll/base_conf.hpp"      //Descriptor configuration
 #include "dll/rbm/rbm_tmp.hpp"        // static_if macros
 
 namespace dll {
 
+namespace detail {
+
+/*!
+ * \brief Add the biases to a batch of pre-activations, apply the sigmoid and
+ * sample the binary states, in a single pass.
+ *
+ * The random numbers are drawn from a counter-based generator, keyed once
+ * per batch from the DLL random engine.
+ *
+ * \param x The batch of pre-activations, replaced by the probabilities (if P)
+ * \param s The batch of samples to fill (if S), can be the same as x
+ * \param bias The biases
+ */
+template <bool P, bool S, typename X, typename XS, typename B>
+void batch_sigmoid_bernoulli(X& x, XS& s, const B& bias) {
+    using T = etl::value_t<X>;
+
+    const size_t N = etl::dim<0>(x);
+    const size_t M = etl::size(bias);
+
+    const uint32_t key = S ? static_cast<uint32_t>(dll::rand_engine()()) : 0;
+
+    x.ensure_cpu_up_to_date();
+    bias.ensure_cpu_up_to_date();
+
+    T* xm       = x.memory_start();
+    T* sm       = s.memory_start();
+    const T* bm = bias.memory_start();
+
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t j = 0; j < M; ++j) {
+            const size_t k = i * M + j;
+            const T p      = T(1) / (T(1) + std::exp(-(xm[k] + bm[j])));
+
+            if (P) {
+                xm[k] = p;
+            }
+
+            if (S) {
+                // Uniform number in [0, 1)
+                const T u = T(dll::counter_random(key, uint32_t(k))) * T(2.3283064365386963e-10);
+
+                sm[k] = u < p ? T(1) : T(0);
+            }
+        }
+    }
+
+    x.invalidate_gpu();
+    s.invalidate_gpu();
+}
+
+} // end of namespace detail
+
 /*!
  * \brief Standard version of Restricted Boltzmann Machine
  *
@@ -92,6 +146,38 @@ struct standard_rbm : public rbm_base<Parent, Desc> {
         return free_energy(rbm, rbm.v1);
     }
 
+    /*!
+     * \brief Compute the energy of each joint configuration of the given batch
+     * \param v The batch of inputs
+     * \param h The batch of outputs
+     * \param e The energies to fill (one per sample)
+     */
+    template <typename V, typename H, typename E>
+    void batch_energy(const V& v, const H& h, E&& e) const {
+        batch_energy(as_derived(), v, h, std::forward<E>(e));
+    }
+
+    /*!
+     * \brief Compute the free energy of each input of the given batch
+     * \param v The batch of inputs
+     * \param f The free energies to fill (one per sample)
+     */
+    template <typename V, typename F>
+    void batch_free_energy(const V& v, F&& f) const {
+        batch_free_energy(as_derived(), v, std::forward<F>(f));
+    }
+
+    /*!
+     * \brief Return the sum of the free energies of the inputs of the given batch
+     * \param v The batch of inputs
+     */
+    template <typename V>
+    weight batch_free_energy(const V& v) const {
+        etl::dyn_vector<weight> f(etl::dim<0>(v));
+        batch_free_energy(as_derived(), v, f);
+        return etl::sum(f);
+    }
+
     //Various functions
 
     /*!
@@ -176,6 +262,23 @@ struct standard_rbm : public rbm_base<Parent, Desc> {
 
     // batch_activate_hidden
 
+    /*!
+     * \brief Compute the hidden representation from the given batch of input.
+     *
+     * Special functions to be used by optimizer.
+     *
+     * \param h_a The batch output to set the activation probabilities of the hidden representation
+     * \param h_s The batch output to set the activation samples of the hidden representation
+     * \param v_a The batch input activation probabilities of the visible representation
+     * \param v_s The batch input the activation samples of the visible representation
+     * \param b The biases
+     * \param w The weights
+     */
+    template <bool P = true, bool S = true, typename H1, typename H2, typename V, typename B, typename W>
+    void batch_activate_hidden(H1&& h_a, H2&& h_s, const V& v_a, const V& v_s, const B& b, const W& w) const {
+        batch_std_activate_hidden<P, S>(std::forward<H1>(h_a), std::forward<H2>(h_s), v_a, v_s, b, w);
+    }
+
     /*!
      * \brief Compute the hidden representation from the given input
      * \param h_a The batch output to set the activation probabilities of the hidden representation
@@ -311,25 +414,38 @@ private:
     static void init_weights(Generator& generator, parent_t& rbm) {
         const auto size = generator.size();
 
-        //Initialize the visible biases to log(pi/(1-pi))
-        for (size_t i = 0; i < num_visible(rbm); ++i) {
-            generator.reset();
+        // Count the activations of all the visible units in one pass
 
-            size_t count = 0;
+        std::vector<size_t> counts(num_visible(rbm), 0);
 
-            while(generator.has_next_batch()){
-                auto labels = generator.label_batch();
+        generator.reset();
 
-                for(size_t b = 0; b < etl::dim<0>(labels); ++b){
+        while(generator.has_next_batch()){
+            auto labels = generator.label_batch();
+
+            for(size_t b = 0; b < etl::dim<0>(labels); ++b){
+                for (size_t i = 0; i < num_visible(rbm); ++i) {
                     if(labels(b)[i] == 1){
-                        ++count;
+                        ++counts[i];
                     }
                 }
-
-                generator.next_batch();
             }
 
-            auto pi = static_cast<double>(count) / size;
+            generator.next_batch();
+        }
+
+        init_visible_biases(counts, size, rbm);
+    }
+
+    /*!
+     * \brief Initialize the visible biases to log(pi/(1-pi)) from the
+     * activation counts of the visible units
+     * \param counts The number of activations of each visible unit
+     * \param size The number of samples
+     */
+    static void init_visible_biases(const std::vector<size_t>& counts, size_t size, parent_t& rbm) {
+        for (size_t i = 0; i < num_visible(rbm); ++i) {
+            auto pi = static_cast<double>(counts[i]) / size;
             pi += 0.0001;
             rbm.c(i) = log(pi / (1.0 - pi));
 
@@ -342,19 +458,23 @@ private:
      */
     template <typename Iterator>
     static void init_weights(Iterator first, Iterator last, parent_t& rbm) {
-        auto size = std::distance(first, last);
+        const size_t size = std::distance(first, last);
 
-        //Initialize the visible biases to log(pi/(1-pi))
-        for (size_t i = 0; i < num_visible(rbm); ++i) {
-            auto count = std::count_if(first, last,
-                                       [i](auto& a) { return a[i] == 1; });
+        // Count the activations of all the visible units in one pass
 
-            auto pi = static_cast<double>(count) / size;
-            pi += 0.0001;
-            rbm.c(i) = log(pi / (1.0 - pi));
+        std::vector<size_t> counts(num_visible(rbm), 0);
 
-            cpp_assert(std::isfinite(rbm.c(i)), "NaN verify");
+        for (; first != last; ++first) {
+            auto& a = *first;
+
+            for (size_t i = 0; i < num_visible(rbm); ++i) {
+                if (a[i] == 1) {
+                    ++counts[i];
+                }
+            }
         }
+
+        init_visible_biases(counts, size, rbm);
     }
 
     /*!
@@ -490,6 +610,44 @@ private:
         }
     }
 
+    // The batch versions compute the products of all the samples with a single GEMM
+
+    template <typename V, typename H, typename E>
+    void batch_energy(const parent_t& rbm, const V& v, const H& h, E&& e) const {
+        dll::auto_timer timer("rbm:std:batch_energy");
+
+        const auto B = etl::dim<0>(v);
+
+        auto rv = etl::reshape(v, B, as_derived().num_visible);
+        auto x  = etl::force_temporary(etl::rep_l(rbm.b, B) + rv * rbm.w);
+
+        if /*constexpr*/ (visible_unit == unit_type::BINARY && hidden_unit == unit_type::BINARY) {
+            e = -(rv * rbm.c) - (h * rbm.b) - etl::sum_r(x);
+        } else if /*constexpr*/ (visible_unit == unit_type::GAUSSIAN && hidden_unit == unit_type::BINARY) {
+            e = etl::sum_r(etl::pow(rv - etl::rep_l(rbm.c, B), 2) / 2.0) - (h * rbm.b) - etl::sum_r(x);
+        } else {
+            e = 0.0;
+        }
+    }
+
+    template <typename V, typename F>
+    void batch_free_energy(const parent_t& rbm, const V& v, F&& f) const {
+        dll::auto_timer timer("rbm:std:batch_free_energy");
+
+        const auto B = etl::dim<0>(v);
+
+        auto rv = etl::reshape(v, B, as_derived().num_visible);
+        auto x  = etl::force_temporary(etl::rep_l(rbm.b, B) + rv * rbm.w);
+
+        if /*constexpr*/ (visible_unit == unit_type::BINARY && hidden_unit == unit_type::BINARY) {
+            f = -(rv * rbm.c) - etl::sum_r(etl::log(1.0 + etl::exp(x)));
+        } else if /*constexpr*/ (visible_unit == unit_type::GAUSSIAN && hidden_unit == unit_type::BINARY) {
+            f = etl::sum_r(etl::pow(rv - etl::rep_l(rbm.c, B), 2) / 2.0) - etl::sum_r(etl::log(1.0 + etl::exp(x)));
+        } else {
+            f = 0.0;
+        }
+    }
+
     template <bool P = true, bool S = true, typename H1, typename H2, typename V, typename B, typename W, cpp_enable_iff((etl::decay_traits<V>::dimensions() != 1))>
     void std_activate_hidden(H1&& h_a, H2&& h_s, const V& v_a, const V&, const B& b, const W& w) const {
         auto r = reshape(v_a, as_derived().num_visible);
@@ -565,7 +723,11 @@ private:
 
         cpp_assert(etl::dim<0>(h_s) == Batch && etl::dim<0>(v_a) == Batch, "The number of batch must be consistent");
 
-        H_PROBS(unit_type::BINARY, f(h_a) = etl::sigmoid(rep_l(b, Batch) + v_a * w));
+        // Binary units: One GEMM followed by a single pass for the bias, the sigmoid and the sampling
+        cpp::static_if<hidden_unit == unit_type::BINARY>([&](auto f) {
+            batch_std_sigmoid<P, S>(f(h_a), f(h_s), v_a * w, b);
+        });
+
         H_PROBS(unit_type::RELU, f(h_a) = max(rep_l(b, Batch) + v_a * w, 0.0));
         H_PROBS(unit_type::RELU1, f(h_a) = min(max(rep_l(b, Batch) + v_a * w, 0.0), 1.0));
         H_PROBS(unit_type::RELU6, f(h_a) = min(max(rep_l(b, Batch) + v_a * w, 0.0), 6.0));
@@ -579,7 +741,6 @@ private:
             }
         });
 
-        H_SAMPLE_PROBS(unit_type::BINARY, f(h_s) = bernoulli(h_a));
         H_SAMPLE_PROBS(unit_type::RELU, f(h_s) = max(logistic_noise(rep_l(b, Batch) + v_a * w), 0.0));
         H_SAMPLE_PROBS(unit_type::RELU1, f(h_s) = min(max(ranged_noise(rep_l(b, Batch) + v_a * w, 1.0), 0.0), 1.0));
         H_SAMPLE_PROBS(unit_type::RELU6, f(h_s) = min(max(ranged_noise(rep_l(b, Batch) + v_a * w, 6.0), 0.0), 6.0));
@@ -590,7 +751,6 @@ private:
             }
         });
 
-        H_SAMPLE_INPUT(unit_type::BINARY, f(h_s) = bernoulli(etl::sigmoid(rep_l(b, Batch) + v_a * w)));
         H_SAMPLE_INPUT(unit_type::RELU, f(h_s) = max(logistic_noise(rep_l(b, Batch) + v_a * w), 0.0));
         H_SAMPLE_INPUT(unit_type::RELU1, f(h_s) = min(max(ranged_noise(rep_l(b, Batch) + v_a * w, 1.0), 0.0), 1.0));
         H_SAMPLE_INPUT(unit_type::RELU6, f(h_s) = min(max(ranged_noise(rep_l(b, Batch) + v_a * w, 6.0), 0.0), 6.0));
@@ -622,11 +782,14 @@ private:
 
         cpp_assert(etl::dim<0>(h_s) == Batch && etl::dim<0>(v_a) == Batch, "The number of batch must be consistent");
 
-        V_PROBS(unit_type::BINARY, f(v_a) = etl::sigmoid(rep_l(c, Batch) + transpose(w * transpose(h_s))));
+        // Binary units: One GEMM followed by a single pass for the bias, the sigmoid and the sampling
+        cpp::static_if<visible_unit == unit_type::BINARY>([&](auto f) {
+            batch_std_sigmoid<P, !P && S>(f(v_a), f(v_s), h_s * transpose(w), c);
+        });
+
         V_PROBS(unit_type::GAUSSIAN, f(v_a) = rep_l(c, Batch) + transpose(w * transpose(h_s)));
         V_PROBS(unit_type::RELU, f(v_a) = max(rep_l(c, Batch) + transpose(w * transpose(h_s)), 0.0));
 
-        V_SAMPLE_INPUT(unit_type::BINARY, f(v_s) = bernoulli(etl::sigmoid(rep_l(c, Batch) + transpose(w * transpose(h_s)))));
         V_SAMPLE_INPUT(unit_type::GAUSSIAN, f(v_s) = normal_noise(rep_l(c, Batch) + transpose(w * transpose(h_s))));
         V_SAMPLE_INPUT(unit_type::RELU, f(v_s) = logistic_noise(max(rep_l(c, Batch) + transpose(w * transpose(h_s)), 0.0)));
 
@@ -639,6 +802,49 @@ private:
         }
     }
 
+    /*!
+     * \brief Compute the probabilities and/or the samples of a batch of binary
+     * units from the product of their inputs by the weights.
+     *
+     * The product is computed once, directly in the output, and the biases,
+     * the sigmoid and the sampling are then applied in a single pass.
+     *
+     * \param x_a The batch of probabilities to compute (if P)
+     * \param x_s The batch of samples to compute (if S)
+     * \param product The product of the inputs by the weights
+     * \param bias The biases
+     */
+    template <bool P, bool S, typename X1, typename X2, typename E, typename B,
+              cpp_enable_iff(etl::decay_traits<X1>::is_direct && etl::decay_traits<X2>::is_direct)>
+    static void batch_std_sigmoid(X1&& x_a, X2&& x_s, E&& product, const B& bias) {
+        if (P) {
+            x_a = product;
+            detail::batch_sigmoid_bernoulli<true, S>(x_a, x_s, bias);
+        } else if (S) {
+            x_s = product;
+            detail::batch_sigmoid_bernoulli<false, true>(x_s, x_s, bias);
+        }
+    }
+
+    /*!
+     * \copydoc batch_std_sigmoid
+     */
+    template <bool P, bool S, typename X1, typename X2, typename E, typename B,
+              cpp_disable_if(etl::decay_traits<X1>::is_direct && etl::decay_traits<X2>::is_direct)>
+    static void batch_std_sigmoid(X1&& x_a, X2&& x_s, E&& product, const B& bias) {
+        const auto Batch = etl::dim<0>(product);
+
+        if (P) {
+            x_a = etl::sigmoid(etl::rep_l(bias, Batch) + product);
+
+            if (S) {
+                x_s = etl::bernoulli(x_a);
+            }
+        } else if (S) {
+            x_s = etl::bernoulli(etl::sigmoid(etl::rep_l(bias, Batch) + product));
+        }
+    }
+
     /*!
      * \brief Returns a reference to the derived object, i.e. the object using the CRTP injector.
      * \return a reference to the derived object.
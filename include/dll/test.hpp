@@ -7,7 +7,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
 #include "cpp_utils/stop_watch.hpp"
+#include "cpp_utils/parallel.hpp"
+
+#include "etl/etl.hpp"
+
+#include "dll/dbn_traits.hpp"
 
 namespace dll {
 
@@ -56,13 +66,135 @@ struct label_predictor {
     }
 };
 
-template <typename DBN, typename Functor, typename Samples, typename Labels>
-double test_set(DBN& dbn, const Samples& images, const Labels& labels, Functor&& f) {
-    return test_set(dbn, images.begin(), images.end(), labels.begin(), labels.end(), std::forward<Functor>(f));
+namespace test_detail {
+
+/*!
+ * \brief Create a batch of n samples of the same shape as the given sample
+ */
+template <typename Sample, size_t... I>
+auto make_batch(const Sample& sample, size_t n, std::index_sequence<I...>) {
+    return etl::dyn_matrix<etl::value_t<Sample>, sizeof...(I) + 1>(n, etl::dim(sample, I)...);
+}
+
+/*!
+ * \brief Accumulate the confusion matrix of the given batches of samples
+ *
+ * \param dbn The network
+ * \param first Iterator to the first sample
+ * \param lfirst Iterator to the first label
+ * \param n The number of samples
+ * \param batches The indices of the batches to process
+ * \param confusion The confusion matrix to update
+ */
+template <typename DBN, typename Iterator, typename LIterator>
+void confusion_batches(const DBN& dbn, Iterator first, LIterator lfirst, size_t n, const std::vector<size_t>& batches, etl::dyn_matrix<size_t, 2>& confusion) {
+    using sample_t = std::decay_t<decltype(*first)>;
+
+    constexpr size_t B = std::decay_t<DBN>::batch_size;
+    constexpr size_t D = etl::decay_traits<sample_t>::dimensions();
+
+    if (batches.empty()) {
+        return;
+    }
+
+    auto forward = [&](auto& batch, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            batch(i - begin) = first[i];
+        }
+
+        auto output = dbn.test_forward_batch(batch);
+
+        for (size_t i = begin; i < end; ++i) {
+            ++confusion(size_t(lfirst[i]), dbn.predict_label(output(i - begin)));
+        }
+    };
+
+    auto full_batch = make_batch(*first, B, std::make_index_sequence<D>());
+
+    for (auto b : batches) {
+        const size_t begin = b * B;
+        const size_t end   = std::min(begin + B, n);
+
+        if (end - begin == B) {
+            forward(full_batch, begin, end);
+        } else {
+            // Only the last batch can be partial
+            auto batch = make_batch(*first, end - begin, std::make_index_sequence<D>());
+            forward(batch, begin, end);
+        }
+    }
+}
+
+} // end of namespace test_detail
+
+/*!
+ * \brief Compute the confusion matrix of the network on the given samples.
+ *
+ * The samples are forwarded through the network in batches of the batch
+ * size of the network. The batches are split between several threads, each
+ * accumulating its own confusion matrix. The batches are evaluated by the
+ * current thread when the network is serial or when one of its layers cannot
+ * be evaluated concurrently (see layer::reentrant).
+ *
+ * \param dbn The network
+ * \param first Iterator to the first sample
+ * \param last Iterator to the past-the-end sample
+ * \param lfirst Iterator to the first label
+ *
+ * \return The confusion matrix, indexed by label and then by prediction
+ */
+template <typename DBN, typename Iterator, typename LIterator>
+etl::dyn_matrix<size_t, 2> test_confusion(const DBN& dbn, Iterator first, Iterator last, LIterator lfirst) {
+    constexpr size_t B = std::decay_t<DBN>::batch_size;
+
+    const size_t classes = dbn.output_size();
+    const size_t n       = std::distance(first, last);
+    const size_t batches = (n + B - 1) / B;
+
+    constexpr bool parallel = !dbn_traits<std::decay_t<DBN>>::is_serial() && std::decay_t<DBN>::layers_t::is_reentrant;
+
+    const size_t threads = parallel ? std::max<size_t>(1, std::min<size_t>(etl::threads, batches)) : 1;
+
+    std::vector<etl::dyn_matrix<size_t, 2>> confusions;
+    std::vector<std::vector<size_t>> thread_batches(threads);
+
+    for (size_t t = 0; t < threads; ++t) {
+        confusions.emplace_back(classes, classes, size_t(0));
+    }
+
+    for (size_t b = 0; b < batches; ++b) {
+        thread_batches[b % threads].push_back(b);
+    }
+
+    if (threads == 1) {
+        test_detail::confusion_batches(dbn, first, lfirst, n, thread_batches[0], confusions[0]);
+    } else {
+        cpp::default_thread_pool<> pool(threads);
+
+        cpp::parallel_foreach_n(pool, 0, threads, [&](size_t t) {
+            test_detail::confusion_batches(dbn, first, lfirst, n, thread_batches[t], confusions[t]);
+        });
+    }
+
+    for (size_t t = 1; t < threads; ++t) {
+        confusions[0] += confusions[t];
+    }
+
+    return confusions[0];
 }
 
+/*!
+ * \copydoc test_confusion
+ */
+template <typename DBN, typename Samples, typename Labels>
+etl::dyn_matrix<size_t, 2> test_confusion(const DBN& dbn, const Samples& samples, const Labels& labels) {
+    return test_confusion(dbn, samples.begin(), samples.end(), labels.begin());
+}
+
+namespace test_detail {
+
 template <typename DBN, typename Functor, typename Iterator, typename LIterator>
-double test_set(DBN& dbn, Iterator first, Iterator last, LIterator lfirst, LIterator /*llast*/, Functor&& f) {
+double test_set(DBN& dbn, Iterator first, Iterator last, LIterator lfirst, Functor&& f, std::false_type /*batch*/) {
     size_t success = 0;
     size_t images  = 0;
 
@@ -84,6 +216,44 @@ double test_set(DBN& dbn, Iterator first, Iterator last, LIterator lfirst, LIter
     return (images - success) / static_cast<double>(images);
 }
 
+template <typename DBN, typename Functor, typename Iterator, typename LIterator>
+double test_set(DBN& dbn, Iterator first, Iterator last, LIterator lfirst, Functor&& /*f*/, std::true_type /*batch*/) {
+    auto confusion = test_confusion(*dbn, first, last, lfirst);
+
+    size_t success = 0;
+
+    for (size_t l = 0; l < etl::dim<0>(confusion); ++l) {
+        success += confusion(l, l);
+    }
+
+    const size_t images = std::distance(first, last);
+
+    return (images - success) / static_cast<double>(images);
+}
+
+} // end of namespace test_detail
+
+template <typename DBN, typename Functor, typename Samples, typename Labels>
+double test_set(DBN& dbn, const Samples& images, const Labels& labels, Functor&& f) {
+    return test_set(dbn, images.begin(), images.end(), labels.begin(), labels.end(), std::forward<Functor>(f));
+}
+
+/*!
+ * \brief Compute the error rate of the network on the given samples.
+ *
+ * With the default predictor and random access iterators, the samples are
+ * evaluated in parallel batches (see test_confusion).
+ */
+template <typename DBN, typename Functor, typename Iterator, typename LIterator>
+double test_set(DBN& dbn, Iterator first, Iterator last, LIterator lfirst, LIterator /*llast*/, Functor&& f) {
+    using batch = std::integral_constant<bool,
+              std::is_same<std::decay_t<Functor>, predictor>::value
+          &&  std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>::value
+          &&  std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<LIterator>::iterator_category>::value>;
+
+    return test_detail::test_set(dbn, first, last, lfirst, std::forward<Functor>(f), batch());
+}
+
 template <typename DBN, typename Samples>
 double test_set_ae(DBN& dbn, const Samples& images) {
     return test_set_ae(dbn, images.begin(), images.end());
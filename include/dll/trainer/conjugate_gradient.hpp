@@ -18,23 +18,23 @@
 
 #include <utility>
 
-#include "dll/util/batch.hpp"
+#include "dll/util/timers.hpp"
 
 namespace dll {
 
 /*!
  * \brief The context of the gradient search for a batch
  */
-template <typename Sample, typename Label>
+template <typename Inputs, typename Targets>
 struct gradient_context {
-    size_t max_iterations; ///< The maximum number of iterations
-    size_t epoch;          ///< The current epoch
-    batch<Sample> inputs;  ///< The inputs
-    batch<Label> targets;  ///< The targets
-    size_t start_layer;    ///< The index of the starting layer
-
-    gradient_context(batch<Sample> i, batch<Label> t, size_t e)
-            : max_iterations(5), epoch(e), inputs(std::move(i)), targets(std::move(t)), start_layer(0) {
+    size_t max_iterations;  ///< The maximum number of iterations
+    size_t epoch;           ///< The current epoch
+    const Inputs& inputs;   ///< The batch of inputs
+    const Targets& targets; ///< The batch of targets
+    size_t start_layer;     ///< The index of the starting layer
+
+    gradient_context(const Inputs& i, const Targets& t, size_t e)
+            : max_iterations(5), epoch(e), inputs(i), targets(t), start_layer(0) {
         //Nothing else to init
     }
 };
@@ -71,12 +71,8 @@ struct cg_trainer_base {
             auto& ctx = rbm.get_cg_context();
 
             if (ctx.is_trained) {
-                const auto n_hidden = num_hidden(rbm);
-
-                for (size_t i = 0; i < batch_size; ++i) {
-                    ctx.gr_probs_a.emplace_back(n_hidden);
-                    ctx.gr_probs_s.emplace_back(n_hidden);
-                }
+                ctx.gr_probs_a = etl::dyn_matrix<weight, 2>(batch_size, num_hidden(rbm));
+                ctx.gr_diffs   = etl::dyn_matrix<weight, 2>(batch_size, num_hidden(rbm));
             }
         });
     }
@@ -92,21 +88,7 @@ struct cg_trainer_base {
      */
     template <typename Inputs, typename Labels>
     std::pair<double, double> train_batch(size_t epoch, const Inputs& inputs, const Labels& labels) {
-        using T = etl::dyn_matrix<etl::value_t<Inputs>, etl::decay_traits<Inputs>::dimensions() - 1>;
-        using L = etl::dyn_matrix<etl::value_t<Labels>, etl::decay_traits<Labels>::dimensions() - 1>;
-
-        std::vector<T> inputs_cache(etl::dim<0>(inputs));
-        std::vector<L> labels_cache(etl::dim<0>(labels));
-
-        for(size_t i = 0; i < etl::dim<0>(inputs); ++i){
-            inputs_cache[i] = inputs(i);
-            labels_cache[i] = labels(i);
-        }
-
-        gradient_context<decltype(inputs_cache.begin()), decltype(labels_cache.begin())> context(
-            make_batch(inputs_cache.begin(), inputs_cache.end()),
-            make_batch(labels_cache.begin(), labels_cache.end()),
-            epoch);
+        gradient_context<Inputs, Labels> context(inputs, labels, epoch);
 
         minimize(context);
 
@@ -116,167 +98,114 @@ struct cg_trainer_base {
 
     /* Gradient */
 
-    template <bool Temp, typename R1, typename R2, typename C1, typename C2, typename D>
-    static void update_diffs(R1&, R2& r2, C1& c1, C2& c2, std::vector<D>& diffs, size_t n_samples) {
-        auto n_visible = num_visible(r2);
-        auto n_hidden  = num_hidden(r2);
-
-        for (size_t sample = 0; sample < n_samples; ++sample) {
-            D diff(n_visible);
-
-            for (size_t i = 0; i < n_visible; ++i) {
-                double s = 0.0;
-                for (size_t j = 0; j < n_hidden; ++j) {
-                    s += diffs[sample][j] * (Temp ? c2.gr_w_tmp(i, j) : r2.w(i, j));
-                }
-
-                if (R1::hidden_unit != unit_type::RELU) {
-                    s *= c1.gr_probs_a[sample][i] * (1.0 - c1.gr_probs_a[sample][i]);
-                }
+    /*!
+     * \brief Backpropagate the batch of differences of the layer r2 to the
+     * layer r1
+     */
+    template <bool Temp, typename R1, typename R2>
+    static void update_diffs(R1& r1, R2& r2) {
+        auto& c1 = r1.get_cg_context();
+        auto& c2 = r2.get_cg_context();
 
-                diff[i] = s;
-            }
+        c1.gr_diffs = c2.gr_diffs * etl::transpose(Temp ? c2.gr_w_tmp : r2.w);
 
-            diffs[sample].swap(diff);
+        if (R1::hidden_unit != unit_type::RELU) {
+            c1.gr_diffs = c1.gr_diffs >> c1.gr_probs_a >> (1.0 - c1.gr_probs_a);
         }
     }
 
-    template <bool Temp, typename R, typename D, typename V>
-    static void update_incs(R& r, std::vector<D>& diffs, const V& visibles) {
+    /*!
+     * \brief Compute the gradients of the given layer from its batch of
+     * differences and its batch of inputs
+     */
+    template <typename R, typename V>
+    static void update_incs(R& r, const V& visibles) {
         auto& ctx = r.get_cg_context();
 
-        auto n_visible = num_visible(r);
-        auto n_hidden  = num_hidden(r);
-
-        auto it            = visibles.begin();
-        auto end           = visibles.end();
-        size_t sample = 0;
-
-        while (it != end) {
-            auto& v = *it;
-            auto& d = diffs[sample];
-
-            for (size_t i = 0; i < n_visible; ++i) {
-                for (size_t j = 0; j < n_hidden; ++j) {
-                    ctx.gr_w_incs(i, j) += v[i] * d[j];
-                }
-            }
-
-            for (size_t j = 0; j < n_hidden; ++j) {
-                ctx.gr_b_incs(j) += d[j];
-            }
-
-            ++it;
-            ++sample;
-        }
+        ctx.gr_w_incs = batch_outer(visibles, ctx.gr_diffs);
+        ctx.gr_b_incs = bias_batch_sum_2d(ctx.gr_diffs);
     }
 
     /*!
      * \brief Compute the gradient of one context
+     *
+     * The complete batch is propagated at once through each layer and
+     * the state is kept in the CG contexts of the layers.
+     *
      * \param contex The current gradient context
      * \param cost The current cost
      */
-    template <bool Temp, typename Sample, typename Target>
-    void gradient(const gradient_context<Sample, Target>& context, weight& cost) {
-        const auto n_hidden = output_size(dbn.template layer_get<layers - 1>());
-        auto n_samples      = context.inputs.size();
+    template <bool Temp, typename Inputs, typename Targets>
+    void gradient(const gradient_context<Inputs, Targets>& context, weight& cost) {
+        dll::auto_timer timer("cg:gradient");
 
-        static std::vector<std::vector<weight>> diffs;
-        diffs.resize(n_samples);
+        auto& first = dbn.template layer_get<0>();
+        auto& last  = dbn.template layer_get<layers - 1>();
 
-        dbn.for_each_layer([](auto& rbm) {
-            rbm.get_cg_context().gr_w_incs = 0.0;
-            rbm.get_cg_context().gr_b_incs = 0.0;
+        const size_t n_samples = etl::dim<0>(context.inputs);
+        const size_t n_hidden  = num_hidden(last);
+
+        // The last batch of the epoch may be smaller
+        dbn.for_each_layer([n_samples](auto& rbm) {
+            auto& ctx = rbm.get_cg_context();
+
+            if (ctx.is_trained && etl::dim<0>(ctx.gr_probs_a) != n_samples) {
+                ctx.gr_probs_a = etl::dyn_matrix<weight, 2>(n_samples, num_hidden(rbm));
+                ctx.gr_diffs   = etl::dyn_matrix<weight, 2>(n_samples, num_hidden(rbm));
+            }
         });
 
-        cost         = 0.0;
-        weight error = 0.0;
+        auto inputs  = etl::reshape(context.inputs, n_samples, num_visible(first));
+        auto targets = etl::reshape(context.targets, n_samples, n_hidden);
 
-        auto it  = context.inputs.begin();
-        auto end = context.inputs.end();
-        auto tit = context.targets.begin();
+        // Forward propagation of the batch
 
-        size_t sample = 0;
+        {
+            auto& ctx = first.get_cg_context();
 
-        while (it != end) {
-            auto& input  = *it;
-            auto output  = std::ref(dbn.template layer_get<0>().get_cg_context().gr_probs_a[sample]);
-            auto& target = *tit;
+            first.template batch_activate_hidden<true, false>(ctx.gr_probs_a, ctx.gr_probs_a, inputs, inputs, Temp ? ctx.gr_b_tmp : first.b, Temp ? ctx.gr_w_tmp : first.w);
+        }
 
-            dbn.for_each_layer_i([&input, &output, sample](size_t I, auto& rbm) {
-                auto& ctx        = rbm.get_cg_context();
-                auto& output_ref = static_cast<etl::dyn_vector<weight>&>(output);
+        dbn.for_each_layer_pair([](auto& r1, auto& r2) {
+            auto& c1 = r1.get_cg_context();
+            auto& c2 = r2.get_cg_context();
 
-                if (I == 0) {
-                    rbm.activate_hidden(output_ref, ctx.gr_probs_s[sample], input, input, Temp ? ctx.gr_b_tmp : rbm.b, Temp ? ctx.gr_w_tmp : rbm.w);
-                } else {
-                    rbm.activate_hidden(ctx.gr_probs_a[sample], ctx.gr_probs_s[sample], output_ref, output_ref, Temp ? ctx.gr_b_tmp : rbm.b, Temp ? ctx.gr_w_tmp : rbm.w);
-                    output = std::ref(ctx.gr_probs_a[sample]);
-                }
-            });
+            r2.template batch_activate_hidden<true, false>(c2.gr_probs_a, c2.gr_probs_a, c1.gr_probs_a, c1.gr_probs_a, Temp ? c2.gr_b_tmp : r2.b, Temp ? c2.gr_w_tmp : r2.w);
+        });
 
-            auto& diff = diffs[sample];
-            diff.resize(n_hidden);
+        auto& result = last.get_cg_context().gr_probs_a;
+        auto& diffs  = last.get_cg_context().gr_diffs;
 
-            auto& result = dbn.template layer_get<layers - 1>().get_cg_context().gr_probs_a[sample];
-            weight scale = std::accumulate(result.begin(), result.end(), 0.0);
+        for (size_t sample = 0; sample < n_samples; ++sample) {
+            result(sample) /= etl::sum(result(sample));
+        }
 
-            for (auto& r : result) {
-                r *= (1.0 / scale);
-            }
+        diffs = result - targets;
 
-            for (size_t i = 0; i < n_hidden; ++i) {
-                diff[i] = result[i] - target[i];
-                cost += target[i] * log(result[i]);
-                error += diff[i] * diff[i];
-            }
+        cost = -etl::sum(targets >> etl::log(result));
 
-            ++it;
-            ++tit;
-            ++sample;
-        }
+        // Backward propagation of the differences
 
-        cost = -cost;
+        update_incs(last, dbn.template layer_get<layers - 2>().get_cg_context().gr_probs_a);
 
         //Get pointers to the different gr_probs
-        std::array<std::vector<etl::dyn_vector<weight>>*, layers> probs_refs;
+        std::array<const etl::dyn_matrix<weight, 2>*, layers> probs_refs;
         dbn.for_each_layer_i([&probs_refs](size_t I, auto& rbm) {
             probs_refs[I] = &rbm.get_cg_context().gr_probs_a;
         });
 
-        update_incs<Temp>(dbn.template layer_get<layers - 1>(), diffs, dbn.template layer_get<layers - 2>().get_cg_context().gr_probs_a);
-
-#ifdef __clang__
-        dbn.for_each_layer_rpair_i([n_samples, &probs_refs](size_t I, auto& r1, auto& r2) {
-            auto& c1 = r1.get_cg_context();
-            auto& c2 = r2.get_cg_context();
-
-            this_type::update_diffs<Temp>(r1, r2, c1, c2, diffs, n_samples);
-
-            if (I > 0) {
-                this_type::update_incs<Temp>(r1, diffs, *probs_refs[I - 1]);
-            }
-        });
-
-#else
-        std::vector<std::vector<weight>>& diffs_p = diffs;
-
-        dbn.for_each_layer_rpair_i([&diffs_p, n_samples, &probs_refs](size_t I, auto& r1, auto& r2) {
-            auto& c1 = r1.get_cg_context();
-            auto& c2 = r2.get_cg_context();
-
-            this_type::update_diffs<Temp>(r1, r2, c1, c2, diffs_p, n_samples);
+        dbn.for_each_layer_rpair_i([&probs_refs](size_t I, auto& r1, auto& r2) {
+            this_type::update_diffs<Temp>(r1, r2);
 
             if (I > 0) {
-                this_type::update_incs<Temp>(r1, diffs_p, *probs_refs[I - 1]);
+                this_type::update_incs(r1, *probs_refs[I - 1]);
             }
         });
-#endif
 
-        update_incs<Temp>(dbn.template layer_get<0>(), diffs, context.inputs);
+        update_incs(first, inputs);
 
         if (Debug) {
-            std::cout << "evaluating(" << Temp << "): cost:" << cost << " error: " << (error / n_samples) << std::endl;
+            std::cout << "evaluating(" << Temp << "): cost:" << cost << " error: " << (etl::sum(diffs >> diffs) / n_samples) << std::endl;
         }
     }
 
@@ -389,8 +318,8 @@ struct cg_trainer_base {
     /*!
      * \brief Minimize the gradient of the given context
      */
-    template <typename Sample, typename Target>
-    void minimize(const gradient_context<Sample, Target>& context) {
+    template <typename Inputs, typename Targets>
+    void minimize(const gradient_context<Inputs, Targets>& context) {
         constexpr weight INT   = 0.1;       //Don't reevaluate within 0.1 of the limit of the current bracket
         constexpr weight EXT   = 3.0;       //Extrapolate maximum 3 times the current step-size
         constexpr weight SIG   = 0.1;       //Maximum allowed maximum ration between previous and new slopes
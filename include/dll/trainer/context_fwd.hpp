@@ -22,6 +22,35 @@ namespace dll {
 template <typename DBN, typename Layer, size_t L>
 struct sgd_context;
 
+/*!
+ * \brief Return the input of a layer from its SGD context.
+ *
+ * When the input of the layer is shared with the output of the previous
+ * layer, this returns the output of the previous layer.
+ *
+ * \param context The SGD context of the layer
+ */
+template <typename Context>
+auto sgd_input(Context& context, int /*prefer*/) -> decltype(*context.shared_input) {
+    return context.shared_input ? *context.shared_input : context.input;
+}
+
+/*!
+ * \copydoc sgd_input
+ */
+template <typename Context>
+auto& sgd_input(Context& context, long /*fallback*/) {
+    return context.input;
+}
+
+/*!
+ * \copydoc sgd_input
+ */
+template <typename Context>
+decltype(auto) sgd_input(Context& context) {
+    return sgd_input(context, 0);
+}
+
 /*!
  * \brief The context of a RBM during CG training
  * \tparam RBM The RBM.
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <limits>
+#include <sstream>
+#include <thread>
+
 #include "cpp_utils/algorithm.hpp" // For parallel_shuffle
 
 #include "etl/etl.hpp"
@@ -32,6 +36,20 @@ struct dbn_trainer {
     using weight     = typename dbn_t::weight; ///< The data type for this layer
     using error_type = typename dbn_t::weight; ///< The error type
 
+    /*!
+     * \brief Indicates if the validation metrics are computed in the
+     * background, while the next epoch is trained.
+     *
+     * This needs a snapshot of the weights and is therefore not possible
+     * with dynamic networks, whose validation metrics are computed directly.
+     */
+    static constexpr bool pipelined_validation =
+            dbn_traits<dbn_t>::pipelined_epoch_error()
+        &&  dbn_traits<dbn_t>::error_on_epoch()
+        &&  !dbn_traits<dbn_t>::is_dynamic();
+
+    static constexpr size_t no_epoch = std::numeric_limits<size_t>::max(); ///< Marker for no pending epoch
+
     /*!
      * \brief The trainer for the given RBM
      */
@@ -60,6 +78,31 @@ struct dbn_trainer {
     size_t best_epoch     = 0;   ///< The best epoch
     size_t patience       = 0;   ///< The current patience
 
+    // With pipelined validation, the validation metrics of an epoch are
+    // computed on a snapshot of the weights while the next epoch is
+    // trained. The end of an epoch is therefore only processed at the end
+    // of the next one and the best weights are backed up in the snapshot.
+
+    std::unique_ptr<dbn_t> snapshot;                ///< The snapshot of the weights of the pending epoch
+    std::thread validation_thread;                  ///< The thread computing the validation metrics
+    size_t pending_epoch = no_epoch;                ///< The epoch whose validation metrics are being computed
+    std::pair<double, double> pending_train_stats;  ///< The training metrics of the pending epoch
+    std::pair<double, double> pending_val_stats;    ///< The validation metrics of the pending epoch
+
+    dbn_trainer() = default;
+
+    dbn_trainer(const dbn_trainer& rhs) = delete;
+    dbn_trainer& operator=(const dbn_trainer& rhs) = delete;
+
+    /*!
+     * \brief Wait for the background validation, if any
+     */
+    ~dbn_trainer(){
+        if (validation_thread.joinable()) {
+            validation_thread.join();
+        }
+    }
+
     /*!
      * \brief Initialize the training
      * \param dbn The network to train
@@ -85,6 +128,9 @@ struct dbn_trainer {
 
         current_val_error = 0.0;
         current_val_loss = 0.0;
+
+        snapshot.reset();
+        pending_epoch = no_epoch;
     }
 
     /*!
@@ -105,7 +151,9 @@ struct dbn_trainer {
 
             if /*constexpr*/ (s != strategy::NONE) {
                 if(best_epoch < max_epochs - 1){
-                    dbn.restore_weights();
+                    epoch_weights(dbn).restore_weights();
+
+                    sync_weights(dbn);
 
                     if (is_error(s)) {
                         std::cout << "Restore the best (error) weights from epoch " << best_epoch << std::endl;
@@ -157,14 +205,14 @@ struct dbn_trainer {
                     best_error = error;
                     best_epoch = epoch;
 
-                    dbn.backup_weights();
+                    epoch_weights(dbn).backup_weights();
                 }
             } else {
                 if(!epoch || loss < best_loss){
                     best_loss = loss;
                     best_epoch = epoch;
 
-                    dbn.backup_weights();
+                    epoch_weights(dbn).backup_weights();
                 }
             }
         }
@@ -178,7 +226,7 @@ struct dbn_trainer {
                     std::cout << "Stopping: Loss below goal";
 
                     if(epoch != best_epoch){
-                        dbn.restore_weights();
+                        epoch_weights(dbn).restore_weights();
 
                         std::cout << ", restore weights from epoch " << best_epoch;
                     }
@@ -194,7 +242,7 @@ struct dbn_trainer {
                     std::cout << "Stopping: Error below goal";
 
                     if(epoch != best_epoch){
-                        dbn.restore_weights();
+                        epoch_weights(dbn).restore_weights();
 
                         std::cout << ", restore weights from epoch " << best_epoch;
                     }
@@ -213,7 +261,7 @@ struct dbn_trainer {
                         std::cout << "Stopping: Loss has been increasing for " << dbn.patience << " epochs";
 
                         if (epoch != best_epoch) {
-                            dbn.restore_weights();
+                            epoch_weights(dbn).restore_weights();
 
                             std::cout << ", restore weights from epoch " << best_epoch;
                         }
@@ -235,7 +283,7 @@ struct dbn_trainer {
                         std::cout << "Stopping: Error has been increasing for " << dbn.patience << " epochs";
 
                         if (epoch != best_epoch) {
-                            dbn.restore_weights();
+                            epoch_weights(dbn).restore_weights();
 
                             std::cout << ", restore weights from epoch " << best_epoch;
                         }
@@ -257,7 +305,7 @@ struct dbn_trainer {
                         std::cout << "Stopping: Loss has been increasing (from best) for " << dbn.patience << " epochs";
 
                         if (epoch != best_epoch) {
-                            dbn.restore_weights();
+                            epoch_weights(dbn).restore_weights();
 
                             std::cout << ", restore weights from epoch " << best_epoch;
                         }
@@ -279,7 +327,7 @@ struct dbn_trainer {
                         std::cout << "Stopping: Error has been increasing (from best) for " << dbn.patience << " epochs";
 
                         if (epoch != best_epoch) {
-                            dbn.restore_weights();
+                            epoch_weights(dbn).restore_weights();
 
                             std::cout << ", restore weights from epoch " << best_epoch;
                         }
@@ -307,10 +355,7 @@ struct dbn_trainer {
      * \return true if the training is over
      */
     bool stop_epoch(dbn_t& dbn, size_t epoch, double error, double loss){
-        //After some time increase the momentum
-        if (dbn_traits<dbn_t>::updater() == updater_type::MOMENTUM && epoch == dbn.final_momentum_epoch) {
-            dbn.momentum = dbn.final_momentum;
-        }
+        update_momentum(dbn, epoch);
 
         watcher.ft_epoch_end(epoch, error, loss, dbn);
 
@@ -333,12 +378,35 @@ struct dbn_trainer {
      * \return true if the training is over
      */
     bool stop_epoch(dbn_t& dbn, size_t epoch, const std::pair<double, double>& train_stats, const std::pair<double, double>& val_stats){
-        double error = train_stats.first;
+        update_momentum(dbn, epoch);
 
+        return end_epoch(dbn, epoch, train_stats, val_stats);
+    }
+
+    /*!
+     * \brief Update the momentum at the end of an epoch
+     * \param dbn The network that is trained
+     * \param epoch The current epoch
+     */
+    void update_momentum(dbn_t& dbn, size_t epoch){
         //After some time increase the momentum
         if (dbn_traits<dbn_t>::updater() == updater_type::MOMENTUM && epoch == dbn.final_momentum_epoch) {
             dbn.momentum = dbn.final_momentum;
         }
+    }
+
+    /*!
+     * \brief Process the metrics of an epoch and decide to stop, or not, the
+     * training
+     *
+     * \param dbn The network that is trained
+     * \param epoch The epoch of the metrics
+     * \param train_stats The training error and loss
+     * \param val_stats The validation error and loss
+     * \return true if the training is over
+     */
+    bool end_epoch(dbn_t& dbn, size_t epoch, const std::pair<double, double>& train_stats, const std::pair<double, double>& val_stats){
+        double error = train_stats.first;
 
         watcher.ft_epoch_end(epoch, error, train_stats.second, val_stats.first, val_stats.second, dbn);
 
@@ -390,12 +458,17 @@ struct dbn_trainer {
      * \brief Train the network for one epoch
      * \param generator The generator for training data
      * \param epoch The current epoch
+     * \return a pair containing the (error, loss) of the training batches
      */
     template<typename Generator>
-    void train_epoch_only(dbn_t& dbn, Generator& generator, size_t epoch){
+    std::pair<double, double> train_epoch_only(dbn_t& dbn, Generator& generator, size_t epoch){
         // Set the generator in train mode
         generator.set_train();
 
+        double error = 0.0;
+        double loss  = 0.0;
+        size_t n     = 0;
+
         //Train one mini-batch at a time
         while(generator.has_next_batch()){
             dll::auto_timer timer("dbn::trainer::train::epoch::batch");
@@ -404,19 +477,56 @@ struct dbn_trainer {
                 watcher.ft_batch_start(epoch, dbn);
             }
 
+            decltype(auto) data_batch = generator.data_batch();
+
             double batch_error;
             double batch_loss;
             std::tie(batch_error, batch_loss) = trainer->train_batch(
                 epoch,
-                generator.data_batch(),
+                data_batch,
                 generator.label_batch());
 
             if /*constexpr*/ (dbn_traits<dbn_t>::is_verbose()){
                 watcher.ft_batch_end(epoch, generator.current_batch(), generator.batches(), batch_error, batch_loss, dbn);
             }
 
+            // The metrics of the batches are normalized by their size
+            const size_t b = etl::dim<0>(data_batch);
+
+            error += batch_error * b;
+            loss += batch_loss * b;
+            n += b;
+
             generator.next_batch();
         }
+
+        if (n) {
+            error /= n;
+            loss /= n;
+        }
+
+        return std::make_pair(error, loss);
+    }
+
+    /*!
+     * \brief Compute the training error and loss of an epoch.
+     *
+     * With pipelined epoch error, these are the metrics of the training
+     * batches, computed during the epoch, instead of a new pass over the
+     * training set.
+     *
+     * \param dbn The network being trained
+     * \param generator The generator for training data
+     * \param batch_stats The metrics of the training batches
+     * \return a pair containing (error, loss)
+     */
+    template<typename Generator>
+    std::pair<double, double> training_error_loss(dbn_t& dbn, Generator& generator, const std::pair<double, double>& batch_stats){
+        if /*constexpr*/ (dbn_traits<dbn_t>::pipelined_epoch_error() && dbn_traits<dbn_t>::error_on_epoch()){
+            return batch_stats;
+        }
+
+        return compute_error_loss(dbn, generator);
     }
 
     /*!
@@ -431,10 +541,10 @@ struct dbn_trainer {
     template<typename Generator>
     std::pair<double, double> train_epoch(dbn_t& dbn, Generator& generator, size_t epoch){
         // Train one epoch of training data
-        train_epoch_only(dbn, generator, epoch);
+        auto batch_stats = train_epoch_only(dbn, generator, epoch);
 
         // Compute the error at this epoch
-        return compute_error_loss(dbn, generator);
+        return training_error_loss(dbn, generator, batch_stats);
     }
 
     /*!
@@ -451,10 +561,10 @@ struct dbn_trainer {
     template<typename TrainGenerator, typename ValGenerator>
     std::pair<std::pair<double, double>, std::pair<double, double>> train_epoch(dbn_t& dbn, TrainGenerator& train_generator, ValGenerator& val_generator, size_t epoch){
         // Train one epoch of training data
-        train_epoch_only(dbn, train_generator, epoch);
+        auto batch_stats = train_epoch_only(dbn, train_generator, epoch);
 
         // Compute the training error at this epoch
-        auto train_stats = compute_error_loss(dbn, train_generator);
+        auto train_stats = training_error_loss(dbn, train_generator, batch_stats);
 
         // Compute the training error at this epoch
         auto val_stats = compute_error_loss(dbn, val_generator);
@@ -533,6 +643,22 @@ struct dbn_trainer {
 
         //Train the model for max_epochs epoch
 
+        auto epoch = train_epochs(dbn, train_generator, val_generator, max_epochs, std::integral_constant<bool, pipelined_validation>{});
+
+        // Finalization
+
+        return stop_training(dbn, epoch, max_epochs);
+    }
+
+private:
+    /*!
+     * \brief Train the network for max_epochs, computing the metrics after
+     * each epoch
+     *
+     * \return The last epoch (max_epochs if the training was not stopped early)
+     */
+    template <typename TrainGenerator, typename ValGenerator>
+    size_t train_epochs(dbn_t& dbn, TrainGenerator& train_generator, ValGenerator& val_generator, size_t max_epochs, std::false_type /*pipelined*/) {
         size_t epoch = 0;
         for (; epoch < max_epochs; ++epoch) {
             dll::auto_timer timer("dbn::trainer::train::epoch");
@@ -555,9 +681,155 @@ struct dbn_trainer {
             }
         }
 
-        // Finalization
+        return epoch;
+    }
 
-        return stop_training(dbn, epoch, max_epochs);
+    /*!
+     * \brief Train the network for max_epochs, computing the validation
+     * metrics of each epoch in the background during the next epoch.
+     *
+     * The decision to stop is therefore taken one epoch late, but the
+     * weights of the network are then reset to the weights of the epoch at
+     * which the training stopped.
+     *
+     * The watcher is notified of the start of an epoch before it is
+     * trained, but of its end only once it has been validated, during the
+     * next epoch. The epoch that is being trained when the training stops is
+     * discarded and is therefore never ended.
+     *
+     * \return The last epoch (max_epochs if the training was not stopped early)
+     */
+    template <typename TrainGenerator, typename ValGenerator>
+    size_t train_epochs(dbn_t& dbn, TrainGenerator& train_generator, ValGenerator& val_generator, size_t max_epochs, std::true_type /*pipelined*/) {
+        // The initial weights of the snapshot are overwritten, they should
+        // not consume the random numbers of the training
+        {
+            dll::random_engine engine(dll::seed());
+            dll::random_engine_scope engine_scope(engine);
+
+            snapshot = std::make_unique<dbn_t>();
+        }
+
+        for (size_t epoch = 0; epoch < max_epochs; ++epoch) {
+            dll::auto_timer timer("dbn::trainer::train::epoch");
+
+            // Shuffle before the epoch if necessary
+            if(dbn_traits<dbn_t>::shuffle()){
+                train_generator.reset_shuffle();
+            } else {
+                train_generator.reset();
+            }
+
+            start_epoch(dbn, epoch);
+
+            auto train_stats = train_epoch_only(dbn, train_generator, epoch);
+
+            update_momentum(dbn, epoch);
+
+            // The previous epoch has been validated during this one
+            if (finish_validation(dbn)) {
+                return epoch - 1;
+            }
+
+            start_validation(dbn, val_generator, epoch, train_stats);
+        }
+
+        // The last epoch
+        if (finish_validation(dbn)) {
+            return max_epochs - 1;
+        }
+
+        return max_epochs;
+    }
+
+    /*!
+     * \brief Take a snapshot of the weights of the network and start
+     * computing the validation metrics on it in the background
+     *
+     * \param dbn The network being trained
+     * \param val_generator The generator for the validation data
+     * \param epoch The current epoch
+     * \param train_stats The training metrics of the epoch
+     */
+    template <typename ValGenerator>
+    void start_validation(dbn_t& dbn, ValGenerator& val_generator, size_t epoch, const std::pair<double, double>& train_stats){
+        copy_weights(dbn, *snapshot);
+
+        pending_epoch       = epoch;
+        pending_train_stats = train_stats;
+
+        // Only the snapshot is used by the thread, the execution state of
+        // the training thread is left untouched
+        validation_thread = std::thread([this, &val_generator]() {
+            dll::auto_timer timer("dbn::trainer::train::epoch::error");
+
+            std::tie(pending_val_stats.first, pending_val_stats.second) = snapshot->evaluate_metrics(val_generator);
+        });
+    }
+
+    /*!
+     * \brief Wait for the validation of the pending epoch, if any, and
+     * decide to stop, or not, the training.
+     *
+     * If the training is stopped, the weights of the snapshot (which may
+     * have been restored to the best weights) are copied back into the network.
+     *
+     * \param dbn The network being trained
+     * \return true if the training is over
+     */
+    bool finish_validation(dbn_t& dbn){
+        if (pending_epoch == no_epoch) {
+            return false;
+        }
+
+        validation_thread.join();
+
+        const size_t epoch = pending_epoch;
+
+        pending_epoch = no_epoch;
+
+        if (end_epoch(dbn, epoch, pending_train_stats, pending_val_stats)) {
+            copy_weights(*snapshot, dbn);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Returns the network holding the weights of the epoch whose
+     * metrics are processed, the snapshot with pipelined validation.
+     */
+    dbn_t& epoch_weights(dbn_t& dbn){
+        return snapshot ? *snapshot : dbn;
+    }
+
+    /*!
+     * \brief Copy the weights of the snapshot, if any, back into the network
+     * \param dbn The network being trained
+     */
+    void sync_weights(dbn_t& dbn){
+        cpp::static_if<pipelined_validation>([&](auto f) {
+            if (snapshot) {
+                copy_weights(*snapshot, f(dbn));
+            }
+        });
+    }
+
+    /*!
+     * \brief Copy the weights of a network into another network
+     * \param from The network to copy the weights from
+     * \param to The network to copy the weights to
+     */
+    template <typename D>
+    static void copy_weights(const D& from, D& to){
+        dll::auto_timer timer("dbn::trainer::train::epoch::snapshot");
+
+        std::stringstream weights(std::ios::in | std::ios::out | std::ios::binary);
+
+        from.store(weights);
+        to.load(weights);
     }
 };
 
@@ -0,0 +1,356 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Fused update kernels for the SGD updaters.
+ *
+ * Each kernel applies the weight decay, the gradient clipping factor and the
+ * update of the updater in a single pass over the memory of a variable:
+ * the gradients and the states are read once and the weights and the states
+ * are written once.
+ */
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "dll/updater_type.hpp"
+#include "dll/util/checks.hpp" // For NaN checks
+
+namespace dll {
+
+/*!
+ * \brief A variable to update with a fused kernel.
+ *
+ * The meaning of the states and of the coefficients depends on the updater,
+ * see fused_update.
+ */
+template <typename T>
+struct fused_parameter {
+    T* w             = nullptr; ///< The values of the variable
+    const T* grad    = nullptr; ///< The gradients of the variable
+    std::array<T*, 4> s{};      ///< The states of the updater
+    size_t size      = 0;       ///< The number of values
+
+    T l1    = 0; ///< The L1 weight cost
+    T l2    = 0; ///< The L2 weight cost
+    T scale = 1; ///< The factor applied to the gradients (clipping)
+
+    std::array<T, 6> k{}; ///< The coefficients of the updater
+};
+
+/*!
+ * \brief The epsilon used by the updaters to avoid division by zero
+ */
+constexpr double fused_epsilon = 1e-8;
+
+/*!
+ * \brief Fused kernel for the given updater.
+ */
+template <updater_type UT>
+struct fused_update;
+
+/*!
+ * \brief Fused kernel for the SGD updater
+ *
+ * Coefficients: k[0] = eps / n
+ */
+template <>
+struct fused_update<updater_type::SGD> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t /*i*/) {
+        *w += p.k[0] * g;
+    }
+};
+
+/*!
+ * \brief Fused kernel for the momentum updater
+ *
+ * States: s[0] = inc
+ * Coefficients: k[0] = momentum, k[1] = eps / n
+ */
+template <>
+struct fused_update<updater_type::MOMENTUM> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T inc = p.k[0] * p.s[0][i] + p.k[1] * g;
+
+        p.s[0][i] = inc;
+        *w += inc;
+    }
+};
+
+/*!
+ * \brief Fused kernel for the Nesterov Accelerated Gradients updater
+ *
+ * States: s[0] = inc, s[1] = inc_prev
+ * Coefficients: k[0] = momentum, k[1] = eps / n
+ */
+template <>
+struct fused_update<updater_type::NESTEROV> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T inc_prev = p.s[0][i];
+        const T inc      = p.k[0] * inc_prev + p.k[1] * g;
+
+        p.s[0][i] = inc;
+        p.s[1][i] = inc_prev;
+        *w += (-p.k[0]) * inc_prev + (T(1) + p.k[0]) * inc;
+    }
+};
+
+/*!
+ * \brief Fused kernel for the RMSPROP updater
+ *
+ * States: s[0] = inc
+ * Coefficients: k[0] = decay, k[1] = eps
+ */
+template <>
+struct fused_update<updater_type::RMSPROP> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T inc = p.k[0] * p.s[0][i] + (T(1) - p.k[0]) * (g * g);
+
+        p.s[0][i] = inc;
+        *w += (p.k[1] * g) / std::sqrt(inc + T(fused_epsilon));
+    }
+};
+
+/*!
+ * \brief Fused kernel for the ADAGRAD updater
+ *
+ * States: s[0] = inc
+ * Coefficients: k[1] = eps
+ */
+template <>
+struct fused_update<updater_type::ADAGRAD> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T inc = p.s[0][i] + g * g;
+
+        p.s[0][i] = inc;
+        *w += (p.k[1] * g) / std::sqrt(inc + T(fused_epsilon));
+    }
+};
+
+/*!
+ * \brief Fused kernel for the ADADELTA updater
+ *
+ * States: s[0] = g, s[1] = x, s[2] = v
+ * Coefficients: k[0] = beta
+ */
+template <>
+struct fused_update<updater_type::ADADELTA> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T beta = p.k[0];
+        const T e    = T(fused_epsilon);
+
+        const T sg = beta * p.s[0][i] + (T(1) - beta) * g * g;
+        const T v  = (std::sqrt(p.s[1][i] + e) * g) / std::sqrt(sg + e);
+        const T x  = beta * p.s[1][i] + (T(1) - beta) * v * v;
+
+        p.s[0][i] = sg;
+        p.s[1][i] = x;
+        p.s[2][i] = v;
+        *w += v;
+    }
+};
+
+/*!
+ * \brief Fused kernel for the ADAM updater
+ *
+ * States: s[0] = m, s[1] = v
+ * Coefficients: k[0] = beta1, k[1] = beta2, k[2] = eps
+ */
+template <>
+struct fused_update<updater_type::ADAM> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T m = p.k[0] * p.s[0][i] + (T(1) - p.k[0]) * g;
+        const T v = p.k[1] * p.s[1][i] + (T(1) - p.k[1]) * (g * g);
+
+        p.s[0][i] = m;
+        p.s[1][i] = v;
+        *w += (p.k[2] * m) / (std::sqrt(v) + T(fused_epsilon));
+    }
+};
+
+/*!
+ * \brief Fused kernel for the ADAM updater with bias correction
+ *
+ * States: s[0] = m, s[1] = mt, s[2] = v, s[3] = vt
+ * Coefficients: k[0] = beta1, k[1] = beta2, k[2] = eps,
+ * k[3] = 1 - beta1^t, k[4] = 1 - beta2^t
+ */
+template <>
+struct fused_update<updater_type::ADAM_CORRECT> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T m = p.k[0] * p.s[0][i] + (T(1) - p.k[0]) * g;
+        const T v = p.k[1] * p.s[2][i] + (T(1) - p.k[1]) * (g * g);
+
+        p.s[0][i] = m;
+        p.s[1][i] = m / p.k[3];
+        p.s[2][i] = v;
+        p.s[3][i] = v / p.k[4];
+        *w += (p.k[2] * m) / (std::sqrt(v) + T(fused_epsilon));
+    }
+};
+
+/*!
+ * \brief Fused kernel for the ADAMAX updater
+ *
+ * States: s[0] = m, s[1] = v
+ * Coefficients: k[0] = beta1, k[1] = beta2, k[2] = eps
+ */
+template <>
+struct fused_update<updater_type::ADAMAX> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T m = p.k[0] * p.s[0][i] + (T(1) - p.k[0]) * g;
+        const T v = std::max(p.k[1] * p.s[1][i], std::abs(g));
+
+        p.s[0][i] = m;
+        p.s[1][i] = v;
+        *w += (p.k[2] * m) / v;
+    }
+};
+
+/*!
+ * \brief Fused kernel for the NADAM updater
+ *
+ * States: s[0] = m, s[1] = mt, s[2] = v, s[3] = vt
+ * Coefficients: k[0] = beta1, k[1] = beta2, k[2] = 1 - m_schedule_next,
+ * k[3] = 1 - beta2^t, k[4] = m1, k[5] = m2
+ */
+template <>
+struct fused_update<updater_type::NADAM> {
+    template <typename T>
+    static void apply(const fused_parameter<T>& p, T* w, T g, size_t i) {
+        const T m  = p.k[0] * p.s[0][i] + (T(1) - p.k[0]) * g;
+        const T v  = p.k[1] * p.s[2][i] + (T(1) - p.k[1]) * (g * g);
+        const T mt = m / p.k[2];
+        const T vt = v / p.k[3];
+
+        p.s[0][i] = m;
+        p.s[1][i] = mt;
+        p.s[2][i] = v;
+        p.s[3][i] = vt;
+        *w += (p.k[4] * g + p.k[5] * mt) / (std::sqrt(vt) + T(fused_epsilon));
+    }
+};
+
+/*!
+ * \brief Apply the fused update of the given updater to a range of values of
+ * a variable.
+ *
+ * \param p The variable to update
+ * \param first The index of the first value to update
+ * \param last The index past the last value to update
+ */
+template <updater_type UT, typename T>
+void fused_update_range(const fused_parameter<T>& p, size_t first, size_t last) {
+    T* w = p.w;
+
+    for (size_t i = first; i < last; ++i) {
+        const T g = p.scale * (p.grad[i] - p.l1 * std::abs(w[i]) - p.l2 * w[i]);
+
+        fused_update<UT>::apply(p, w + i, g, i);
+
+        nan_check(w[i]);
+    }
+}
+
+/*!
+ * \brief A contiguous part of a variable, used to split the update of all
+ * the variables of a network into tasks of similar size.
+ */
+struct fused_chunk {
+    bool is_double;   ///< Indicates if the variable is in double precision
+    size_t parameter; ///< The index of the variable in the list of its type
+    size_t first;     ///< The index of the first value
+    size_t last;      ///< The index past the last value
+};
+
+constexpr size_t fused_chunk_size = 16 * 1024; ///< The number of values of a chunk
+
+/*!
+ * \brief The variables of a network, split into chunks, to update with the
+ * fused kernels.
+ *
+ * Each layer can use its own data type, the variables are therefore kept in
+ * one list per type.
+ */
+struct fused_variables {
+    std::vector<fused_parameter<float>> floats;   ///< The single precision variables
+    std::vector<fused_parameter<double>> doubles; ///< The double precision variables
+    std::vector<fused_chunk> chunks;              ///< The chunks of all the variables
+
+    /*!
+     * \brief Remove all the variables
+     */
+    void clear() {
+        floats.clear();
+        doubles.clear();
+        chunks.clear();
+    }
+
+    /*!
+     * \brief Returns the number of variables
+     */
+    size_t size() const {
+        return floats.size() + doubles.size();
+    }
+
+    /*!
+     * \brief Add a single precision variable and its chunks
+     */
+    void push_back(const fused_parameter<float>& p) {
+        add(floats, p, false);
+    }
+
+    /*!
+     * \brief Add a double precision variable and its chunks
+     */
+    void push_back(const fused_parameter<double>& p) {
+        add(doubles, p, true);
+    }
+
+    /*!
+     * \brief Apply the fused update of the given updater to the given chunk
+     * \param c The index of the chunk
+     */
+    template <updater_type UT>
+    void update(size_t c) const {
+        auto& chunk = chunks[c];
+
+        if (chunk.is_double) {
+            fused_update_range<UT>(doubles[chunk.parameter], chunk.first, chunk.last);
+        } else {
+            fused_update_range<UT>(floats[chunk.parameter], chunk.first, chunk.last);
+        }
+    }
+
+private:
+    template <typename T>
+    void add(std::vector<fused_parameter<T>>& parameters, const fused_parameter<T>& p, bool is_double) {
+        const size_t index = parameters.size();
+
+        parameters.push_back(p);
+
+        for (size_t first = 0; first < p.size; first += fused_chunk_size) {
+            chunks.push_back({is_double, index, first, std::min(first + fused_chunk_size, p.size)});
+        }
+    }
+};
+
+} //end of dll namespace
@@ -201,9 +201,7 @@ struct rbm_trainer {
         context.sparsity += context.batch_sparsity;
 
         cpp::static_if<EnableWatcher && rbm_layer_traits<rbm_t>::free_energy()>([&](auto f) {
-            for (auto& v : input) {
-                context.free_energy += f(rbm).free_energy(v);
-            }
+            context.free_energy += f(rbm).batch_free_energy(input);
         });
 
         if (EnableWatcher && rbm_layer_traits<rbm_t>::is_verbose()) {
@@ -17,23 +17,40 @@
 
 #include "cpp_utils/static_if.hpp"
 #include "cpp_utils/tuple_utils.hpp"
+#include "cpp_utils/parallel.hpp"
 
 #include "dll/trainer/context_fwd.hpp" // For sgd_context
 #include "dll/util/checks.hpp"         // For NaN checks
+#include "dll/util/arena.hpp"          // For memory_arena
+#include "dll/trainer/fused_updater.hpp" // For fused_update
 #include "dll/util/timers.hpp"         // For auto_timer
 
 namespace dll {
 
+/*!
+ * \brief Returns the memory used on the heap by the given tensor.
+ *
+ * The memory of fast tensors is part of the object holding them and is
+ * therefore not counted.
+ *
+ * \param tensor The tensor to inspect
+ */
+template <typename T>
+size_t sgd_heap_memory(const T& tensor) {
+    return etl::decay_traits<T>::is_fast ? 0 : etl::size(tensor) * sizeof(etl::value_t<T>);
+}
+
 /*!
  * \brief Build the sub context for a updater context
  *
  * \param layer The layer to build the context for
+ * \param arena The arena to allocate the context from
  */
 template <template <typename, size_t, updater_type> class SubContext, updater_type UT, typename Layer, size_t... I>
-auto build_sub_context(Layer& layer, std::index_sequence<I...> /*seq*/) {
+auto build_sub_context(Layer& layer, memory_arena& arena, std::index_sequence<I...> /*seq*/) {
     return std::make_tuple
         (
-            std::make_shared<SubContext<Layer, I, UT>>(layer)...
+            std::allocate_shared<SubContext<Layer, I, UT>>(arena_allocator<SubContext<Layer, I, UT>>(arena), layer)...
         );
 }
 
@@ -41,12 +58,13 @@ auto build_sub_context(Layer& layer, std::index_sequence<I...> /*seq*/) {
  * \brief Build the sub context for a updater context
  *
  * \param layer The layer to build the context for
+ * \param arena The arena to allocate the context from
  */
 template <template <typename, size_t, updater_type> class SubContext, updater_type UT, typename Layer>
-auto build_sub_context(Layer& layer) {
+auto build_sub_context(Layer& layer, memory_arena& arena) {
     static constexpr size_t N = std::tuple_size<decltype(layer.trainable_parameters())>();
 
-    return build_sub_context<SubContext, UT>(layer, std::make_index_sequence<N>());
+    return build_sub_context<SubContext, UT>(layer, arena, std::make_index_sequence<N>());
 }
 
 /*!
@@ -68,6 +86,8 @@ struct updater_sub_context <Layer, I, updater_type::SGD> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 1; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
 
     /*!
@@ -89,6 +109,8 @@ struct updater_sub_context <Layer, I, updater_type::MOMENTUM> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 2; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type inc;  ///< The accumulated momentum cache
 
@@ -112,6 +134,8 @@ struct updater_sub_context <Layer, I, updater_type::NESTEROV> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 3; ///< The number of tensors of the context
+
     type grad;     ///< The gradients of the variable
     type inc;      ///< The accumulated momentum cache
     type inc_prev; ///< The previous accumulated momentum cache
@@ -137,6 +161,8 @@ struct updater_sub_context <Layer, I, updater_type::RMSPROP> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 2; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type inc;  ///< The accumulated squared gradients
 
@@ -160,6 +186,8 @@ struct updater_sub_context <Layer, I, updater_type::ADAGRAD> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 2; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type inc;  ///< Accumulated gradients for adagrad
 
@@ -183,6 +211,8 @@ struct updater_sub_context <Layer, I, updater_type::ADADELTA> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 4; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type g;
     type x;
@@ -210,6 +240,8 @@ struct updater_sub_context <Layer, I, updater_type::ADAM> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 3; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type m;    ///< Estimates of the first moment of the gradient
     type v;    ///< Estimates of the second moment of the gradient
@@ -235,6 +267,8 @@ struct updater_sub_context <Layer, I, updater_type::ADAM_CORRECT> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 5; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type m;    ///< Estimates of the first moment of the gradient
     type mt;   ///< Corrected estimates of the first moment of the gradient
@@ -264,6 +298,8 @@ struct updater_sub_context <Layer, I, updater_type::NADAM> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 5; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type m;    ///< Estimates of the first moment of the gradient
     type mt;   ///< Corrected estimates of the first moment of the gradient
@@ -297,6 +333,8 @@ struct updater_sub_context <Layer, I, updater_type::ADAMAX> {
      */
     using type = std::remove_reference_t<decltype(std::get<I>(std::declval<Layer>().trainable_parameters()))>;
 
+    static constexpr size_t tensors = 3; ///< The number of tensors of the context
+
     type grad; ///< The gradients of the variable
     type m;    ///< Estimates of the first moment of the gradient
     type v;    ///< Estimates of the second moment of the gradient
@@ -318,11 +356,21 @@ struct updater_sub_context <Layer, I, updater_type::ADAMAX> {
  */
 template <updater_type UT, bool Neural, typename Layer>
 struct updater_context {
+    static constexpr size_t arena_size = 0; ///< The memory needed in the arena by the sub contexts
+
     /*!
      * \brief Construct a new updater_context using the parent context
      */
-    updater_context(Layer& layer) {
+    updater_context(Layer& layer, memory_arena& arena) {
         cpp_unused(layer);
+        cpp_unused(arena);
+    }
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the context
+     */
+    size_t heap_memory() const {
+        return 0;
     }
 };
 
@@ -334,14 +382,34 @@ struct updater_context<UT, true, Layer> {
     /*!
      * \brief The context for the updater and for each variable of the layer
      */
-    decltype(build_sub_context<updater_sub_context, UT>(std::declval<Layer&>())) context;
+    decltype(build_sub_context<updater_sub_context, UT>(std::declval<Layer&>(), std::declval<memory_arena&>())) context;
+
+    static constexpr size_t arena_size = arena_shared_tuple_size<decltype(context)>::value; ///< The memory needed in the arena by the sub contexts
 
     /*!
      * \brief Construct a new updater_context using the parent context
      */
-    updater_context(Layer& layer) : context(build_sub_context<updater_sub_context, UT>(layer)) {
+    updater_context(Layer& layer, memory_arena& arena) : context(build_sub_context<updater_sub_context, UT>(layer, arena)) {
         // Nothing else to init
     }
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the context
+     */
+    size_t heap_memory() const {
+        return heap_memory(std::make_index_sequence<std::tuple_size<decltype(context)>::value>());
+    }
+
+private:
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the given
+     * sub contexts
+     */
+    template <size_t... I>
+    size_t heap_memory(std::index_sequence<I...> /*seq*/) const {
+        return arena_detail::sum({size_t(0),
+            (std::tuple_element_t<I, decltype(context)>::element_type::tensors * sgd_heap_memory(std::get<I>(context)->grad))...});
+    }
 };
 
 /*!
@@ -357,38 +425,289 @@ struct full_sgd_context : sgd_context<DBN, Layer, L> {
      */
     updater_context<DBN::updater, decay_layer_traits<Layer>::is_neural_layer(), Layer> up;
 
+    using input_type = decltype(std::declval<context_type&>().input); ///< The type of the input of the layer
+
+    /*!
+     * \brief The output of the previous layer, when it is used directly as
+     * the input of this layer, nullptr otherwise.
+     */
+    input_type* shared_input = nullptr;
+
     /*!
      * \brief Construct the full_sgd_context for the given layer
+     * \param layer The layer to build the context for
+     * \param arena The arena to allocate the updater context from
      */
-    full_sgd_context(Layer& layer) : context_type(layer), up(layer) {
+    full_sgd_context(Layer& layer, memory_arena& arena) : context_type(layer), up(layer, arena) {
         // Nothing else to init
     }
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the context
+     */
+    size_t heap_memory() const {
+        return sgd_heap_memory(this->input) + sgd_heap_memory(this->output) + sgd_heap_memory(this->errors) + up.heap_memory();
+    }
+};
+
+/*!
+ * \brief Forward propagate a batch in train mode through a layer that needs
+ * its training context to keep information for the backward pass.
+ * \param layer The layer to propagate through
+ * \param context The training context of the layer
+ */
+template <typename Layer, typename Context>
+auto sgd_train_forward(Layer& layer, Context& context, int /*prefer*/) -> decltype(layer.train_forward_batch(context.output, sgd_input(context), context), void()) {
+    layer.train_forward_batch(context.output, sgd_input(context), context);
+}
+
+/*!
+ * \brief Forward propagate a batch in train mode through a layer.
+ * \param layer The layer to propagate through
+ * \param context The training context of the layer
+ */
+template <typename Layer, typename Context>
+void sgd_train_forward(Layer& layer, Context& context, long /*fallback*/) {
+    layer.train_forward_batch(context.output, sgd_input(context));
+}
+
+/*!
+ * \brief Returns the layer to use for a pass of the training.
+ *
+ * The layers are shared between the workers of the parallel trainer, they
+ * are only used through const references by the workers, so that a layer
+ * modifying itself during training cannot be used concurrently.
+ *
+ * \tparam Shared Indicates if the layer is shared between several workers
+ * \param layer The layer
+ */
+template <bool Shared, typename Layer, cpp_enable_iff(Shared)>
+const Layer& sgd_layer(Layer& layer) {
+    return layer;
+}
+
+/*!
+ * \copydoc sgd_layer
+ */
+template <bool Shared, typename Layer, cpp_disable_if(Shared)>
+Layer& sgd_layer(Layer& layer) {
+    return layer;
+}
+
+/*!
+ * \brief Make the input of the second context a view of the output of the
+ * first context. The input buffer of the second context is released when
+ * it is dynamic.
+ */
+template <typename C1, typename C2, cpp_enable_iff(std::is_same<decltype(std::declval<C1&>().output), typename C2::input_type>::value)>
+void sgd_share_input(C1& ctx1, C2& ctx2) {
+    ctx2.shared_input = &ctx1.output;
+
+    cpp::static_if<!etl::decay_traits<typename C2::input_type>::is_fast>([&](auto f) {
+        f(ctx2).input.clear();
+    });
+}
+
+/*!
+ * \brief Does nothing, the output of the first context cannot be used
+ * directly as the input of the second context.
+ */
+template <typename C1, typename C2, cpp_disable_if(std::is_same<decltype(std::declval<C1&>().output), typename C2::input_type>::value)>
+void sgd_share_input(C1& /*ctx1*/, C2& /*ctx2*/) {}
+
+/*!
+ * \brief Pass the output of the first context to the second context,
+ * copying it only if the input is not shared.
+ */
+template <typename C1, typename C2>
+auto sgd_forward_input(C1& ctx1, C2& ctx2, int /*prefer*/) -> decltype(ctx2.shared_input, void()) {
+    if (!ctx2.shared_input) {
+        ctx2.input = ctx1.output;
+    }
+}
+
+/*!
+ * \copydoc sgd_forward_input
+ */
+template <typename C1, typename C2>
+void sgd_forward_input(C1& ctx1, C2& ctx2, long /*fallback*/) {
+    ctx2.input = ctx1.output;
+}
+
+/*!
+ * \brief A view of a network with a different batch size.
+ *
+ * This is used to build the contexts of the workers of the data-parallel
+ * SGD trainer, each worker only processing a part of the mini-batch.
+ *
+ * \tparam DBN The viewed network
+ * \tparam B The batch size of the view
+ */
+template <typename DBN, size_t B>
+struct sgd_worker_dbn {
+    using weight = typename DBN::weight; ///< The data type of the network
+
+    static constexpr size_t layers     = DBN::layers;  ///< The number of layers
+    static constexpr size_t batch_size = B;            ///< The batch size of the worker
+    static constexpr auto updater      = DBN::updater; ///< The updater type
+
+    template <size_t N>
+    using layer_type = typename DBN::template layer_type<N>; ///< The type of the Nth layer
 };
 
 /*!
  * \brief Build the context for a DBN for the given sequence of layers
+ *
+ * The contexts are built for the CDBN network type, which can be a view of the
+ * DBN with a different batch size.
+ *
  * \param dbn The DBN to build the context from
+ * \param arena The arena to allocate the contexts from
  */
-template<template<typename, typename, size_t> class Context, typename DBN, size_t... I>
-auto build_context(DBN& dbn, std::index_sequence<I...> /*seq*/){
+template<template<typename, typename, size_t> class Context, typename CDBN, typename DBN, size_t... I>
+auto build_context_as(DBN& dbn, memory_arena& arena, std::index_sequence<I...> /*seq*/){
     return std::make_tuple
         (
             (std::make_pair(
                 std::ref(dbn.template layer_get<I>()),  // Reference to the layer
-                std::make_shared<Context<DBN, typename DBN::template layer_type<I>, I>>(dbn.template layer_get<I>()))
+                std::allocate_shared<Context<CDBN, typename DBN::template layer_type<I>, I>>(
+                    arena_allocator<Context<CDBN, typename DBN::template layer_type<I>, I>>(arena), dbn.template layer_get<I>(), arena))
             )...
         );
 }
 
+/*!
+ * \brief Build the context for a DBN, for the given network type
+ * \param dbn The DBN to build the context from
+ * \param arena The arena to allocate the contexts from
+ */
+template<template<typename, typename, size_t> class Context, typename CDBN, typename DBN>
+auto build_context_as(DBN& dbn, memory_arena& arena){
+    return build_context_as<Context, CDBN>(dbn, arena, std::make_index_sequence<DBN::layers>());
+}
+
 /*!
  * \brief Build the context for a DBN
  * \param dbn The DBN to build the context from
+ * \param arena The arena to allocate the contexts from
  */
 template<template<typename, typename, size_t> class Context, typename DBN>
-auto build_context(DBN& dbn){
-    return build_context<Context>(dbn, std::make_index_sequence<DBN::layers>());
+auto build_context(DBN& dbn, memory_arena& arena){
+    return build_context_as<Context, DBN>(dbn, arena);
+}
+
+/*!
+ * \brief Compute the memory needed in an arena by the contexts of a network
+ * for the given sequence of layers
+ */
+template<template<typename, typename, size_t> class Context, typename CDBN, typename DBN, size_t... I>
+constexpr size_t context_arena_size(std::index_sequence<I...> /*seq*/){
+    return arena_detail::sum({size_t(0),
+        (arena_shared_size<Context<CDBN, typename DBN::template layer_type<I>, I>>()
+            + decltype(std::declval<Context<CDBN, typename DBN::template layer_type<I>, I>&>().up)::arena_size)...});
 }
 
+/*!
+ * \brief Compute the memory needed in an arena by the contexts of a network,
+ * built for the given network type.
+ */
+template<template<typename, typename, size_t> class Context, typename CDBN, typename DBN>
+constexpr size_t context_arena_size(){
+    return context_arena_size<Context, CDBN, DBN>(std::make_index_sequence<DBN::layers>());
+}
+
+/*!
+ * \brief Returns the memory used on the heap by the tensors of the given
+ * contexts, for the given sequence of layers
+ */
+template<typename Context, size_t... I>
+size_t context_heap_memory(const Context& context, std::index_sequence<I...> /*seq*/){
+    return arena_detail::sum({size_t(0), std::get<I>(context).second->heap_memory()...});
+}
+
+/*!
+ * \brief Returns the memory used on the heap by the tensors of the given
+ * contexts
+ * \param context The contexts of the network
+ */
+template<typename Context>
+size_t context_heap_memory(const Context& context){
+    return context_heap_memory(context, std::make_index_sequence<std::tuple_size<Context>::value>());
+}
+
+/*!
+ * \brief The contexts of the workers of the data-parallel SGD trainer.
+ *
+ * Each worker processes a contiguous part of the mini-batch with its own set
+ * of contexts, and therefore its own gradients.
+ *
+ * \tparam DBN The network being trained
+ * \tparam N The number of workers
+ */
+template <typename DBN, size_t N>
+struct sgd_workers {
+    static constexpr size_t batch_size = (DBN::batch_size + N - 1) / N; ///< The batch size of each worker
+
+    using worker_dbn_t = sgd_worker_dbn<DBN, batch_size>;                                            ///< The network view of a worker
+    using context_t    = decltype(build_context_as<full_sgd_context, worker_dbn_t>(std::declval<DBN&>(), std::declval<memory_arena&>())); ///< The context of a worker
+
+    static constexpr size_t arena_size = N * context_arena_size<full_sgd_context, worker_dbn_t, DBN>(); ///< The memory needed in the arena by the workers
+
+    std::vector<context_t> contexts;          ///< The contexts of the workers
+    std::vector<dll::random_engine> engines; ///< The random engines of the workers
+    cpp::default_thread_pool<> pool;          ///< The worker threads
+
+    /*!
+     * \brief Build the contexts of the workers for the given network
+     * \param dbn The network being trained
+     * \param arena The arena to allocate the contexts from
+     */
+    sgd_workers(DBN& dbn, memory_arena& arena) : pool(N) {
+        contexts.reserve(N);
+        engines.reserve(N);
+
+        for (size_t t = 0; t < N; ++t) {
+            contexts.push_back(build_context_as<full_sgd_context, worker_dbn_t>(dbn, arena));
+
+            // Each worker draws from its own stream, independently of the thread running it
+            engines.emplace_back(dll::worker_seed(t));
+        }
+    }
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the workers
+     */
+    size_t heap_memory() const {
+        size_t memory = 0;
+
+        for (auto& context : contexts) {
+            memory += context_heap_memory(context);
+        }
+
+        return memory;
+    }
+};
+
+/*!
+ * \brief Specialization of sgd_workers for serial training (no workers).
+ */
+template <typename DBN>
+struct sgd_workers<DBN, 1> {
+    static constexpr size_t arena_size = 0; ///< The memory needed in the arena by the workers
+
+    /*!
+     * \brief Construct the (empty) set of workers
+     */
+    sgd_workers(DBN& /*dbn*/, memory_arena& /*arena*/) {}
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the workers
+     */
+    size_t heap_memory() const {
+        return 0;
+    }
+};
+
 /*!
  * \brief Simple gradient descent trainer
  */
@@ -398,12 +717,32 @@ struct sgd_trainer {
     using weight    = typename dbn_t::weight; ///< The data type for this layer
     using this_type = sgd_trainer<dbn_t>;     ///< The type of this layer
 
-    static constexpr auto layers     = dbn_t::layers;     ///< The number of layers
-    static constexpr auto batch_size = dbn_t::batch_size; ///< The batch size for training
+    static constexpr auto layers     = dbn_t::layers;                    ///< The number of layers
+    static constexpr auto batch_size = dbn_t::batch_size;                ///< The batch size for training
+    static constexpr auto threads    = dbn_traits<dbn_t>::sgd_threads(); ///< The number of threads for training
+
+    /*!
+     * \brief The memory needed in the arena by all the contexts. The full
+     * context is only used by serial training.
+     */
+    static constexpr size_t arena_size = (threads == 1 ? context_arena_size<full_sgd_context, dbn_t, dbn_t>() : 0) + sgd_workers<dbn_t, threads>::arena_size;
+
+    /*!
+     * \brief The type of the context for the full batch (empty with parallel
+     * training, the workers have their own contexts)
+     */
+    using full_context_t = std::conditional_t<
+        threads == 1,
+        decltype(build_context<full_sgd_context>(std::declval<dbn_t&>(), std::declval<memory_arena&>())),
+        std::tuple<>>;
+
+    dbn_t& dbn;                          ///< The DBN being trained
+    memory_arena arena;                  ///< The memory of the contexts
+    full_context_t full_context;         ///< The context
+    sgd_workers<dbn_t, threads> workers; ///< The contexts of the parallel workers
+    size_t iteration;                    ///< The current iteration
 
-    dbn_t& dbn;                                                  ///< The DBN being trained
-    decltype(build_context<full_sgd_context>(dbn)) full_context; ///< The context
-    size_t iteration;                                            ///< The current iteration
+    fused_variables variables; ///< The variables of the network, for the fused updates
 
     // Transform layers need to inherit dimensions from back
 
@@ -429,13 +768,12 @@ struct sgd_trainer {
     static void inherit_from_front(L1& /*l1*/, L2& /*l2*/){ }
 
     /*!
-     * \brief construct a new sgd_trainer
-     * \param dbn The DBN being trained
+     * \brief Inherit the dimensions of the transform layers of the given context
+     * \param context The context to complete
      */
-    explicit sgd_trainer(dbn_t& dbn) : dbn(dbn), full_context(build_context<full_sgd_context>(dbn)), iteration(1) {
-        // Inherit dimensions from front to end (for transform layers)
-
-        cpp::for_each_pair(full_context, [](auto& layer_ctx_1, auto& layer_ctx_2) {
+    template<typename Context>
+    static void inherit_dimensions(Context& context){
+        cpp::for_each_pair(context, [](auto& layer_ctx_1, auto& layer_ctx_2) {
             constexpr bool l2_transform = decay_layer_traits<decltype(layer_ctx_2.first)>::is_transform_layer();
 
             if (l2_transform) {
@@ -444,6 +782,99 @@ struct sgd_trainer {
         });
     }
 
+    /*!
+     * \brief Use the output of each layer directly as the input of the next
+     * layer, when they have the same type, instead of copying it.
+     *
+     * \param context The context to complete
+     */
+    template<typename Context>
+    static void share_inputs(Context& context){
+        cpp::for_each_pair(context, [](auto& layer_ctx_1, auto& layer_ctx_2) {
+            sgd_share_input(*layer_ctx_1.second, *layer_ctx_2.second);
+        });
+    }
+
+    /*!
+     * \brief Build the context for the full batch
+     */
+    template<size_t T = threads, cpp_enable_iff((T == 1))>
+    static full_context_t build_full_context(dbn_t& dbn, memory_arena& arena){
+        return build_context<full_sgd_context>(dbn, arena);
+    }
+
+    /*!
+     * \brief Build the (empty) context for the full batch, the workers have
+     * their own contexts
+     */
+    template<size_t T = threads, cpp_enable_iff((T > 1))>
+    static full_context_t build_full_context(dbn_t& /*dbn*/, memory_arena& /*arena*/){
+        return {};
+    }
+
+    /*!
+     * \brief Inherit the dimensions of the transform layers of the contexts
+     */
+    template<size_t T = threads, cpp_enable_iff((T > 1))>
+    void inherit_context_dimensions(){
+        for (auto& context : workers.contexts) {
+            inherit_dimensions(context);
+            share_inputs(context);
+        }
+    }
+
+    /*!
+     * \brief Inherit the dimensions of the transform layers of the contexts
+     */
+    template<size_t T = threads, cpp_enable_iff((T == 1))>
+    void inherit_context_dimensions(){
+        inherit_dimensions(full_context);
+        share_inputs(full_context);
+    }
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the contexts
+     */
+    template<size_t T = threads, cpp_enable_iff((T > 1))>
+    size_t contexts_heap_memory() const {
+        return workers.heap_memory();
+    }
+
+    /*!
+     * \brief Returns the memory used on the heap by the tensors of the contexts
+     */
+    template<size_t T = threads, cpp_enable_iff((T == 1))>
+    size_t contexts_heap_memory() const {
+        return context_heap_memory(full_context);
+    }
+
+    /*!
+     * \brief construct a new sgd_trainer
+     * \param dbn The DBN being trained
+     */
+    explicit sgd_trainer(dbn_t& dbn)
+            : dbn(dbn),
+              arena(arena_size, dbn_traits<dbn_t>::huge_pages()),
+              full_context(build_full_context(dbn, arena)),
+              workers(dbn, arena),
+              iteration(1) {
+        // Inherit dimensions from front to end (for transform layers)
+
+        inherit_context_dimensions();
+
+        if (dbn_traits<dbn_t>::is_verbose()) {
+            std::cout << "SGD Memory: " << memory_footprint() << "B (arena: " << arena.capacity() << "B)" << std::endl;
+        }
+    }
+
+    /*!
+     * \brief Returns the total memory, in bytes, used by the training
+     * contexts (activations, errors, gradients and updater states).
+     */
+    size_t memory_footprint() const {
+        return arena.capacity() + arena.heap_size() + contexts_heap_memory();
+    }
+
     /*!
      * \brief Initialize the training
      */
@@ -454,9 +885,9 @@ struct sgd_trainer {
     /*!
      * \brief Compute the errors of the last layer given the loss function
      */
-    template<loss_function F, typename Labels, cpp_enable_iff(F == loss_function::CATEGORICAL_CROSS_ENTROPY)>
-    void last_errors(bool full_batch, size_t n, const Labels& labels){
-        auto& last_ctx   = *std::get<layers - 1>(full_context).second;
+    template<loss_function F, typename Context, typename Labels, cpp_enable_iff(F == loss_function::CATEGORICAL_CROSS_ENTROPY)>
+    static void last_errors(Context& context, bool full_batch, size_t n, const Labels& labels){
+        auto& last_ctx   = *std::get<layers - 1>(context).second;
 
         if (cpp_unlikely(!full_batch)) {
             last_ctx.errors = 0;
@@ -476,10 +907,10 @@ struct sgd_trainer {
     /*!
      * \brief Compute the errors of the last layer given the loss function
      */
-    template<loss_function F, typename Labels, cpp_enable_iff(F == loss_function::MEAN_SQUARED_ERROR)>
-    void last_errors(bool full_batch, size_t n, const Labels& labels){
-        auto& last_layer = std::get<layers - 1>(full_context).first;
-        auto& last_ctx   = *std::get<layers - 1>(full_context).second;
+    template<loss_function F, typename Context, typename Labels, cpp_enable_iff(F == loss_function::MEAN_SQUARED_ERROR)>
+    static void last_errors(Context& context, bool full_batch, size_t n, const Labels& labels){
+        auto& last_layer = std::get<layers - 1>(context).first;
+        auto& last_ctx   = *std::get<layers - 1>(context).second;
 
         if (cpp_unlikely(!full_batch)) {
             last_ctx.errors = 0;
@@ -498,10 +929,10 @@ struct sgd_trainer {
     /*!
      * \brief Compute the errors of the last layer given the loss function
      */
-    template<loss_function F, typename Labels, cpp_enable_iff(F == loss_function::BINARY_CROSS_ENTROPY)>
-    void last_errors(bool full_batch, size_t n, const Labels& labels){
-        auto& last_layer = std::get<layers - 1>(full_context).first;
-        auto& last_ctx   = *std::get<layers - 1>(full_context).second;
+    template<loss_function F, typename Context, typename Labels, cpp_enable_iff(F == loss_function::BINARY_CROSS_ENTROPY)>
+    static void last_errors(Context& context, bool full_batch, size_t n, const Labels& labels){
+        auto& last_layer = std::get<layers - 1>(context).first;
+        auto& last_ctx   = *std::get<layers - 1>(context).second;
 
         // Avoid Nan from division by ((1 - out) * out)
         auto out = etl::force_temporary(etl::clip(last_ctx.output, 0.001, 0.999));
@@ -526,6 +957,48 @@ struct sgd_trainer {
         nan_check_etl(last_ctx.errors);
     }
 
+    /*!
+     * \brief Compute the errors of the last layer and backpropagate them
+     * through the network.
+     *
+     * \tparam Shared Indicates if the layers are shared between several workers
+     * \param context The context holding the results of the forward pass
+     * \param n The number of samples in the batch
+     * \param labels A batch of labels
+     */
+    template <bool Shared = false, typename Context, typename Labels>
+    static void backward_batch_context(Context& context, size_t n, const Labels& labels) {
+        auto& first_layer = sgd_layer<Shared>(std::get<0>(context).first);
+        auto& first_ctx   = *std::get<0>(context).second;
+
+        const bool full_batch = n == etl::dim<0>(first_ctx.input);
+
+        //Compute the errors of the last layer
+
+        last_errors<dbn_t::loss>(context, full_batch, n, labels);
+
+        // Backpropagate the error
+
+        bool last = true;
+
+        cpp::for_each_rpair(context, [&last](auto& layer_ctx_1, auto& layer_ctx_2) {
+            auto& r2 = sgd_layer<Shared>(layer_ctx_2.first);
+
+            auto& ctx1 = *layer_ctx_1.second;
+            auto& ctx2 = *layer_ctx_2.second;
+
+            if(!last){
+                r2.adapt_errors(ctx2);
+            }
+
+            last = false;
+
+            r2.backward_batch(ctx1.errors, ctx2);
+        });
+
+        first_layer.adapt_errors(first_ctx);
+    }
+
     /*!
      * \brief Train a batch of data
      * \param epoch The current epoch
@@ -533,16 +1006,16 @@ struct sgd_trainer {
      * \param labels A batch of labels
      * \return a pair containing the error and the loss for the batch
      */
-    template <typename Inputs, typename Labels>
+    template <typename Inputs, typename Labels, size_t T = threads, cpp_enable_iff((T == 1))>
     std::pair<double, double> train_batch(size_t epoch, const Inputs& inputs, const Labels& labels) {
         dll::auto_timer timer("sgd::train_batch");
 
-        auto& first_layer = std::get<0>(full_context).first;
+        cpp_unused(epoch);
+
         auto& first_ctx   = *std::get<0>(full_context).second;
         auto& last_ctx    = *std::get<layers - 1>(full_context).second;
 
-        const auto n          = etl::dim<0>(inputs);
-        const bool full_batch = n == etl::dim<0>(first_ctx.input);
+        const auto n = etl::dim<0>(inputs);
 
         // Ensure that the data batch and the label batch are of the same size
         cpp_assert(n == etl::dim<0>(labels), "Invalid sizes");
@@ -561,46 +1034,124 @@ struct sgd_trainer {
         {
             dll::auto_timer timer("sgd::backward");
 
-            //Compute the errors of the last layer
+            backward_batch_context(full_context, n, labels);
+        }
 
-            last_errors<dbn_t::loss>(full_batch, n, labels);
+        // Compute and apply the gradients
 
-            // Backpropagate the error
+        {
+            dll::auto_timer timer("sgd::grad");
 
-            bool last = true;
+            cpp::for_each(full_context, [](auto& layer_ctx) {
+                layer_ctx.first.compute_gradients(*layer_ctx.second);
+            });
 
-            cpp::for_each_rpair(full_context, [&last](auto& layer_ctx_1, auto& layer_ctx_2) {
-                auto& r2 = layer_ctx_2.first;
+            this->update_weights(full_context, n);
+        }
 
-                auto& ctx1 = *layer_ctx_1.second;
-                auto& ctx2 = *layer_ctx_2.second;
+        // Update the counter of iterations
+        ++iteration;
 
-                if(!last){
-                    r2.adapt_errors(ctx2);
-                }
+        // Compute error and loss
 
-                last = false;
+        double error = 0.0;
+        double loss = 0.0;
 
-                r2.backward_batch(ctx1.errors, ctx2);
-            });
+        {
+            dll::auto_timer timer("sgd::error");
 
-            first_layer.adapt_errors(first_ctx);
+            std::tie(error, loss) = dbn.evaluate_metrics_batch(last_ctx.output, labels, n, true);
         }
 
-        // Compute and apply the gradients
+        return std::make_pair(error, loss);
+    }
+
+    /*!
+     * \brief Train a batch of data, splitting it across the workers.
+     *
+     * Each worker computes the forward pass, the backward pass and the
+     * gradients of its part of the batch. The gradients are then reduced
+     * in a tree into the first worker which is used to update the weights.
+     *
+     * \param epoch The current epoch
+     * \param inputs A batch of inputs
+     * \param labels A batch of labels
+     * \return a pair containing the error and the loss for the batch
+     */
+    template <typename Inputs, typename Labels, size_t T = threads, cpp_enable_iff((T > 1))>
+    std::pair<double, double> train_batch(size_t epoch, const Inputs& inputs, const Labels& labels) {
+        dll::auto_timer timer("sgd::train_batch");
+
+        cpp_unused(epoch);
+
+        static constexpr size_t worker_batch = decltype(workers)::batch_size;
+
+        const auto n = etl::dim<0>(inputs);
+
+        // Ensure that the data batch and the label batch are of the same size
+        cpp_assert(n == etl::dim<0>(labels), "Invalid sizes");
+
+        // Ensure that the workers can hold the inputs
+        cpp_assert(n <= threads * worker_batch, "Invalid sizes");
+
+        // Only the first workers may have samples for the last batch
+        const size_t active = (n + worker_batch - 1) / worker_batch;
+
+        std::array<double, threads> errors;
+        std::array<double, threads> losses;
 
         {
-            dll::auto_timer timer("sgd::grad");
+            dll::auto_timer timer("sgd::parallel::workers");
 
-            cpp::for_each(full_context, [this, epoch, n](auto& layer_ctx) {
-                // Compute the gradients
-                layer_ctx.first.compute_gradients(*layer_ctx.second);
+            cpp::parallel_foreach_n(workers.pool, 0, active, [&](size_t t) {
+                const size_t first = t * worker_batch;
+                const size_t last  = std::min(first + worker_batch, n);
+
+                auto& context  = workers.contexts[t];
+                auto& last_ctx = *std::get<layers - 1>(context).second;
+
+                dll::random_engine_scope engine_scope(workers.engines[t]);
+
+                auto worker_inputs = etl::slice(inputs, first, last);
+                auto worker_labels = etl::slice(labels, first, last);
 
-                // Apply the gradients
-                this->update_weights<dbn_traits<dbn_t>::updater()>(epoch, layer_ctx.first, *layer_ctx.second, n);
+                // The layers are shared between the workers, they are only used as const
+                this->template forward_batch_context<true, true>(context, worker_inputs);
+
+                this_type::template backward_batch_context<true>(context, last - first, worker_labels);
+
+                cpp::for_each(context, [](auto& layer_ctx) {
+                    sgd_layer<true>(layer_ctx.first).compute_gradients(*layer_ctx.second);
+                });
+
+                std::tie(errors[t], losses[t]) = dbn.evaluate_metrics_batch(last_ctx.output, worker_labels, last - first, false);
             });
         }
 
+        // Tree-reduce the gradients into the first worker
+
+        {
+            dll::auto_timer timer("sgd::parallel::reduce");
+
+            for (size_t s = 1; s < active; s *= 2) {
+                cpp::parallel_foreach_n(workers.pool, 0, (active + 2 * s - 1) / (2 * s), [this, s, active](size_t p) {
+                    const size_t t = p * 2 * s;
+
+                    if (t + s < active) {
+                        this_type::reduce_gradients(workers.contexts[t], workers.contexts[t + s], std::make_index_sequence<layers>());
+                    }
+                });
+            }
+        }
+
+        // Apply the gradients
+
+        {
+            dll::auto_timer timer("sgd::grad");
+
+            this->update_weights(workers.contexts[0], n);
+        }
+
         // Update the counter of iterations
         ++iteration;
 
@@ -609,29 +1160,88 @@ struct sgd_trainer {
         double error = 0.0;
         double loss = 0.0;
 
-        {
-            dll::auto_timer timer("sgd::error");
-
-            std::tie(error, loss) = dbn.evaluate_metrics_batch(last_ctx.output, labels, n, true);
+        for (size_t t = 0; t < active; ++t) {
+            error += errors[t];
+            loss += losses[t];
         }
 
-        return std::make_pair(error, loss);
+        return std::make_pair(error / n, loss / n);
+    }
+
+    /*!
+     * \brief Accumulate the gradients of the rhs contexts into the lhs contexts
+     * \param lhs The contexts to accumulate into
+     * \param rhs The contexts to accumulate from
+     */
+    template <typename Context, size_t... I>
+    static void reduce_gradients(Context& lhs, Context& rhs, std::index_sequence<I...> /*seq*/) {
+        int unused[] = {(this_type::reduce_layer_gradients(std::get<I>(lhs).first, *std::get<I>(lhs).second, *std::get<I>(rhs).second), 1)...};
+        cpp_unused(unused);
+    }
+
+    /*!
+     * \brief Accumulate the gradients of the given layer
+     */
+    template <typename L, typename C, cpp_disable_if(decay_layer_traits<L>::is_neural_layer())>
+    static void reduce_layer_gradients(L& /*layer*/, C& /*lhs*/, C& /*rhs*/) {}
+
+    /*!
+     * \brief Accumulate the gradients of the given layer
+     */
+    template <typename L, typename C, cpp_enable_iff(decay_layer_traits<L>::is_neural_layer())>
+    static void reduce_layer_gradients(L& layer, C& lhs, C& rhs) {
+        static constexpr size_t N = std::tuple_size<decltype(layer.trainable_parameters())>();
+
+        reduce_variables(lhs, rhs, std::make_index_sequence<N>());
+    }
+
+    /*!
+     * \brief Accumulate the gradients of each variable of a layer
+     */
+    template <typename C, size_t... I>
+    static void reduce_variables(C& lhs, C& rhs, std::index_sequence<I...> /*seq*/) {
+        int unused[] = {((std::get<I>(lhs.up.context)->grad += std::get<I>(rhs.up.context)->grad), 1)...};
+        cpp_unused(unused);
     }
 
     //TODO
-    template <bool Train, typename Inputs>
+    template <bool Train, typename Inputs, size_t T = threads, cpp_enable_iff((T == 1))>
     auto& forward_batch_helper(dbn_t& dbn, Inputs&& inputs) {
         cpp_unused(dbn);
 
         return this->template forward_batch_helper<Train>(inputs);
     }
 
-    template <bool Train, typename Inputs>
+    /*!
+     * \brief Forward propagate a batch of inputs through the network.
+     *
+     * With parallel training, there is no context for the full batch, the
+     * batch is forwarded by the network itself.
+     */
+    template <bool Train, typename Inputs, size_t T = threads, cpp_enable_iff((T > 1))>
+    decltype(auto) forward_batch_helper(dbn_t& dbn, Inputs&& inputs) {
+        static_assert(!Train, "Parallel training can only forward batches in test mode");
+
+        return dbn.test_forward_batch(inputs);
+    }
+
+    template <bool Train, typename Inputs, size_t T = threads, cpp_enable_iff((T == 1))>
     auto& forward_batch_helper(Inputs&& inputs) {
+        return this->template forward_batch_context<Train>(full_context, inputs);
+    }
 
-        auto& first_layer = std::get<0>(full_context).first;
-        auto& first_ctx   = *std::get<0>(full_context).second;
-        auto& last_ctx    = *std::get<layers - 1>(full_context).second;
+    /*!
+     * \brief Forward propagate a batch of inputs through the given context
+     * \tparam Shared Indicates if the layers are shared between several workers
+     * \param context The context to use for the forward pass
+     * \param inputs A batch of inputs
+     * \return a reference to the output of the last layer
+     */
+    template <bool Train, bool Shared = false, typename Context, typename Inputs>
+    static auto& forward_batch_context(Context& context, Inputs&& inputs) {
+        auto& first_layer = sgd_layer<Shared>(std::get<0>(context).first);
+        auto& first_ctx   = *std::get<0>(context).second;
+        auto& last_ctx    = *std::get<layers - 1>(context).second;
 
         const auto n          = etl::dim<0>(inputs);
         const bool full_batch = n == etl::dim<0>(first_ctx.input);
@@ -651,330 +1261,272 @@ struct sgd_trainer {
         }
 
         if /*constexpr*/ (Train) {
-            first_layer.train_forward_batch(first_ctx.output, first_ctx.input);
+            sgd_train_forward(first_layer, first_ctx, 0);
         } else {
             first_layer.test_forward_batch(first_ctx.output, first_ctx.input);
         }
 
-        cpp::for_each_pair(full_context, [](auto& layer_ctx_1, auto& layer_ctx_2) {
-            auto& layer_2 = layer_ctx_2.first;
+        cpp::for_each_pair(context, [](auto& layer_ctx_1, auto& layer_ctx_2) {
+            auto& layer_2 = sgd_layer<Shared>(layer_ctx_2.first);
 
             auto& ctx1 = *layer_ctx_1.second;
             auto& ctx2 = *layer_ctx_2.second;
 
-            ctx2.input = ctx1.output;
+            sgd_forward_input(ctx1, ctx2, 0);
 
             if /*constexpr*/ (Train) {
-                layer_2.train_forward_batch(ctx2.output, ctx2.input);
+                sgd_train_forward(layer_2, ctx2, 0);
             } else {
-                layer_2.test_forward_batch(ctx2.output, ctx2.input);
+                layer_2.test_forward_batch(ctx2.output, sgd_input(ctx2));
             }
         });
 
         return last_ctx.output;
     }
 
-    // CPP17 Replace with if constexpr
-
-    template <updater_type UT, typename L, typename C, cpp_disable_if(decay_layer_traits<L>::is_neural_layer())>
-    void update_weights(size_t epoch, L& layer, C& context, size_t n) {
-        cpp_unused(epoch);
-        cpp_unused(layer);
-        cpp_unused(context);
-        cpp_unused(n);
-    }
-
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Apply the gradients to all the layers of the given context.
+     *
+     * The variables of all the layers are updated together, with the fused
+     * kernel of the updater, split in chunks between the threads of the
+     * workers (if any).
+     *
+     * \param context The context holding the gradients
+     * \param n The number of samples in the batch
      */
-    template <updater_type UT, typename L, typename C, cpp_enable_iff(decay_layer_traits<L>::is_neural_layer())>
-    void update_weights(size_t epoch, L& layer, C& context, size_t n) {
+    template <typename Context>
+    void update_weights(Context& context, size_t n) {
         dll::auto_timer timer("sgd::update_weights");
 
-        // Update all variables of the layer
-
-        static constexpr size_t N = std::tuple_size<decltype(layer.trainable_parameters())>();
-
-        update_variables<UT>(epoch, layer, context, n, std::make_index_sequence<N>());
-    }
-
-    template <updater_type UT, typename L, typename C, size_t... I>
-    void update_variables(size_t epoch, L& layer, C& context, size_t n, std::index_sequence<I...> /* args */) {
-        int unused[] = {(this->update_variable<I, UT>(epoch, layer, context, n), 1)...};
-        cpp_unused(unused);
-    }
-
-    template <size_t I, updater_type UT, typename L, typename C>
-    void update_variable(size_t epoch, L& layer, C& context, size_t n) {
         // 1. Decay the learning rate (if necessary)
 
-        auto eps             = dbn.learning_rate;
+        weight eps           = dbn.learning_rate;
         const auto eps_decay = dbn.learning_rate_decay;
 
         if (eps_decay > 0.0) {
             eps *= 1.0 / (1.0 + eps_decay * iteration);
         }
 
-        //2. Update the gradients (L1/L2 and gradient clipping)
+        // 2. Gather the variables of all the layers
 
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
+        variables.clear();
 
-        // Note the distinction for w and b for decay is far from optimal...
-        if /* constexpr */ (I == 0) {
-            this->update_grad<w_decay(dbn_traits<dbn_t>::decay())>(w, w_grad, n);
-        } else {
-            this->update_grad<b_decay(dbn_traits<dbn_t>::decay())>(w, w_grad, n);
-        }
+        cpp::for_each(context, [this, n, eps](auto& layer_ctx) {
+            this->add_parameters(layer_ctx.first, *layer_ctx.second, n, eps);
+        });
 
         // 3. Apply the gradients
 
-        apply_gradients<I, UT>(epoch, layer, context, n, eps);
+        apply_gradients();
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Apply the fused updates to the gathered variables, in parallel
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::SGD)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:sgd");
+    template <size_t T = threads, cpp_enable_iff((T > 1))>
+    void apply_gradients() {
+        dll::auto_timer timer("sgd::apply_grad");
 
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
+        cpp::parallel_foreach_n(workers.pool, 0, variables.chunks.size(), [this](size_t c) {
+            variables.template update<dbn_traits<dbn_t>::updater()>(c);
+        });
+    }
+
+    /*!
+     * \brief Apply the fused updates to the gathered variables
+     */
+    template <size_t T = threads, cpp_enable_iff((T == 1))>
+    void apply_gradients() {
+        dll::auto_timer timer("sgd::apply_grad");
 
-        w += (eps / n) * w_grad;
+        for (size_t c = 0; c < variables.chunks.size(); ++c) {
+            variables.template update<dbn_traits<dbn_t>::updater()>(c);
+        }
+    }
 
-        nan_check_deep(w);
+    // CPP17 Replace with if constexpr
 
-        cpp_unused(epoch);
+    template <typename L, typename C, cpp_disable_if(decay_layer_traits<L>::is_neural_layer())>
+    void add_parameters(L& layer, C& context, size_t n, weight eps) {
+        cpp_unused(layer);
+        cpp_unused(context);
+        cpp_unused(n);
+        cpp_unused(eps);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Gather the variables of the given layer
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::MOMENTUM)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:momentum");
+    template <typename L, typename C, cpp_enable_iff(decay_layer_traits<L>::is_neural_layer())>
+    void add_parameters(L& layer, C& context, size_t n, weight eps) {
+        static constexpr size_t N = std::tuple_size<decltype(layer.trainable_parameters())>();
 
-        const auto momentum = dbn.momentum;
+        add_variables(layer, context, n, eps, std::make_index_sequence<N>());
+    }
 
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_inc  = std::get<I>(context.up.context)->inc;
+    template <typename L, typename C, size_t... I>
+    void add_variables(L& layer, C& context, size_t n, weight eps, std::index_sequence<I...> /* args */) {
+        int unused[] = {(this->add_variable<I>(layer, context, n, eps), 1)...};
+        cpp_unused(unused);
+    }
 
-        //Update with momentum and learning rate
+    template <size_t I, typename L, typename C>
+    void add_variable(L& layer, C& context, size_t n, weight eps) {
+        auto& w   = std::get<I>(layer.trainable_parameters());
+        auto& sub = *std::get<I>(context.up.context);
 
-        w_inc = momentum * w_inc + (eps / n) * w_grad;
+        // Each layer is updated in its own data type
+        using value_type = etl::value_t<decltype(w)>;
 
-        w += w_inc;
+        static_assert(std::is_same<value_type, float>::value || std::is_same<value_type, double>::value, "The fused updates only support float and double");
 
-        nan_check_deep(w);
+        fused_parameter<value_type> p;
 
-        cpp_unused(epoch);
-    }
+        w.ensure_cpu_up_to_date();
+        w.invalidate_gpu();
+        sub.grad.ensure_cpu_up_to_date();
 
-    /*!
-     * \brief Apply the gradients to the given layer
-     */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::NESTEROV)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:nesterov");
+        p.w    = w.memory_start();
+        p.grad = sub.grad.memory_start();
+        p.size = etl::size(w);
 
-        const auto momentum = dbn.momentum;
+        // 1. The weight decay (L1/L2)
 
-        auto& w          = std::get<I>(layer.trainable_parameters());
-        auto& w_grad     = std::get<I>(context.up.context)->grad;
-        auto& w_inc      = std::get<I>(context.up.context)->inc;
-        auto& w_inc_prev = std::get<I>(context.up.context)->inc_prev;
+        // Note the distinction for w and b for decay is far from optimal...
+        constexpr auto decay = I == 0 ? w_decay(dbn_traits<dbn_t>::decay()) : b_decay(dbn_traits<dbn_t>::decay());
 
-        //Update with momentum and learning rate
+        if (decay == decay_type::L1 || decay == decay_type::L1L2) {
+            p.l1 = dbn.l1_weight_cost;
+        }
 
-        w_inc_prev = w_inc;
+        if (decay == decay_type::L2 || decay == decay_type::L1L2) {
+            p.l2 = dbn.l2_weight_cost;
+        }
 
-        w_inc = momentum * w_inc + (eps / n) * w_grad;
+        // 2. The gradient clipping
 
-        w += (-momentum) * w_inc_prev + (1.0 + momentum) * w_inc;
+        p.scale = clip_gradients(p, n);
 
-        nan_check_deep(w);
+        // 3. The states and coefficients of the updater
 
-        cpp_unused(epoch);
+        prepare_update<I, dbn_traits<dbn_t>::updater()>(p, sub, n, eps);
+
+        variables.push_back(p);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Set the given state of the updater for the fused update
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::ADAGRAD)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:adagrad");
-
-        const auto e = 1e-8;
-
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_inc  = std::get<I>(context.up.context)->inc;
-
-        w_inc = w_inc + (w_grad >> w_grad);
+    template <typename T, typename S>
+    static void fused_state(fused_parameter<T>& p, size_t i, S& state) {
+        state.ensure_cpu_up_to_date();
+        state.invalidate_gpu();
 
-        w += (eps >> w_grad) / etl::sqrt(w_inc + e);
+        p.s[i] = state.memory_start();
+    }
 
-        nan_check_deep(w);
+    /*!
+     * \brief Prepare the fused update of a variable
+     */
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::SGD)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
+        p.k[0] = eps / n;
 
-        cpp_unused(n);
-        cpp_unused(epoch);
+        cpp_unused(sub);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Prepare the fused update of a variable
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::ADADELTA)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:adadelta");
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::MOMENTUM || UT == updater_type::NESTEROV)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
+        fused_state(p, 0, sub.inc);
 
-        const auto beta = dbn.adadelta_beta;
-        const auto e = 1e-8;
-
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_g    = std::get<I>(context.up.context)->g;
-        auto& w_v    = std::get<I>(context.up.context)->v;
-        auto& w_x    = std::get<I>(context.up.context)->x;
+        cpp::static_if<UT == updater_type::NESTEROV>([&](auto f) {
+            fused_state(p, 1, f(sub).inc_prev);
+        });
 
-        w_g = beta * w_g + ((1.0 - beta) >> w_grad >> w_grad);
-        w_v = (sqrt(w_x + e) >> w_grad) / sqrt(w_g + e);
-        w_x = beta * w_x + ((1.0 - beta) >> w_v >> w_v);
+        p.k[0] = dbn.momentum;
+        p.k[1] = eps / n;
+    }
 
-        w += w_v;
+    /*!
+     * \brief Prepare the fused update of a variable
+     */
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::RMSPROP || UT == updater_type::ADAGRAD)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
+        fused_state(p, 0, sub.inc);
 
-        nan_check_deep(w);
+        p.k[0] = dbn.rmsprop_decay;
+        p.k[1] = eps;
 
         cpp_unused(n);
-        cpp_unused(epoch);
-        cpp_unused(eps);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Prepare the fused update of a variable
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::ADAM)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:adam");
-
-        const auto beta1 = dbn.adam_beta1;
-        const auto beta2 = dbn.adam_beta2;
-        const auto e = 1e-8;
-
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_m    = std::get<I>(context.up.context)->m;
-        auto& w_v    = std::get<I>(context.up.context)->v;
-
-        // Standard Adam estimations of the first and second moments
-
-        w_m = beta1 * w_m + ((1.0 - beta1) >> w_grad);
-        w_v = beta2 * w_v + ((1.0 - beta2) >> (w_grad >> w_grad));
-
-        // Update the parameters
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::ADADELTA)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
+        fused_state(p, 0, sub.g);
+        fused_state(p, 1, sub.x);
+        fused_state(p, 2, sub.v);
 
-        w += (eps >> w_m) / (etl::sqrt(w_v) + e);
-
-        nan_check_deep(w);
+        p.k[0] = dbn.adadelta_beta;
 
         cpp_unused(n);
-        cpp_unused(epoch);
+        cpp_unused(eps);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Prepare the fused update of a variable
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::ADAM_CORRECT)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:adam_correct");
-
-        const auto beta1 = dbn.adam_beta1;
-        const auto beta2 = dbn.adam_beta2;
-        const auto e = 1e-8;
-        const auto t = iteration;
-
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_m    = std::get<I>(context.up.context)->m;
-        auto& w_mt   = std::get<I>(context.up.context)->mt;
-        auto& w_v    = std::get<I>(context.up.context)->v;
-        auto& w_vt   = std::get<I>(context.up.context)->vt;
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::ADAM || UT == updater_type::ADAMAX)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
+        fused_state(p, 0, sub.m);
+        fused_state(p, 1, sub.v);
 
-        // Standard Adam estimations of the first and second moments
-
-        w_m = beta1 * w_m + ((1.0 - beta1) >> w_grad);
-        w_v = beta2 * w_v + ((1.0 - beta2) >> (w_grad >> w_grad));
-
-        // Correct the bias (towards zero) of the first and second moments
-
-        w_mt = w_m / (1.0 - std::pow(beta1, t));
-        w_vt = w_v / (1.0 - std::pow(beta2, t));
-
-        // Update the parameters
-
-        w += (eps >> w_m) / (etl::sqrt(w_v) + e);
-
-        nan_check_deep(w);
+        p.k[0] = dbn.adam_beta1;
+        p.k[1] = dbn.adam_beta2;
+        p.k[2] = eps;
 
         cpp_unused(n);
-        cpp_unused(epoch);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Prepare the fused update of a variable
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::ADAMAX)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:adamax");
-
-        const auto beta1 = dbn.adam_beta1;
-        const auto beta2 = dbn.adam_beta2;
-
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_m    = std::get<I>(context.up.context)->m;
-        auto& w_v    = std::get<I>(context.up.context)->v;
-
-        // Standard Adam estimations of the first moment
-
-        w_m = beta1 * w_m + ((1.0 - beta1) >> w_grad);
-
-        // Estimation of the second moment with infinite-norm
-
-        w_v = etl::max(beta2 * w_v, etl::abs(w_grad));
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::ADAM_CORRECT)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
+        const auto t = iteration;
 
-        // Update the parameters
+        fused_state(p, 0, sub.m);
+        fused_state(p, 1, sub.mt);
+        fused_state(p, 2, sub.v);
+        fused_state(p, 3, sub.vt);
 
-        w += (eps >> w_m) / w_v;
+        p.k[0] = dbn.adam_beta1;
+        p.k[1] = dbn.adam_beta2;
+        p.k[2] = eps;
 
-        nan_check_deep(w);
+        // Correction of the bias (towards zero) of the first and second moments
+        p.k[3] = 1.0 - std::pow(dbn.adam_beta1, t);
+        p.k[4] = 1.0 - std::pow(dbn.adam_beta2, t);
 
         cpp_unused(n);
-        cpp_unused(epoch);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Prepare the fused update of a variable
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::NADAM)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:nadam");
-
+    template <size_t I, updater_type UT, typename T, typename S, cpp_enable_iff(UT == updater_type::NADAM)>
+    void prepare_update(fused_parameter<T>& p, S& sub, size_t n, weight eps) {
         const weight beta1          = dbn.adam_beta1;
         const weight beta2          = dbn.adam_beta2;
         const weight schedule_decay = dbn.nadam_schedule_decay;
-        const weight e              = 1e-8;
         const weight t              = iteration;
 
-        auto& w          = std::get<I>(layer.trainable_parameters());
-        auto& w_grad     = std::get<I>(context.up.context)->grad;
-        auto& w_m        = std::get<I>(context.up.context)->m;
-        auto& w_mt       = std::get<I>(context.up.context)->mt;
-        auto& w_v        = std::get<I>(context.up.context)->v;
-        auto& w_vt       = std::get<I>(context.up.context)->vt;
-        auto& m_schedule = std::get<I>(context.up.context)->m_schedule;
+        auto& m_schedule = sub.m_schedule;
 
         // Compute the schedule for momentum
 
@@ -988,116 +1540,58 @@ struct sgd_trainer {
             m_schedule = m_schedule_new;
         }
 
-        // Standard Adam estimations of the first and second order moments
-
-        w_m = beta1 * w_m + ((1.0 - beta1) >> w_grad);
-        w_v = beta2 * w_v + ((1.0 - beta2) >> (w_grad >> w_grad));
-
-        // Correct the bias (towards zero) of the first and second moments
-
-        w_mt = w_m / (1.0 - m_schedule_next);
-        w_vt = w_v / (1.0 - std::pow(beta2, t));
-
-        // Update the parameters
+        fused_state(p, 0, sub.m);
+        fused_state(p, 1, sub.mt);
+        fused_state(p, 2, sub.v);
+        fused_state(p, 3, sub.vt);
 
         weight f1 = 1.0 - momentum_cache_t;
         weight f2 = 1.0 - m_schedule_new;
 
-        weight m1 = eps * (f1 / f2);
-        weight m2 = eps * momentum_cache_t_1;
-
-        w += (m1 * w_grad + m2 * w_mt) / (etl::sqrt(w_vt) + e);
-
-        nan_check_deep(w);
+        p.k[0] = beta1;
+        p.k[1] = beta2;
+        p.k[2] = 1.0 - m_schedule_next;
+        p.k[3] = 1.0 - std::pow(beta2, t);
+        p.k[4] = eps * (f1 / f2);
+        p.k[5] = eps * momentum_cache_t_1;
 
         cpp_unused(n);
-        cpp_unused(epoch);
     }
 
     /*!
-     * \brief Apply the gradients to the given layer
+     * \brief Compute the clipping factor of the (decayed) gradients of the
+     * given variable
      */
-    template <size_t I, updater_type UT, typename L, typename C, cpp_enable_iff(UT == updater_type::RMSPROP)>
-    void apply_gradients(size_t epoch, L& layer, C& context, size_t n, weight eps) {
-        dll::auto_timer timer("sgd::apply_grad:rmsprop");
-
-        const auto decay = dbn.rmsprop_decay;
-        const auto e = 1e-8;
-
-        auto& w      = std::get<I>(layer.trainable_parameters());
-        auto& w_grad = std::get<I>(context.up.context)->grad;
-        auto& w_inc  = std::get<I>(context.up.context)->inc;
-
-        w_inc = decay * w_inc + (1 - decay) * (w_grad >> w_grad);
-
-        w += (eps >> w_grad) / etl::sqrt(w_inc + e);
+    template <typename T, typename D = dbn_t, cpp_enable_iff(dbn_traits<D>::has_clip_gradients())>
+    T clip_gradients(const fused_parameter<T>& p, size_t n) {
+        const auto t = dbn.gradient_clip;
 
-        nan_check_deep(w);
+        T sum = 0;
 
-        cpp_unused(n);
-        cpp_unused(epoch);
-    }
+        for (size_t i = 0; i < p.size; ++i) {
+            const T g = p.grad[i] - p.l1 * std::abs(p.w[i]) - p.l2 * p.w[i];
+            sum += g * g;
+        }
 
-    /*!
-     * \brief Update the given gradients according to the given decay function
-     */
-    template <typename D = dbn_t, typename G, cpp_enable_iff(dbn_traits<D>::has_clip_gradients())>
-    void clip_gradients(G& grad, size_t n) {
-        const auto t = dbn.gradient_clip;
-        const auto grad_l2_norm = std::sqrt(etl::sum(grad >> grad) / (n * n));
+        const auto grad_l2_norm = std::sqrt(sum / (n * n));
 
         if(grad_l2_norm > t){
-            grad = grad >> (t / grad_l2_norm);
+            return t / grad_l2_norm;
         }
-    }
 
-    /*!
-     * \brief Update the given gradients according to the given decay function
-     */
-    template <typename D = dbn_t, typename G, cpp_disable_if(dbn_traits<D>::has_clip_gradients())>
-    void clip_gradients(G& grad, size_t n) {
-        cpp_unused(grad);
-        cpp_unused(n);
+        return 1.0;
     }
 
     /*!
-     * \brief Update the given gradients according to the given decay function
+     * \brief Compute the clipping factor of the (decayed) gradients of the
+     * given variable
      */
-    template <decay_type decay, typename V, typename G, cpp_enable_iff(decay == decay_type::L1)>
-    void update_grad(const V& value, G& grad, size_t n) {
-        grad = grad - dbn.l1_weight_cost * abs(value);
-
-        clip_gradients(grad, n);
-    }
-
-    /*!
-     * \brief Update the given gradients according to the given decay function
-     */
-    template <decay_type decay, typename V, typename G, cpp_enable_iff(decay == decay_type::L2)>
-    void update_grad(const V& value, G& grad, size_t n) {
-        grad = grad - dbn.l2_weight_cost * value;
-
-        clip_gradients(grad, n);
-    }
-
-    /*!
-     * \brief Update the given gradients according to the given decay function
-     */
-    template <decay_type decay, typename V, typename G, cpp_enable_iff(decay == decay_type::L1L2)>
-    void update_grad(const V& value, G& grad, size_t n) {
-        grad = grad - dbn.l1_weight_cost * abs(value) - dbn.l2_weight_cost * value;
-
-        clip_gradients(grad, n);
-    }
-
-    /*!
-     * \brief Update the given gradients according to the given decay function
-     */
-    template <decay_type decay, typename V, typename G, cpp_enable_iff(decay == decay_type::NONE)>
-    void update_grad(const V& value, G& grad, size_t n) {
-        clip_gradients(grad, n);
+    template <typename T, typename D = dbn_t, cpp_disable_if(dbn_traits<D>::has_clip_gradients())>
+    T clip_gradients(const fused_parameter<T>& p, size_t n) {
+        cpp_unused(p);
+        cpp_unused(n);
 
-        cpp_unused(value);
+        return 1.0;
     }
 
     /*!
@@ -155,8 +155,8 @@ struct cg_context<binarize_layer_impl<Desc>> {
     etl::fast_matrix<weight, 1, 1> gr_w_tmp;
     etl::fast_vector<weight, 1> gr_b_tmp;
 
-    std::vector<etl::dyn_vector<weight>> gr_probs_a;
-    std::vector<etl::dyn_vector<weight>> gr_probs_s;
+    etl::dyn_matrix<weight, 2> gr_probs_a;
+    etl::dyn_matrix<weight, 2> gr_diffs;
 };
 
 } //end of dll namespace
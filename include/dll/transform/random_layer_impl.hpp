@@ -20,6 +20,8 @@ struct random_layer_impl : transform_layer<random_layer_impl<Desc>> {
     using desc      = Desc;                                ///< The descriptor type
     using base_type = transform_layer<random_layer_impl<Desc>>; ///< The base type
 
+    static constexpr bool reentrant = false; ///< The test forward pass draws from the random engine
+
     /*!
      * \brief Returns a string representation of the layer
      */
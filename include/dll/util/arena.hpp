@@ -0,0 +1,267 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Memory arena used to allocate the training contexts of a network
+ * from a single contiguous block.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+
+#include <sys/mman.h>
+
+namespace dll {
+
+constexpr size_t arena_alignment       = 64;              ///< The minimum alignment of the allocations of the arena
+constexpr size_t arena_huge_page_size  = 2 * 1024 * 1024; ///< The size of a huge page
+constexpr size_t arena_shared_overhead = 64;              ///< The maximum size of the control block of a std::shared_ptr
+
+namespace arena_detail {
+
+/*!
+ * \brief Align the given size on the given alignment
+ */
+constexpr size_t align(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/*!
+ * \brief Compute the sum of the given sizes
+ */
+constexpr size_t sum(std::initializer_list<size_t> sizes) {
+    size_t s = 0;
+
+    for (auto size : sizes) {
+        s += size;
+    }
+
+    return s;
+}
+
+} // end of namespace arena_detail
+
+/*!
+ * \brief Return the space needed in an arena for an object allocated with
+ * std::allocate_shared
+ */
+template <typename T>
+constexpr size_t arena_shared_size() {
+    return arena_detail::align(sizeof(T) + arena_shared_overhead, std::max(arena_alignment, alignof(T)));
+}
+
+/*!
+ * \brief Return the space needed in an arena for a tuple of std::shared_ptr
+ * allocated with std::allocate_shared
+ */
+template <typename T>
+struct arena_shared_tuple_size : std::integral_constant<size_t, 0> {};
+
+/*!
+ * \copydoc arena_shared_tuple_size
+ */
+template <typename... T>
+struct arena_shared_tuple_size<std::tuple<std::shared_ptr<T>...>> : std::integral_constant<size_t, arena_detail::sum({size_t(0), arena_shared_size<T>()...})> {};
+
+/*!
+ * \brief A memory arena.
+ *
+ * The arena reserves a single aligned block of memory at construction and
+ * carves the allocations from it, in order. Memory is never given back to the
+ * arena before it is destroyed. When the arena is exhausted, the allocations
+ * are forwarded to the heap.
+ */
+struct memory_arena {
+    /*!
+     * \brief Construct an empty arena (every allocation goes to the heap)
+     */
+    memory_arena() = default;
+
+    /*!
+     * \brief Construct an arena of the given capacity
+     * \param capacity The capacity, in bytes, of the arena
+     * \param huge_pages Indicates if the arena should use huge pages
+     */
+    explicit memory_arena(size_t capacity, bool huge_pages = false) {
+        reserve(capacity, huge_pages);
+    }
+
+    memory_arena(const memory_arena& rhs) = delete;
+    memory_arena& operator=(const memory_arena& rhs) = delete;
+
+    /*!
+     * \brief Release the memory of the arena
+     */
+    ~memory_arena() {
+        std::free(memory);
+    }
+
+    /*!
+     * \brief Reserve the memory of the arena.
+     *
+     * This must be done before any allocation.
+     *
+     * \param capacity The capacity, in bytes, of the arena
+     * \param huge_pages Indicates if the arena should use huge pages
+     */
+    void reserve(size_t capacity, bool huge_pages = false) {
+        const size_t alignment = huge_pages ? arena_huge_page_size : arena_alignment;
+        const size_t size      = arena_detail::align(capacity, alignment);
+
+        void* block = nullptr;
+        if (size && posix_memalign(&block, alignment, size) == 0) {
+            memory = static_cast<char*>(block);
+            length = size;
+
+#ifdef MADV_HUGEPAGE
+            if (huge_pages) {
+                madvise(memory, length, MADV_HUGEPAGE);
+            }
+#endif
+        }
+    }
+
+    /*!
+     * \brief Allocate memory from the arena
+     * \param size The number of bytes to allocate
+     * \param alignment The alignment of the allocation
+     * \return a pointer to the allocated memory
+     */
+    void* allocate(size_t size, size_t alignment) {
+        alignment = std::max(alignment, arena_alignment);
+
+        const size_t start = arena_detail::align(used, alignment);
+
+        if (memory && start + size <= length) {
+            used = start + size;
+            return memory + start;
+        }
+
+        void* block = nullptr;
+        if (posix_memalign(&block, alignment, size) != 0) {
+            throw std::bad_alloc();
+        }
+
+        overflow += size;
+
+        return block;
+    }
+
+    /*!
+     * \brief Release memory allocated from the arena.
+     *
+     * The memory in the arena is only released when the arena is destroyed,
+     * only the memory that overflowed to the heap is released.
+     *
+     * \param ptr The memory to release
+     * \param size The number of allocated bytes
+     */
+    void deallocate(void* ptr, size_t size) {
+        if (!owns(ptr)) {
+            std::free(ptr);
+            overflow -= size;
+        }
+    }
+
+    /*!
+     * \brief Indicates if the given memory is part of the arena
+     */
+    bool owns(const void* ptr) const {
+        auto p = static_cast<const char*>(ptr);
+        return memory && p >= memory && p < memory + length;
+    }
+
+    /*!
+     * \brief Returns the capacity of the arena, in bytes
+     */
+    size_t capacity() const {
+        return length;
+    }
+
+    /*!
+     * \brief Returns the number of bytes allocated from the arena
+     */
+    size_t size() const {
+        return used;
+    }
+
+    /*!
+     * \brief Returns the number of bytes that had to be allocated on the heap
+     * because the arena was exhausted
+     */
+    size_t heap_size() const {
+        return overflow;
+    }
+
+private:
+    char* memory    = nullptr; ///< The memory of the arena
+    size_t length   = 0;       ///< The capacity of the arena
+    size_t used     = 0;       ///< The used memory of the arena
+    size_t overflow = 0;       ///< The memory allocated on the heap
+};
+
+/*!
+ * \brief Standard allocator using a memory arena
+ */
+template <typename T>
+struct arena_allocator {
+    using value_type = T; ///< The type of allocated values
+
+    memory_arena* arena; ///< The arena to allocate from
+
+    /*!
+     * \brief Construct an allocator for the given arena
+     */
+    explicit arena_allocator(memory_arena& arena) : arena(&arena) {}
+
+    /*!
+     * \brief Construct an allocator from an allocator of another type
+     */
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& rhs) : arena(rhs.arena) {}
+
+    /*!
+     * \brief Allocate n values
+     */
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /*!
+     * \brief Release n values
+     */
+    void deallocate(T* ptr, size_t n) {
+        arena->deallocate(ptr, n * sizeof(T));
+    }
+};
+
+/*!
+ * \brief Compare two arena allocators
+ */
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) {
+    return lhs.arena == rhs.arena;
+}
+
+/*!
+ * \brief Compare two arena allocators
+ */
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) {
+    return lhs.arena != rhs.arena;
+}
+
+} //end of dll namespace
@@ -0,0 +1,196 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief A pool of threads decoding samples ahead of a reader
+ */
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "cpp_utils/parallel.hpp"
+
+namespace dll {
+
+/*!
+ * \brief A pool of threads decoding samples ahead of the reader.
+ *
+ * The samples are decoded into a ring of slots, the samples [consumer,
+ * consumer + window) can be in flight at any time. Reading the samples out
+ * of order restarts the decoding from the requested sample.
+ *
+ * The threads are only started when the first sample is read, so that a
+ * decoder that is never read does not decode anything.
+ *
+ * \tparam T The type of the decoded samples
+ */
+template <typename T>
+struct parallel_decoder {
+    static constexpr size_t npos = std::numeric_limits<size_t>::max(); ///< Marker for an empty slot
+
+    using decode_t = std::function<void(size_t, T&)>; ///< The function decoding a sample
+
+    /*!
+     * \brief The state of a slot in the ring
+     */
+    enum class slot_state {
+        EMPTY,    ///< The slot can be used for a new sample
+        DECODING, ///< The slot is being decoded
+        READY     ///< The slot contains a decoded sample
+    };
+
+    const size_t n;       ///< The number of samples
+    decode_t decode;      ///< The function decoding a sample
+    const size_t workers; ///< The number of decoding threads
+    const size_t window;  ///< The number of samples in flight
+
+    std::vector<T> slots;                ///< The decoded samples
+    std::vector<size_t> slot_index;      ///< The index of the sample in each slot
+    std::vector<slot_state> slot_states; ///< The state of each slot
+
+    size_t next     = 0; ///< The next sample to decode
+    size_t consumer = 0; ///< The next sample to be read
+
+    std::mutex lock;               ///< The lock protecting the ring
+    std::condition_variable work;  ///< Condition for decoders to wait for free slots
+    std::condition_variable ready; ///< Condition for the reader to wait for decoded samples
+    bool stop_flag = false;        ///< Indicates to the threads to stop
+
+    std::vector<std::thread> threads; ///< The decoding threads
+
+    /*!
+     * \brief Construct a decoder
+     * \param n The number of samples
+     * \param decode The function decoding the sample at the given index
+     * \param workers The number of decoding threads (0 for the hardware concurrency)
+     * \param window The number of samples decoded ahead
+     */
+    parallel_decoder(size_t n, decode_t decode, size_t workers, size_t window)
+            : n(n), decode(std::move(decode)),
+              workers(workers ? workers : std::max(std::thread::hardware_concurrency(), 1U)),
+              window(std::max(window, size_t(1))),
+              slots(this->window), slot_index(this->window, npos), slot_states(this->window, slot_state::EMPTY) {
+        // The threads are started on the first read
+    }
+
+    parallel_decoder(const parallel_decoder& rhs) = delete;
+    parallel_decoder& operator=(const parallel_decoder& rhs) = delete;
+
+    /*!
+     * \brief Stop and join the decoding threads
+     */
+    ~parallel_decoder() {
+        cpp::with_lock(lock, [this] { stop_flag = true; });
+
+        work.notify_all();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /*!
+     * \brief Return the sample at the given index
+     * \param i The index of the sample
+     * \return The decoded sample
+     */
+    T get(size_t i) {
+        std::unique_lock<std::mutex> ulock(lock);
+
+        if (threads.empty()) {
+            next     = i;
+            consumer = i;
+
+            for (size_t t = 0; t < workers; ++t) {
+                threads.emplace_back([this] { decode_loop(); });
+            }
+        } else if (i != consumer) {
+            restart(ulock, i);
+        }
+
+        const size_t s = i % window;
+
+        ready.wait(ulock, [this, s, i] { return slot_states[s] == slot_state::READY && slot_index[s] == i; });
+
+        T sample(slots[s]);
+
+        slot_states[s] = slot_state::EMPTY;
+        slot_index[s]  = npos;
+        consumer       = i + 1;
+
+        work.notify_all();
+
+        return sample;
+    }
+
+private:
+    /*!
+     * \brief Restart the decoding from the given sample
+     */
+    void restart(std::unique_lock<std::mutex>& ulock, size_t i) {
+        // Wait for the samples being decoded
+        ready.wait(ulock, [this] {
+            return std::none_of(slot_states.begin(), slot_states.end(), [](slot_state s) { return s == slot_state::DECODING; });
+        });
+
+        std::fill(slot_states.begin(), slot_states.end(), slot_state::EMPTY);
+        std::fill(slot_index.begin(), slot_index.end(), npos);
+
+        next     = i;
+        consumer = i;
+
+        work.notify_all();
+    }
+
+    /*!
+     * \brief The main loop of a decoding thread
+     */
+    void decode_loop() {
+        while (true) {
+            size_t i;
+            size_t s;
+
+            {
+                std::unique_lock<std::mutex> ulock(lock);
+
+                work.wait(ulock, [this] {
+                    return stop_flag || (next < n && next < consumer + window && slot_states[next % window] == slot_state::EMPTY);
+                });
+
+                if (stop_flag) {
+                    return;
+                }
+
+                i = next++;
+                s = i % window;
+
+                slot_states[s] = slot_state::DECODING;
+                slot_index[s]  = i;
+            }
+
+            decode(i, slots[s]);
+
+            {
+                std::unique_lock<std::mutex> ulock(lock);
+
+                slot_states[s] = slot_state::READY;
+
+                ready.notify_all();
+            }
+        }
+    }
+};
+
+} //end of dll namespace
@@ -7,7 +7,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <random>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <thread>
 
 namespace dll {
 
@@ -45,21 +50,229 @@ inline size_t seed(){
 }
 
 /*!
- * \brief Set the seed of the DLL
- * \param new_seed The new seed (cannot be zero)
+ * \brief Counter-based random number generator.
+ *
+ * This returns 32 random bits for the given key and counter. This is
+ * stateless and only uses 32-bit integer operations, so filling an array
+ * with the random values of consecutive counters can be vectorized.
+ *
+ * \param key The key of the random stream
+ * \param counter The position in the random stream
+ * \return 32 random bits
  */
-inline void set_seed(size_t new_seed){
-    detail::seed_impl(new_seed);
+inline uint32_t counter_random(uint32_t key, uint32_t counter){
+    uint32_t x = counter * 0x9E3779B9U + key;
+
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+
+    // Inject the key again so that streams of different keys are not shifts of each other
+    x ^= key;
+
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+
+    return x;
+}
+
+namespace detail {
+
+/*!
+ * \brief Mix two values into a new well-distributed 64-bit seed.
+ *
+ * This uses the finalizer of splitmix64, which makes seeds of consecutive
+ * indices completely decorrelated.
+ *
+ * \param base The base seed
+ * \param index The index to mix into the seed
+ * \return The mixed seed
+ */
+inline uint64_t mix_seed(uint64_t base, uint64_t index){
+    uint64_t z = base + (index + 1) * 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+/*!
+ * \brief Return the counter used to allocate the random streams.
+ *
+ * The stream 0 is reserved for the main thread.
+ */
+inline std::atomic<size_t>& stream_counter(){
+    static std::atomic<size_t> counter{1};
+    return counter;
+}
+
+/*!
+ * \brief Holder of the id of the main thread, captured during the static
+ * initialization of the program.
+ */
+template <typename T = void>
+struct main_thread {
+    static const std::thread::id id; ///< The id of the main thread
+};
+
+template <typename T>
+const std::thread::id main_thread<T>::id = std::this_thread::get_id();
+
+} // end of namespace detail
+
+constexpr size_t main_stream   = 0;                                   ///< The random stream of the main thread
+constexpr size_t worker_stream = std::numeric_limits<size_t>::max();     ///< The random stream whose sub streams are used by the parallel workers
+constexpr size_t thread_stream = std::numeric_limits<size_t>::max() - 1; ///< The random stream whose sub streams are used by the other threads
+
+/*!
+ * \brief Allocate a new random stream.
+ *
+ * The components needing their own stream (the generators, for instance)
+ * allocate it at construction. Setting the seed restarts the allocation,
+ * so a program building its components in the same order always gets the
+ * same streams.
+ *
+ * \return The index of the new stream
+ */
+inline size_t new_random_stream(){
+    return detail::stream_counter()++;
+}
+
+/*!
+ * \brief Return the seed of the given random stream.
+ *
+ * The seeds are derived from the DLL seed, the stream 0 directly using it.
+ *
+ * \param stream The index of the random stream
+ * \return The seed of the random stream
+ */
+inline size_t stream_seed(size_t stream){
+    return stream ? size_t(detail::mix_seed(seed(), stream)) : seed();
+}
+
+/*!
+ * \brief Return the seed of a sub stream of the given random stream
+ * \param stream The index of the random stream
+ * \param index The index of the sub stream
+ * \return The seed of the sub stream
+ */
+inline size_t stream_seed(size_t stream, size_t index){
+    return size_t(detail::mix_seed(stream_seed(stream), index));
 }
 
 /*!
- * \brief Return a reference to the DLL random engine
+ * \brief Return the seed of the engine of the given parallel worker.
+ *
+ * This only depends on the index of the worker, not on the thread running it.
+ *
+ * \param worker The index of the worker
+ * \return The seed of the engine of the worker
+ */
+inline size_t worker_seed(size_t worker){
+    return stream_seed(worker_stream, worker);
+}
+
+namespace detail {
+
+/*!
+ * \brief Return the seed of the own engine of the current thread.
+ *
+ * The main thread uses the stream 0. The other threads should only draw
+ * through the engine of a random_engine_scope, their own engine is seeded
+ * from their id and is therefore not reproducible.
+ */
+inline size_t thread_seed(){
+    const auto id = std::this_thread::get_id();
+
+    if (id == main_thread<>::id) {
+        return stream_seed(main_stream);
+    }
+
+    return stream_seed(thread_stream, std::hash<std::thread::id>()(id));
+}
+
+/*!
+ * \brief The random state of a thread
+ */
+struct thread_random_state {
+    random_engine engine;   ///< The own engine of the thread
+    random_engine* current; ///< The engine currently used by the thread
+
+    thread_random_state() : engine(thread_seed()), current(&engine) {}
+};
+
+/*!
+ * \brief Return the random state of the current thread
+ */
+inline thread_random_state& thread_random(){
+    thread_local thread_random_state state;
+    return state;
+}
+
+} // end of namespace detail
+
+/*!
+ * \brief Return a reference to the DLL random engine of the current thread.
+ *
+ * The main thread uses the stream 0, which is seeded directly from the DLL
+ * seed. The parallel workers draw from the engine installed by their
+ * random_engine_scope.
+ *
  * \return The DLL random engine
  */
 inline random_engine& rand_engine(){
-    static random_engine engine(seed());
+    return *detail::thread_random().current;
+}
 
-    return engine;
+/*!
+ * \brief Set the seed of the DLL.
+ *
+ * This reseeds the engine of the current thread and restarts the
+ * allocation of the random streams.
+ *
+ * \param new_seed The new seed (cannot be zero)
+ */
+inline void set_seed(size_t new_seed){
+    detail::seed_impl(new_seed);
+
+    detail::stream_counter() = 1;
+    detail::thread_random().engine = random_engine(detail::thread_seed());
 }
 
+/*!
+ * \brief Make rand_engine() use the given engine in the current thread
+ * for the lifetime of the scope.
+ *
+ * This is used by the parallel workers so that the random numbers only
+ * depend on the worker and not on the thread executing it.
+ */
+struct random_engine_scope {
+    /*!
+     * \brief Install the given engine in the current thread
+     * \param engine The engine to install
+     */
+    explicit random_engine_scope(random_engine& engine) : previous(detail::thread_random().current) {
+        detail::thread_random().current = &engine;
+    }
+
+    random_engine_scope(const random_engine_scope& rhs) = delete;
+    random_engine_scope& operator=(const random_engine_scope& rhs) = delete;
+
+    /*!
+     * \brief Restore the previous engine of the thread
+     */
+    ~random_engine_scope(){
+        detail::thread_random().current = previous;
+    }
+
+private:
+    random_engine* previous; ///< The previous engine of the thread
+};
+
 } //end of dll namespace
@@ -0,0 +1,380 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Packed binary shard format for datasets.
+ *
+ * A shard is made of a fixed-size header, followed by the samples stored
+ * contiguously (uint8 or float) and then by one float label per sample.
+ * Both sections are aligned so that they can be used directly from a
+ * memory-mapped file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <algorithm>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "etl/etl.hpp"
+
+namespace dll {
+
+/*!
+ * \brief The type of the values stored in a shard
+ */
+enum class shard_type : uint32_t {
+    UINT8 = 0, ///< Values are stored as 8-bit unsigned integers
+    FLOAT = 1  ///< Values are stored as single-precision floats
+};
+
+constexpr const char shard_magic[4]    = {'D', 'L', 'L', 'S'}; ///< The magic of a shard file
+constexpr uint32_t shard_version       = 1;                    ///< The version of the shard format
+constexpr size_t shard_alignment       = 64;                   ///< The alignment of the sections of a shard
+constexpr size_t shard_max_dimensions  = 3;                    ///< The maximum number of dimensions of a sample
+
+/*!
+ * \brief The header of a shard file
+ */
+struct shard_header {
+    char magic[4];                          ///< The magic ("DLLS")
+    uint32_t version;                       ///< The version of the format
+    uint32_t type;                          ///< The type of the values (shard_type)
+    uint32_t dimensions;                    ///< The number of dimensions of a sample
+    uint64_t dims[shard_max_dimensions];    ///< The dimensions of a sample
+    uint64_t samples;                       ///< The number of samples
+    uint64_t classes;                       ///< The number of classes (0 if unknown)
+    uint64_t data_offset;                   ///< The offset of the samples in the file
+    uint64_t label_offset;                  ///< The offset of the labels in the file
+
+    /*!
+     * \brief Return the number of values of one sample
+     */
+    size_t sample_size() const {
+        size_t s = 1;
+
+        for (size_t d = 0; d < dimensions; ++d) {
+            s *= dims[d];
+        }
+
+        return s;
+    }
+
+    /*!
+     * \brief Return the size, in bytes, of one value
+     */
+    size_t value_size() const {
+        return type == uint32_t(shard_type::UINT8) ? sizeof(uint8_t) : sizeof(float);
+    }
+};
+
+static_assert(std::is_standard_layout<shard_header>::value, "The shard header must be standard layout");
+
+namespace shard_detail {
+
+/*!
+ * \brief Align the given offset on the shard alignment
+ */
+inline size_t align(size_t offset) {
+    return (offset + shard_alignment - 1) / shard_alignment * shard_alignment;
+}
+
+/*!
+ * \brief Pad the given stream up to the given offset
+ */
+inline void pad(std::ostream& stream, size_t offset) {
+    static const char zeroes[shard_alignment] = {};
+
+    const size_t current = size_t(stream.tellp());
+
+    if (current < offset) {
+        stream.write(zeroes, offset - current);
+    }
+}
+
+} // end of namespace shard_detail
+
+/*!
+ * \brief Write a range of samples and labels to a shard file.
+ *
+ * All the samples must have the same shape as the first one. The labels
+ * must be scalar values (class indices or regression targets).
+ *
+ * \param path The path of the shard file
+ * \param first Iterator to the first sample
+ * \param last Iterator to the past-the-end sample
+ * \param lfirst Iterator to the first label
+ * \param n_classes The number of classes (0 if unknown or not classification)
+ * \param type The type of values to store
+ *
+ * \return true if the shard was written, false otherwise
+ */
+template <typename Iterator, typename LIterator>
+bool write_shard(const std::string& path, Iterator first, Iterator last, LIterator lfirst, size_t n_classes, shard_type type) {
+    using sample_t = std::decay_t<decltype(*first)>;
+
+    constexpr size_t D = etl::decay_traits<sample_t>::dimensions();
+
+    static_assert(D >= 1 && D <= shard_max_dimensions, "Invalid number of dimensions for a shard sample");
+
+    shard_header header;
+    std::memset(&header, 0, sizeof(header));
+
+    std::copy(std::begin(shard_magic), std::end(shard_magic), header.magic);
+
+    header.version    = shard_version;
+    header.type       = uint32_t(type);
+    header.dimensions = D;
+    header.samples    = std::distance(first, last);
+    header.classes    = n_classes;
+
+    if (header.samples) {
+        for (size_t d = 0; d < D; ++d) {
+            header.dims[d] = etl::dim(*first, d);
+        }
+    }
+
+    header.data_offset  = shard_detail::align(sizeof(shard_header));
+    header.label_offset = shard_detail::align(header.data_offset + header.samples * header.sample_size() * header.value_size());
+
+    std::ofstream stream(path, std::ios::binary);
+
+    if (!stream) {
+        std::cerr << "ERROR: Impossible to open shard for writing: " << path << std::endl;
+        return false;
+    }
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    shard_detail::pad(stream, header.data_offset);
+
+    std::vector<uint8_t> bytes(header.sample_size());
+    std::vector<float> floats(header.sample_size());
+
+    for (auto it = first; it != last; ++it) {
+        if (etl::size(*it) != header.sample_size()) {
+            std::cerr << "ERROR: All the samples of a shard must have the same size: " << path << std::endl;
+            return false;
+        }
+
+        if (type == shard_type::UINT8) {
+            for (size_t i = 0; i < bytes.size(); ++i) {
+                // Round like the compact storage of the in-memory generators
+                bytes[i] = uint8_t(std::min(std::max(double((*it)[i]), 0.0), 255.0) + 0.5);
+            }
+
+            stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        } else {
+            for (size_t i = 0; i < floats.size(); ++i) {
+                floats[i] = float((*it)[i]);
+            }
+
+            stream.write(reinterpret_cast<const char*>(floats.data()), floats.size() * sizeof(float));
+        }
+    }
+
+    shard_detail::pad(stream, header.label_offset);
+
+    for (size_t i = 0; i < header.samples; ++i) {
+        const float label = float(*lfirst++);
+        stream.write(reinterpret_cast<const char*>(&label), sizeof(float));
+    }
+
+    if (!stream) {
+        std::cerr << "ERROR: Failed to write shard: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/*!
+ * \copydoc write_shard
+ */
+template <typename Container, typename LContainer>
+bool write_shard(const std::string& path, const Container& samples, const LContainer& labels, size_t n_classes, shard_type type) {
+    return write_shard(path, samples.begin(), samples.end(), labels.begin(), n_classes, type);
+}
+
+/*!
+ * \brief A shard file mapped in memory (read-only).
+ *
+ * The pages are shared between all the processes mapping the same file,
+ * and are only loaded on first access.
+ */
+struct mapped_shard {
+    mapped_shard() = default;
+
+    /*!
+     * \brief Map the given shard file
+     * \param path The path to the shard file
+     */
+    explicit mapped_shard(const std::string& path) {
+        open(path);
+    }
+
+    mapped_shard(const mapped_shard& rhs) = delete;
+    mapped_shard& operator=(const mapped_shard& rhs) = delete;
+
+    mapped_shard(mapped_shard&& rhs) noexcept : memory(rhs.memory), length(rhs.length) {
+        rhs.memory = nullptr;
+        rhs.length = 0;
+    }
+
+    mapped_shard& operator=(mapped_shard&& rhs) noexcept {
+        if (this != &rhs) {
+            close();
+
+            memory = rhs.memory;
+            length = rhs.length;
+
+            rhs.memory = nullptr;
+            rhs.length = 0;
+        }
+
+        return *this;
+    }
+
+    /*!
+     * \brief Unmap the shard
+     */
+    ~mapped_shard() {
+        close();
+    }
+
+    /*!
+     * \brief Map the given shard file
+     * \param path The path to the shard file
+     * \return true if the shard was mapped, false otherwise
+     */
+    bool open(const std::string& path) {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            std::cerr << "ERROR: Impossible to open shard: " << path << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(shard_header)) {
+            std::cerr << "ERROR: Invalid shard: " << path << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        void* address = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        // The mapping remains valid after the file is closed
+        ::close(fd);
+
+        if (address == MAP_FAILED) {
+            std::cerr << "ERROR: Impossible to map shard: " << path << std::endl;
+            return false;
+        }
+
+        memory = static_cast<const char*>(address);
+        length = st.st_size;
+
+        auto& h = header();
+
+        const bool valid =
+                std::equal(std::begin(shard_magic), std::end(shard_magic), h.magic)
+            &&  h.version == shard_version
+            &&  (h.type == uint32_t(shard_type::UINT8) || h.type == uint32_t(shard_type::FLOAT))
+            &&  h.dimensions >= 1 && h.dimensions <= shard_max_dimensions
+            &&  h.data_offset + h.samples * h.sample_size() * h.value_size() <= length
+            &&  h.label_offset + h.samples * sizeof(float) <= length;
+
+        if (!valid) {
+            std::cerr << "ERROR: Invalid shard: " << path << std::endl;
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Unmap the shard, if mapped
+     */
+    void close() {
+        if (memory) {
+            munmap(const_cast<char*>(memory), length);
+
+            memory = nullptr;
+            length = 0;
+        }
+    }
+
+    /*!
+     * \brief Indicates if a shard is mapped
+     */
+    bool is_open() const {
+        return memory;
+    }
+
+    /*!
+     * \brief Return the header of the shard
+     */
+    const shard_header& header() const {
+        return *reinterpret_cast<const shard_header*>(memory);
+    }
+
+    /*!
+     * \brief Return a pointer to the values of the given sample
+     * \tparam T The type of the values, must match the type of the shard
+     * \param i The index of the sample
+     */
+    template <typename T>
+    const T* data(size_t i = 0) const {
+        return reinterpret_cast<const T*>(memory + header().data_offset) + i * header().sample_size();
+    }
+
+    /*!
+     * \brief Return a pointer to the label of the given sample
+     * \param i The index of the sample
+     */
+    const float* labels(size_t i = 0) const {
+        return reinterpret_cast<const float*>(memory + header().label_offset) + i;
+    }
+
+    /*!
+     * \brief Advise the kernel that the given samples will be accessed
+     * soon.
+     *
+     * \param first The first sample
+     * \param last The past-the-end sample
+     */
+    void prefetch(size_t first, size_t last) const {
+        const size_t page  = size_t(sysconf(_SC_PAGESIZE));
+        const size_t bytes = header().sample_size() * header().value_size();
+        const size_t begin = (header().data_offset + first * bytes) / page * page;
+        const size_t end   = std::min(header().data_offset + last * bytes, length);
+
+        if (end > begin) {
+            madvise(const_cast<char*>(memory) + begin, end - begin, MADV_WILLNEED);
+        }
+    }
+
+private:
+    const char* memory = nullptr; ///< The mapped memory
+    size_t length      = 0;       ///< The length of the mapping
+};
+
+} //end of dll namespace
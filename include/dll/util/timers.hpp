@@ -8,12 +8,24 @@
 #pragma once
 
 #include <chrono>
+#include <string>
 
 #ifndef DLL_NO_TIMERS
 
 #include <iosfwd>
 #include <iomanip>
 #include <sstream>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <iostream>
 
 #endif
 
@@ -44,6 +56,15 @@ struct stop_timer {
 
 #ifdef DLL_NO_TIMERS
 
+/*!
+ * \brief Reset all timers
+ *
+ * This has no effect if the timers were disabled.
+ */
+inline void reset_timers() {
+    //No timers
+}
+
 /*!
  * \brief Dump the values of the timer on the console.
  *
@@ -53,96 +74,277 @@ inline void dump_timers() {
     //No timers
 }
 
+/*!
+ * \brief Dump all timers values to the console, with percentage of time from
+ * the total.
+ *
+ * This has no effect if the timers were disabled.
+ */
+inline void dump_timers_one() {
+    //No timers
+}
+
+/*!
+ * \brief Dump the call tree of the timers in flame graph format.
+ *
+ * This has no effect if the timers were disabled.
+ */
+inline void dump_timers_flamegraph(const std::string& /*path*/) {
+    //No timers
+}
+
 struct auto_timer {
     auto_timer(const char* /*name*/) {}
 };
 
 #else
 
-constexpr size_t max_timers = 64; ///< The maximum number of timers
+constexpr size_t max_timers      = 128; ///< The maximum number of timers
+constexpr size_t max_timer_nodes = 512; ///< The maximum number of nodes in the call tree of one thread
+
+namespace detail {
+
+constexpr size_t no_timer_node = std::numeric_limits<size_t>::max(); ///< Marker for an invalid node
 
 /*!
- * \brief A timer
+ * \brief A node in the call tree of the timers of a thread.
+ *
+ * The counters are only written by the thread owning the tree, they are
+ * atomics only to be read safely while dumping the timers.
  */
-struct timer_t {
-    const char* name;             ///< The name of the timer
-    std::atomic<size_t> count;    ///< The number of times it was incremented
-    std::atomic<size_t> duration; ///< The total duration
+struct timer_node {
+    size_t slot         = 0;             ///< The slot of the timer
+    size_t parent       = no_timer_node; ///< The parent node
+    size_t first_child  = no_timer_node; ///< The first child node
+    size_t next_sibling = no_timer_node; ///< The next sibling node
+    bool recursive      = false;         ///< Indicates if the timer is already in the parents
 
-    /*!
-     * \brief Initialize an empty counter
-     */
-    timer_t()
-            : name(nullptr), count(0), duration(0) {}
+    std::atomic<size_t> count{0};    ///< The number of times it was incremented
+    std::atomic<size_t> duration{0}; ///< The total duration
 
     /*!
-     * \brief Copy a timer
+     * \brief Add a measure to the node
+     * \param d The duration of the measure
      */
-    timer_t(const timer_t& rhs)
-            : name(rhs.name), count(rhs.count.load()), duration(rhs.duration.load()) {}
+    void add(size_t d) {
+        // Only the owning thread writes, no need for an atomic increment
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        duration.store(duration.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+};
+
+/*!
+ * \brief The timers of one thread, organized as a call tree.
+ *
+ * The first node is the root of the tree and is not a timer.
+ */
+struct thread_timers {
+    std::array<timer_node, max_timer_nodes> nodes; ///< The nodes of the call tree
+    std::atomic<size_t> size{1};                   ///< The number of nodes in the tree
+    size_t current = 0;                            ///< The current node
+
+    static constexpr size_t cache_size = 256; ///< The size of the name cache
+
+    std::array<const char*, cache_size> cache_names{}; ///< The names in the cache
+    std::array<size_t, cache_size> cache_slots{};      ///< The slots in the cache
 
     /*!
-     * \brief Copy assign a timer
+     * \brief Enter a child of the current node for the given slot
+     * \param slot The slot of the timer
+     * \return the index of the entered node
      */
-    timer_t& operator=(const timer_t& rhs) {
-        if (&rhs != this) {
-            name     = rhs.name;
-            count    = rhs.count.load();
-            duration = rhs.duration.load();
+    size_t enter(size_t slot) {
+        // Look for an existing child
+
+        for (size_t child = nodes[current].first_child; child != no_timer_node; child = nodes[child].next_sibling) {
+            if (nodes[child].slot == slot) {
+                return current = child;
+            }
+        }
+
+        // Create a new child
+
+        const size_t n = size.load(std::memory_order_relaxed);
+
+        if (n == max_timer_nodes) {
+            return no_timer_node;
         }
 
-        return *this;
+        auto& node = nodes[n];
+
+        node.slot         = slot;
+        node.parent       = current;
+        node.next_sibling = nodes[current].first_child;
+        node.recursive    = false;
+
+        for (size_t p = current; p != 0; p = nodes[p].parent) {
+            if (nodes[p].slot == slot) {
+                node.recursive = true;
+            }
+        }
+
+        nodes[current].first_child = n;
+
+        // Publish the new node
+        size.store(n + 1, std::memory_order_release);
+
+        return current = n;
     }
+};
+
+/*!
+ * \brief The registry of all the timers and all the threads
+ */
+struct timers_registry {
+    std::array<const char*, max_timers> names{}; ///< The names of the timers
+    std::atomic<size_t> size{0};                 ///< The number of registered timers
+
+    std::vector<std::shared_ptr<thread_timers>> threads; ///< The timers of each thread
+
+    std::mutex lock; ///< The lock to protect registrations
 
     /*!
-     * \brief Move construct a timer
+     * \brief Register the given timer name and return its slot
+     * \param name The name of the timer
+     * \return The slot of the timer or no_timer_node if there is no more slot
      */
-    timer_t(timer_t&& rhs)
-            : name(std::move(rhs.name)), count(rhs.count.load()), duration(rhs.duration.load()) {}
+    size_t register_name(const char* name) {
+        std::lock_guard<std::mutex> l(lock);
+
+        const size_t n = size.load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < n; ++i) {
+            if (names[i] == name || !std::strcmp(names[i], name)) {
+                return i;
+            }
+        }
+
+        if (n == max_timers) {
+            std::cerr << "Unable to register timer " << name << std::endl;
+            return no_timer_node;
+        }
+
+        names[n] = name;
+        size.store(n + 1, std::memory_order_release);
+
+        return n;
+    }
 
     /*!
-     * \brief Move assign a timer
+     * \brief Create the timers of a new thread
      */
-    timer_t& operator=(timer_t&& rhs) {
-        if (&rhs != this) {
-            name     = std::move(rhs.name);
-            count    = rhs.count.load();
-            duration = rhs.duration.load();
-        }
+    std::shared_ptr<thread_timers> register_thread() {
+        auto timers = std::make_shared<thread_timers>();
+
+        std::lock_guard<std::mutex> l(lock);
+        threads.push_back(timers);
 
-        return *this;
+        return timers;
     }
 };
 
 /*!
- * \brief The structure holding all the timers
+ * \brief Get a reference to the registry of the timers
  */
-struct timers_t {
-    std::array<timer_t, max_timers> timers; ///< The timers
-    std::mutex lock; ///< The lock to protect the timers
+inline timers_registry& get_timers_registry() {
+    static timers_registry registry;
+    return registry;
+}
 
-    /*!
-     * \brief Reset the status of the timers
-     */
-    void reset(){
-        std::lock_guard<std::mutex> l(lock);
+/*!
+ * \brief Get a reference to the timers of the current thread
+ */
+inline thread_timers& get_thread_timers() {
+    thread_local std::shared_ptr<thread_timers> timers = get_timers_registry().register_thread();
+    return *timers;
+}
 
-        for(auto& timer : timers){
-            timer.name = nullptr;
-            timer.duration = 0;
-            timer.count = 0;
+/*!
+ * \brief Get the slot of the timer with the given name.
+ *
+ * Each name is only registered once, after that the slot is found in a
+ * thread-local cache.
+ *
+ * \param timers The timers of the current thread
+ * \param name The name of the timer
+ *
+ * \return The slot of the timer
+ */
+inline size_t timer_slot(thread_timers& timers, const char* name) {
+    const size_t mask = thread_timers::cache_size - 1;
+
+    size_t i = (static_cast<size_t>(reinterpret_cast<std::uintptr_t>(name)) >> 3) & mask;
+
+    for (size_t probe = 0; probe < thread_timers::cache_size; ++probe, i = (i + 1) & mask) {
+        if (timers.cache_names[i] == name) {
+            return timers.cache_slots[i];
+        }
+
+        if (!timers.cache_names[i]) {
+            timers.cache_names[i] = name;
+            timers.cache_slots[i] = get_timers_registry().register_name(name);
+
+            return timers.cache_slots[i];
         }
     }
+
+    return get_timers_registry().register_name(name);
+}
+
+/*!
+ * \brief The aggregated value of one timer
+ */
+struct timer_value {
+    const char* name; ///< The name of the timer
+    size_t count;     ///< The number of times it was incremented
+    size_t duration;  ///< The total duration
 };
 
 /*!
- * \brief Get a reference to the timer structure
+ * \brief Aggregate the timers of all the threads.
+ *
+ * Recursive calls of a timer are only accounted once.
+ *
+ * \return The used timers, sorted by duration (DESC)
  */
-inline timers_t& get_timers() {
-    static timers_t timers;
-    return timers;
+inline std::vector<timer_value> aggregate_timers() {
+    decltype(auto) registry = get_timers_registry();
+
+    std::lock_guard<std::mutex> l(registry.lock);
+
+    const size_t n = registry.size.load(std::memory_order_acquire);
+
+    std::vector<timer_value> values(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        values[i] = {registry.names[i], 0, 0};
+    }
+
+    for (auto& timers : registry.threads) {
+        const size_t nodes = timers->size.load(std::memory_order_acquire);
+
+        for (size_t i = 1; i < nodes; ++i) {
+            auto& node = timers->nodes[i];
+
+            if (!node.recursive) {
+                values[node.slot].count += node.count.load(std::memory_order_relaxed);
+                values[node.slot].duration += node.duration.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    values.erase(std::remove_if(values.begin(), values.end(), [](auto& value) { return !value.count; }), values.end());
+
+    //Sort the timers by duration (DESC)
+    std::sort(values.begin(), values.end(), [](auto& left, auto& right) {
+        return left.duration > right.duration;
+    });
+
+    return values;
 }
 
+} // end of namespace detail
+
 inline std::string to_string_precision(double duration, int precision = 6) {
     std::ostringstream out;
     out << std::setprecision(precision) << duration;
@@ -165,8 +367,18 @@ inline std::string duration_str(double duration, int precision = 6) {
  * \brief Reset all timers
  */
 inline void reset_timers() {
-    decltype(auto) timers = get_timers();
-    timers.reset();
+    decltype(auto) registry = detail::get_timers_registry();
+
+    std::lock_guard<std::mutex> l(registry.lock);
+
+    for (auto& timers : registry.threads) {
+        const size_t nodes = timers->size.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i < nodes; ++i) {
+            timers->nodes[i].count    = 0;
+            timers->nodes[i].duration = 0;
+        }
+    }
 }
 
 /*!
@@ -175,22 +387,11 @@ inline void reset_timers() {
  * This has no effect if the timers were disabled.
  */
 inline void dump_timers() {
-    decltype(auto) timers = get_timers().timers;
-
-    //Sort the timers by duration (DESC)
-    std::sort(timers.begin(), timers.end(), [](auto& left, auto& right) {
-        return left.duration > right.duration;
-    });
-
     // Print all the used timers
-    for (decltype(auto) timer : timers) {
-        if (timer.name) {
-            size_t count = timer.count;
-            size_t duration = timer.duration;
-            std::cout << timer.name << "(" << count << ") : "
-                      << duration_str(duration)
-                      << " (" << duration_str(duration / count) << ")" << std::endl;
-        }
+    for (auto& timer : detail::aggregate_timers()) {
+        std::cout << timer.name << "(" << timer.count << ") : "
+                  << duration_str(timer.duration)
+                  << " (" << duration_str(timer.duration / timer.count) << ")" << std::endl;
     }
 }
 
@@ -201,87 +402,136 @@ inline void dump_timers() {
  * The total is the counter with the maximum total time
  */
 inline void dump_timers_one() {
-    decltype(auto) timers = get_timers().timers;
+    auto timers = detail::aggregate_timers();
 
     if(timers.empty()){
         return;
     }
 
-    //Sort the timers by duration (DESC)
-    std::sort(timers.begin(), timers.end(), [](auto& left, auto& right) {
-        return left.duration > right.duration;
-    });
-
-    double total_duration = timers.front().duration.load();
+    double total_duration = timers.front().duration;
 
     // Print all the used timers
-    for (decltype(auto) timer : timers) {
-        if (timer.name) {
-            size_t count = timer.count;
-            size_t duration = timer.duration;
-            std::cout << timer.name << "(" << count << ") : "
-                      << duration_str(duration)
-                      << " (" << 100.0 * (duration / total_duration) << "%, " << duration_str(duration / count) << ")" << std::endl;
+    for (auto& timer : timers) {
+        std::cout << timer.name << "(" << timer.count << ") : "
+                  << duration_str(timer.duration)
+                  << " (" << 100.0 * (timer.duration / total_duration) << "%, " << duration_str(timer.duration / timer.count) << ")" << std::endl;
+    }
+}
+
+/*!
+ * \brief Dump the call tree of the timers in the folded stacks format
+ * used by flame graph tools (flamegraph.pl, speedscope, ...).
+ *
+ * Each line contains a stack of timers, separated by semicolons, followed
+ * by the time (in nanoseconds) spent in the last timer of the stack but not
+ * in its children. The call trees of all the threads are merged.
+ *
+ * \param os The stream to dump to
+ */
+inline void dump_timers_flamegraph(std::ostream& os) {
+    decltype(auto) registry = detail::get_timers_registry();
+
+    std::lock_guard<std::mutex> l(registry.lock);
+
+    std::vector<std::pair<std::string, size_t>> stacks;
+
+    for (auto& timers : registry.threads) {
+        const size_t nodes = timers->size.load(std::memory_order_acquire);
+
+        // Compute the time spent in each node but not in its children
+        std::vector<size_t> self(nodes, 0);
+
+        for (size_t i = 1; i < nodes; ++i) {
+            self[i] += timers->nodes[i].duration.load(std::memory_order_relaxed);
+
+            const size_t parent = timers->nodes[i].parent;
+
+            if (parent) {
+                self[parent] -= std::min(self[parent], timers->nodes[i].duration.load(std::memory_order_relaxed));
+            }
+        }
+
+        for (size_t i = 1; i < nodes; ++i) {
+            std::string stack = registry.names[timers->nodes[i].slot];
+
+            for (size_t p = timers->nodes[i].parent; p; p = timers->nodes[p].parent) {
+                stack = std::string(registry.names[timers->nodes[p].slot]) + ";" + stack;
+            }
+
+            stacks.emplace_back(std::move(stack), self[i]);
+        }
+    }
+
+    // Merge the stacks of the different threads
+
+    std::sort(stacks.begin(), stacks.end());
+
+    for (size_t i = 0; i < stacks.size();) {
+        size_t total = 0;
+        size_t j     = i;
+
+        for (; j < stacks.size() && stacks[j].first == stacks[i].first; ++j) {
+            total += stacks[j].second;
+        }
+
+        if (total) {
+            os << stacks[i].first << " " << total << "\n";
         }
+
+        i = j;
     }
 }
 
+/*!
+ * \brief Dump the call tree of the timers to the given file, in the folded
+ * stacks format used by flame graph tools.
+ *
+ * \param path The path to the file
+ */
+inline void dump_timers_flamegraph(const std::string& path) {
+    std::ofstream os(path);
+    dump_timers_flamegraph(os);
+}
+
 /*!
  * \brief Automatic timer with RAII.
+ *
+ * The timers are accumulated in the call tree of the current thread, the
+ * parent of a timer being the timer enclosing it.
  */
 struct auto_timer {
-    const char* name;                               ///< The name of the timer
+    detail::thread_timers& timers;                            ///< The timers of the thread
+    size_t node;                                              ///< The node of the timer
+    size_t parent;                                            ///< The parent node
     std::chrono::time_point<std::chrono::steady_clock> start; ///< The start time
-    std::chrono::time_point<std::chrono::steady_clock> end;   ///< The end time
 
     /*!
      * \brief Create an auto_timer witht the given name
      * \param name The name of the timer
      */
-    auto_timer(const char* name) : name(name) {
+    auto_timer(const char* name) : timers(detail::get_thread_timers()), parent(timers.current) {
+        const size_t slot = detail::timer_slot(timers, name);
+
+        node = slot == detail::no_timer_node ? detail::no_timer_node : timers.enter(slot);
+
         start = std::chrono::steady_clock::now();
     }
 
+    auto_timer(const auto_timer& rhs) = delete;
+    auto_timer& operator=(const auto_timer& rhs) = delete;
+
     /*!
      * \brief Destructs the timer, effectively incrementing the timer.
      */
     ~auto_timer() {
-        end           = std::chrono::steady_clock::now();
+        auto end      = std::chrono::steady_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
 
-        decltype(auto) timers = get_timers();
-
-        for (decltype(auto) timer : timers.timers) {
-            if (timer.name == name) {
-                timer.duration += duration;
-                ++timer.count;
-
-                return;
-            }
-        }
-
-        std::lock_guard<std::mutex> lock(timers.lock);
-
-        for (decltype(auto) timer : timers.timers) {
-            if (timer.name == name) {
-                timer.duration += duration;
-                ++timer.count;
-
-                return;
-            }
-        }
-
-        for (decltype(auto) timer : timers.timers) {
-            if (!timer.name) {
-                timer.name     = name;
-                timer.duration = duration;
-                timer.count    = 1;
-
-                return;
-            }
+        if (node != detail::no_timer_node) {
+            timers.nodes[node].add(duration);
         }
 
-        std::cerr << "Unable to register timer " << name << std::endl;
+        timers.current = parent;
     }
 };
 
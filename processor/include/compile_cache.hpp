@@ -0,0 +1,65 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Content-addressed cache of the compiled networks.
+ *
+ * The binaries are stored in a shared directory, named after a hash of the
+ * generated source, of the compiler and of the compilation flags. The least
+ * recently used binaries are evicted when the cache is full.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "dll/processor/processor.hpp"
+
+namespace dllp {
+
+/*!
+ * \brief Return the directory of the compilation cache.
+ *
+ * This is the directory set in the options, or $DLLP_CACHE_DIR, or
+ * $HOME/.cache/dllp or .dllp_cache, in this order.
+ */
+std::string cache_directory(const dll::processor::options& opt);
+
+/*!
+ * \brief Compute the key of a compiled network
+ * \param source The generated source
+ * \param compiler The identification of the compiler (version)
+ * \param command The compilation command (with all the flags)
+ * \return The hexadecimal key of the binary
+ */
+std::string cache_key(const std::string& source, const std::string& compiler, const std::string& command);
+
+/*!
+ * \brief Make sure the given cache directory exists
+ * \return true if the directory exists or was created, false otherwise
+ */
+bool cache_prepare(const std::string& directory);
+
+/*!
+ * \brief Look for the given binary in the cache and mark it as used
+ * \return true if the binary is in the cache, false otherwise
+ */
+bool cache_lookup(const std::string& binary);
+
+/*!
+ * \brief Evict the least recently used binaries of the cache
+ *
+ * The given binary is never evicted, even if the cache size is zero.
+ *
+ * \param directory The directory of the cache
+ * \param max_entries The maximum number of binaries to keep
+ * \param keep The path of the binary that must be kept
+ */
+void cache_evict(const std::string& directory, size_t max_entries, const std::string& keep);
+
+} //end of namespace dllp
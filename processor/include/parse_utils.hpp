@@ -24,12 +24,14 @@ std::string extract_value(const std::string& str, const std::string& search);
 bool valid_unit(const std::string& unit);
 bool valid_trainer(const std::string& unit);
 bool valid_ft_trainer(const std::string& unit);
+bool valid_updater(const std::string& unit);
 bool valid_activation(const std::string& unit);
 bool valid_sparsity(const std::string& unit);
 
 std::string unit_type(const std::string& unit);
 std::string activation_function(const std::string& unit);
 std::string decay_to_str(const std::string& decay);
+std::string updater_to_str(const std::string& updater);
 std::string sparsity_to_str(const std::string& decay);
 
 std::vector<std::string> read_lines(const std::string& source_file);
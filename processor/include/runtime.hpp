@@ -0,0 +1,61 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Compile-free execution of the networks.
+ *
+ * dllp contains a precompiled set of networks made of dynamic layers. When a
+ * configuration matches one of them, the network is built directly from the
+ * configuration and executed, without generating and compiling any code.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "layer.hpp"
+
+namespace dllp {
+
+constexpr size_t runtime_batch_sizes[] = {10, 100}; ///< The precompiled batch sizes (see runtime_detail::dense_batch)
+
+/*!
+ * \brief The configuration of a network executed at runtime
+ */
+struct runtime_config {
+    std::vector<size_t> sizes; ///< The number of visible units followed by the number of hidden units of each layer
+    dll::function hidden;      ///< The activation function of the hidden layers
+    dll::function output;      ///< The activation function of the last layer
+    size_t batch_size;         ///< The batch size
+};
+
+/*!
+ * \brief Indicates if the given network can be executed without compilation
+ * \param layers The layers of the network
+ * \param t The task
+ * \param config The runtime configuration to fill
+ * \param verbose Indicates if the reason why the network is not supported must be printed
+ * \return true if the network can be executed at runtime, false otherwise
+ */
+bool runtime_supported(const layers_t& layers, const dll::processor::task& t, runtime_config& config, bool verbose);
+
+/*!
+ * \brief Execute the given actions on a network built at runtime
+ * \param config The runtime configuration
+ * \param t The task
+ * \param actions The actions to execute
+ * \return true if the network was executed, false otherwise
+ */
+bool runtime_execute(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions);
+
+bool runtime_dense_1(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions);
+bool runtime_dense_2(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions);
+bool runtime_dense_3(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions);
+
+} //end of namespace dllp
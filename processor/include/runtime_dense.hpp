@@ -0,0 +1,143 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief The precompiled dense networks of the runtime mode.
+ *
+ * Each depth is instantiated in its own translation unit to keep the build
+ * of dllp parallel.
+ */
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "dll/neural/dyn_dense_layer.hpp"
+#include "dll/dbn.hpp"
+
+#include "runtime.hpp"
+
+namespace dllp {
+
+namespace runtime_detail {
+
+/*!
+ * \brief A precompiled dense network of depth D.
+ *
+ * The momentum updater and the L1L2 weight decay are always used: without
+ * momentum and with zero weight costs, they are equivalent to plain SGD and
+ * to no decay, which saves instantiating each combination.
+ */
+template <size_t D, dll::function H, dll::function O, size_t B, typename Sequence = std::make_index_sequence<D>>
+struct dense_network;
+
+template <size_t D, dll::function H, dll::function O, size_t B, size_t... I>
+struct dense_network<D, H, O, B, std::index_sequence<I...>> {
+    using network_t = typename dll::dyn_network_desc<
+        dll::dbn_layers<typename dll::dyn_dense_layer_desc<dll::activation<(I + 1 < D ? H : O)>>::layer_t...>,
+        dll::trainer<dll::sgd_trainer>,
+        dll::updater<dll::updater_type::MOMENTUM>,
+        dll::weight_decay<dll::decay_type::L1L2>,
+        dll::batch_size<B>>::network_t;
+
+    static void run(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+        auto net = std::make_unique<network_t>();
+
+        int wormhole[] = {(net->template init_layer<I>(config.sizes[I], config.sizes[I + 1]), 0)...};
+        cpp_unused(wormhole);
+
+        auto& desc = t.ft_desc;
+
+        if (desc.learning_rate != dll::processor::stupid_default) {
+            net->learning_rate = desc.learning_rate;
+        }
+
+        // An explicit momentum updater keeps the default momentum, like the compiled network
+        if (desc.momentum != dll::processor::stupid_default) {
+            net->initial_momentum = desc.momentum;
+            net->final_momentum   = desc.momentum;
+        } else if (desc.updater != "momentum") {
+            net->initial_momentum = 0.0;
+            net->final_momentum   = 0.0;
+        }
+
+        if (desc.l1_weight_cost != dll::processor::stupid_default) {
+            net->l1_weight_cost = desc.l1_weight_cost;
+        }
+
+        if (desc.l2_weight_cost != dll::processor::stupid_default) {
+            net->l2_weight_cost = desc.l2_weight_cost;
+        }
+
+        if (desc.decay != "l1" && desc.decay != "l1l2") {
+            net->l1_weight_cost = 0.0;
+        }
+
+        if (desc.decay != "l2" && desc.decay != "l1l2") {
+            net->l2_weight_cost = 0.0;
+        }
+
+        dll::processor::execute<etl::dyn_vector<float>, false>(*net, t, actions);
+    }
+};
+
+/*!
+ * \brief Dispatch the batch size of a dense network
+ *
+ * The cases must match runtime_batch_sizes.
+ */
+template <size_t D, dll::function H, dll::function O>
+bool dense_batch(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+    switch (config.batch_size) {
+        case 10:
+            dense_network<D, H, O, 10>::run(config, t, actions);
+            return true;
+        case 100:
+            dense_network<D, H, O, 100>::run(config, t, actions);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*!
+ * \brief Dispatch the output activation of a dense network
+ */
+template <size_t D, dll::function H>
+bool dense_output(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+    switch (config.output) {
+        case dll::function::SIGMOID:
+            return dense_batch<D, H, dll::function::SIGMOID>(config, t, actions);
+        case dll::function::SOFTMAX:
+            return dense_batch<D, H, dll::function::SOFTMAX>(config, t, actions);
+        default:
+            return false;
+    }
+}
+
+/*!
+ * \brief Dispatch the hidden activation of a dense network
+ */
+template <size_t D>
+bool dense_hidden(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+    switch (config.hidden) {
+        case dll::function::SIGMOID:
+            return dense_output<D, dll::function::SIGMOID>(config, t, actions);
+        case dll::function::TANH:
+            return dense_output<D, dll::function::TANH>(config, t, actions);
+        case dll::function::RELU:
+            return dense_output<D, dll::function::RELU>(config, t, actions);
+        default:
+            return false;
+    }
+}
+
+} //end of namespace runtime_detail
+
+} //end of namespace dllp
@@ -0,0 +1,151 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <cerrno>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <utime.h>
+
+#include "compile_cache.hpp"
+
+namespace {
+
+constexpr const char* cache_extension = ".out"; ///< The extension of the cached binaries
+
+/*!
+ * \brief Update the 64-bit FNV-1a hash with the given data
+ */
+uint64_t fnv1a(uint64_t hash, const std::string& data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    // Separate the fields so that moving bytes between them changes the hash
+    hash ^= 0xFF;
+    hash *= 1099511628211ULL;
+
+    return hash;
+}
+
+bool ends_with(const std::string& str, const std::string& search) {
+    return str.size() >= search.size() && std::equal(search.rbegin(), search.rend(), str.rbegin());
+}
+
+} // end of anonymous namespace
+
+std::string dllp::cache_directory(const dll::processor::options& opt) {
+    if (!opt.cache_dir.empty()) {
+        return opt.cache_dir;
+    }
+
+    if (const auto* dir = std::getenv("DLLP_CACHE_DIR")) {
+        return dir;
+    }
+
+    if (const auto* home = std::getenv("HOME")) {
+        return std::string(home) + "/.cache/dllp";
+    }
+
+    return ".dllp_cache";
+}
+
+std::string dllp::cache_key(const std::string& source, const std::string& compiler, const std::string& command) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    hash = fnv1a(hash, source);
+    hash = fnv1a(hash, compiler);
+    hash = fnv1a(hash, command);
+
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+
+    return buffer;
+}
+
+bool dllp::cache_prepare(const std::string& directory) {
+    for (size_t i = 1; i <= directory.size(); ++i) {
+        if (i == directory.size() || directory[i] == '/') {
+            auto parent = directory.substr(0, i);
+
+            if (mkdir(parent.c_str(), 0755) && errno != EEXIST) {
+                std::cout << "dllp: error: impossible to create the cache directory " << directory << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool dllp::cache_lookup(const std::string& binary) {
+    struct stat attr;
+
+    if (stat(binary.c_str(), &attr) || !S_ISREG(attr.st_mode)) {
+        return false;
+    }
+
+    // Mark the binary as recently used for the eviction
+    utime(binary.c_str(), nullptr);
+
+    return true;
+}
+
+void dllp::cache_evict(const std::string& directory, size_t max_entries, const std::string& keep) {
+    DIR* dir = opendir(directory.c_str());
+
+    if (!dir) {
+        return;
+    }
+
+    std::vector<std::pair<time_t, std::string>> entries;
+
+    while (auto* entry = readdir(dir)) {
+        std::string name(entry->d_name);
+
+        if (!ends_with(name, cache_extension)) {
+            continue;
+        }
+
+        auto path = directory + "/" + name;
+
+        // The binary that is about to be used is always kept
+        if (path == keep) {
+            continue;
+        }
+
+        struct stat attr;
+        if (!stat(path.c_str(), &attr) && S_ISREG(attr.st_mode)) {
+            entries.emplace_back(attr.st_mtime, std::move(path));
+        }
+    }
+
+    closedir(dir);
+
+    // The kept binary counts as one entry, even with an empty cache
+    const size_t max_others = max_entries ? max_entries - 1 : 0;
+
+    if (entries.size() <= max_others) {
+        return;
+    }
+
+    // The least recently used binaries first
+    std::sort(entries.begin(), entries.end());
+
+    for (size_t i = 0; i < entries.size() - max_others; ++i) {
+        std::remove(entries[i].second.c_str());
+    }
+}
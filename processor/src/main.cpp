@@ -22,7 +22,7 @@
 namespace {
 
 void print_usage() {
-    std::cout << "Usage: dllp conf_file action" << std::endl;
+    std::cout << "Usage: dllp [--mkl] [--cublas] [--cufft] [--runtime] [--cache] [--cache-dir dir] [--cache-size n] conf_file action" << std::endl;
 }
 
 void parse_options(int argc, char* argv[], dll::processor::options& opt, std::vector<std::string>& actions, std::string& source_file) {
@@ -38,9 +38,19 @@ void parse_options(int argc, char* argv[], dll::processor::options& opt, std::ve
         } else if (std::string(argv[i]) == "--cublas") {
             opt.cublas = true;
             ++i;
+        } else if (std::string(argv[i]) == "--runtime") {
+            opt.runtime = true;
+            ++i;
         } else if (std::string(argv[i]) == "--cache") {
             opt.cache = true;
             ++i;
+        } else if (std::string(argv[i]) == "--cache-dir" && i + 1 < size_t(argc)) {
+            opt.cache     = true;
+            opt.cache_dir = argv[i + 1];
+            i += 2;
+        } else if (std::string(argv[i]) == "--cache-size" && i + 1 < size_t(argc)) {
+            opt.cache_size = std::stoul(argv[i + 1]);
+            i += 2;
         } else {
             break;
         }
@@ -62,15 +72,6 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    //Check that $CXX is defined
-
-    const auto* cxx = std::getenv("CXX");
-
-    if (!cxx) {
-        std::cout << "CXX environment variable must be set" << std::endl;
-        return 2;
-    }
-
     //Parse the options
 
     dll::processor::options opt;
@@ -79,6 +80,15 @@ int main(int argc, char* argv[]) {
 
     parse_options(argc, argv, opt, actions, source_file);
 
+    //Check that $CXX is defined (the runtime mode may not need it)
+
+    const auto* cxx = std::getenv("CXX");
+
+    if (!cxx && !opt.runtime) {
+        std::cout << "CXX environment variable must be set" << std::endl;
+        return 2;
+    }
+
     //Process the file
 
     return dll::processor::process_file(opt, actions, source_file);
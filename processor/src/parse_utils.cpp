@@ -56,6 +56,32 @@ std::string dllp::decay_to_str(const std::string& decay) {
     }
 }
 
+std::string dllp::updater_to_str(const std::string& updater) {
+    if (updater == "sgd") {
+        return "SGD";
+    } else if (updater == "momentum") {
+        return "MOMENTUM";
+    } else if (updater == "nesterov") {
+        return "NESTEROV";
+    } else if (updater == "adagrad") {
+        return "ADAGRAD";
+    } else if (updater == "rmsprop") {
+        return "RMSPROP";
+    } else if (updater == "adam") {
+        return "ADAM";
+    } else if (updater == "adam_correct") {
+        return "ADAM_CORRECT";
+    } else if (updater == "adamax") {
+        return "ADAMAX";
+    } else if (updater == "nadam") {
+        return "NADAM";
+    } else if (updater == "adadelta") {
+        return "ADADELTA";
+    } else {
+        return "INVALID";
+    }
+}
+
 std::string dllp::sparsity_to_str(const std::string& sparsity) {
     if (sparsity == "local") {
         return "LOCAL_TARGET";
@@ -82,6 +108,10 @@ bool dllp::valid_ft_trainer(const std::string& trainer) {
     return trainer == "sgd" || trainer == "cg";
 }
 
+bool dllp::valid_updater(const std::string& updater) {
+    return updater_to_str(updater) != "INVALID";
+}
+
 bool dllp::valid_activation(const std::string& function) {
     return function == "sigmoid" || function == "softmax" || function == "tanh" || function == "relu" || function == "identity";
 }
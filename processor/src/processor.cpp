@@ -11,14 +11,19 @@
 #include <fstream>
 #include <memory>
 #include <cstdlib>
+#include <cstdio>
+#include <iterator>
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "cpp_utils/string.hpp"
 
 #include "parse_utils.hpp"
 #include "layer.hpp"
+#include "compile_cache.hpp"
+#include "runtime.hpp"
 
 #include "dll/processor/processor.hpp"
 
@@ -115,8 +120,9 @@ void parse_datasource_pack(dll::processor::datasource_pack& pack, const std::vec
     pack.labels.limit  = limit;
 }
 
-void generate(const std::vector<std::unique_ptr<dllp::layer>>& layers, const dll::processor::task& t, const std::vector<std::string>& actions);
-bool compile(const options& opt);
+void generate(const std::vector<std::unique_ptr<dllp::layer>>& layers, const dll::processor::task& t, const std::vector<std::string>& actions, const std::string& source_file);
+bool compile_flags(const options& opt, std::string& flags);
+bool compile(const options& opt, const std::string& flags, const std::string& source_file, const std::string& output);
 
 void process_includes(std::vector<std::string>& lines){
     for (size_t i = 0; i < lines.size();) {
@@ -225,6 +231,15 @@ bool process_options(size_t& i, const std::vector<std::string>& lines, dll::proc
                         return false;
                     }
 
+                    ++i;
+                } else if (dllp::starts_with(lines[i], "updater: ")) {
+                    t.ft_desc.updater = dllp::extract_value(lines[i], "updater: ");
+
+                    if (!dllp::valid_updater(t.ft_desc.updater)) {
+                        std::cout << "dllp: error: invalid updater must be one of [sgd, momentum, nesterov, adagrad, rmsprop, adam, adam_correct, adamax, nadam, adadelta]" << std::endl;
+                        return false;
+                    }
+
                     ++i;
                 } else {
                     break;
@@ -391,41 +406,79 @@ bool parse_file(const std::string& source_file, dll::processor::task& t, std::ve
     return true;
 }
 
-bool compile_exe(const dllp::options& opt, const std::vector<std::string>& actions, const std::string& source_file, const dll::processor::task& t, const std::vector<std::unique_ptr<dllp::layer>>& layers) {
-    bool process = true;
+bool compile_cached(const dllp::options& opt, const std::string& flags, const std::string& directory, const std::string& source_file, std::string& executable) {
+    //The binaries are cached by the contents of the generated file, the compiler and the flags
 
-    if (opt.cache) {
-        struct stat attr_conf;
-        struct stat attr_exec;
+    std::ifstream source_stream(source_file);
+    std::string source((std::istreambuf_iterator<char>(source_stream)), std::istreambuf_iterator<char>());
 
-        if (!stat(source_file.c_str(), &attr_conf)) {
-            if (!stat("./.dbn.out", &attr_exec)) {
-                auto mtime_conf = attr_conf.st_mtime;
-                auto mtime_exec = attr_exec.st_mtime;
+    const std::string cxx(std::getenv("CXX"));
 
-                if (mtime_exec > mtime_conf) {
-                    if (!opt.quiet) {
-                        std::cout << "Skip compilation" << std::endl;
-                    }
-                    process = false;
-                }
-            }
+    executable = directory + "/" + dllp::cache_key(source, dllp::command_result(cxx + " --version"), cxx + flags) + ".out";
+
+    if (dllp::cache_lookup(executable)) {
+        if (!opt.quiet) {
+            std::cout << "Skip compilation (cached in " << executable << ")" << std::endl;
         }
+
+        return true;
     }
 
-    if (process) {
-        //Generate the CPP file
-        dllp::generate(layers, t, actions);
+    //Compile to a temporary file so that concurrent runs never see a partial binary
+    auto temporary = executable + "." + std::to_string(getpid()) + ".tmp";
 
-        //Compile the generate file
-        if (!dllp::compile(opt)) {
-            return false;
-        }
+    if (!dllp::compile(opt, flags, source_file, temporary)) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    if (std::rename(temporary.c_str(), executable.c_str())) {
+        std::cout << "dllp: error: impossible to store the binary in the cache" << std::endl;
+        std::remove(temporary.c_str());
+        return false;
     }
 
+    dllp::cache_evict(directory, opt.cache_size, executable);
+
     return true;
 }
 
+bool compile_exe(const dllp::options& opt, const std::vector<std::string>& actions, const dll::processor::task& t, const std::vector<std::unique_ptr<dllp::layer>>& layers, std::string& executable) {
+    if (!std::getenv("CXX")) {
+        std::cout << "CXX environment variable must be set" << std::endl;
+        return false;
+    }
+
+    std::string flags;
+    if (!dllp::compile_flags(opt, flags)) {
+        return false;
+    }
+
+    const auto directory = opt.cache ? dllp::cache_directory(opt) : std::string(".");
+
+    if (opt.cache && !dllp::cache_prepare(directory)) {
+        return false;
+    }
+
+    //Generate the CPP file, named after the process so that concurrent runs never overwrite it
+    const auto source_file = directory + "/.dbn." + std::to_string(getpid()) + ".cpp";
+
+    dllp::generate(layers, t, actions, source_file);
+
+    bool result;
+
+    if (opt.cache) {
+        result = compile_cached(opt, flags, directory, source_file, executable);
+    } else {
+        executable = "./.dbn.out";
+        result     = dllp::compile(opt, flags, source_file, executable);
+    }
+
+    std::remove(source_file.c_str());
+
+    return result;
+}
+
 std::string datasource_to_string(const std::string& lhs, const dll::processor::datasource& ds) {
     std::string result;
 
@@ -546,8 +599,8 @@ std::string get_data_type(const std::vector<std::unique_ptr<dllp::layer>>& layer
     }
 }
 
-void generate(const std::vector<std::unique_ptr<dllp::layer>>& layers, const dll::processor::task& t, const std::vector<std::string>& actions) {
-    std::ofstream out_stream(".dbn.cpp");
+void generate(const std::vector<std::unique_ptr<dllp::layer>>& layers, const dll::processor::task& t, const std::vector<std::string>& actions, const std::string& source_file) {
+    std::ofstream out_stream(source_file);
 
     out_stream << "#include <memory>\n";
 
@@ -580,7 +633,9 @@ void generate(const std::vector<std::unique_ptr<dllp::layer>>& layers, const dll
         out_stream << ", dll::trainer<dll::cg_trainer_simple>\n";
     }
 
-    if (t.ft_desc.momentum != dll::processor::stupid_default) {
+    if (t.ft_desc.updater != "none") {
+        out_stream << ", dll::updater<dll::updater_type::" << updater_to_str(t.ft_desc.updater) << ">\n";
+    } else if (t.ft_desc.momentum != dll::processor::stupid_default) {
         out_stream << ", dll::updater<dll::updater_type::MOMENTUM>\n";
     }
 
@@ -667,46 +722,52 @@ bool append_pkg_flags(std::string& flags, const std::string& pkg) {
     return true;
 }
 
-bool compile(const options& opt) {
-    if (!opt.quiet) {
-        std::cout << "Compiling the program..." << std::endl;
-    }
-
-    const auto* cxx = std::getenv("CXX");
-
-    std::string compile_command(cxx);
-
-    compile_command += " -o .dbn.out ";
-    compile_command += " -g ";
-    compile_command += " -O2 -DETL_VECTORIZE_FULL ";
-    compile_command += " -std=c++1y ";
-    compile_command += " -pthread ";
-    compile_command += " .dbn.cpp ";
+bool compile_flags(const options& opt, std::string& flags) {
+    flags += " -g ";
+    flags += " -O2 -DETL_VECTORIZE_FULL ";
+    flags += " -std=c++1y ";
+    flags += " -pthread ";
 
     if (opt.mkl) {
-        compile_command += " -DETL_MKL_MODE ";
+        flags += " -DETL_MKL_MODE ";
 
-        if (!append_pkg_flags(compile_command, "mkl")) {
+        if (!append_pkg_flags(flags, "mkl")) {
             return false;
         }
     }
 
     if (opt.cublas) {
-        compile_command += " -DETL_CUBLAS_MODE ";
+        flags += " -DETL_CUBLAS_MODE ";
 
-        if (!append_pkg_flags(compile_command, "cublas")) {
+        if (!append_pkg_flags(flags, "cublas")) {
             return false;
         }
     }
 
     if (opt.cufft) {
-        compile_command += " -DETL_CUFFT_MODE ";
+        flags += " -DETL_CUFFT_MODE ";
 
-        if (!append_pkg_flags(compile_command, "cufft")) {
+        if (!append_pkg_flags(flags, "cufft")) {
             return false;
         }
     }
 
+    return true;
+}
+
+bool compile(const options& opt, const std::string& flags, const std::string& source_file, const std::string& output) {
+    if (!opt.quiet) {
+        std::cout << "Compiling the program..." << std::endl;
+    }
+
+    const auto* cxx = std::getenv("CXX");
+
+    std::string compile_command(cxx);
+
+    compile_command += " -o \"" + output + "\" ";
+    compile_command += " \"" + source_file + "\" ";
+    compile_command += flags;
+
     int compile_result = system(compile_command.c_str());
 
     if (compile_result) {
@@ -733,19 +794,29 @@ int dll::processor::process_file(const dllp::options& opt, const std::vector<std
         return 1;
     }
 
-    //2. Generate the executable
+    //2. Run the precompiled network directly if possible
+
+    dllp::runtime_config config;
+
+    if (opt.runtime && dllp::runtime_supported(layers, t, config, !opt.quiet)) {
+        return dllp::runtime_execute(config, t, actions) ? 0 : 1;
+    }
+
+    //3. Generate the executable
+
+    std::string executable;
 
-    if (!dllp::compile_exe(opt, actions, source_file, t, layers)) {
+    if (!dllp::compile_exe(opt, actions, t, layers, executable)) {
         return 1;
     }
 
-    //3. Run the generated program
+    //4. Run the generated program
 
     if (!opt.quiet) {
         std::cout << "Executing the program" << std::endl;
     }
 
-    auto exec_result = system("./.dbn.out");
+    auto exec_result = system(("\"" + executable + "\"").c_str());
 
     if (exec_result) {
         std::cout << "Impossible to execute the generated file" << std::endl;
@@ -765,13 +836,39 @@ std::string dll::processor::process_file_result(const dllp::options& opt, const
         return "";
     }
 
-    //2. Generate the executable
+    //2. Run the precompiled network directly if possible
+
+    dllp::runtime_config config;
+
+    if (opt.runtime && dllp::runtime_supported(layers, t, config, !opt.quiet)) {
+        std::stringstream output;
+
+        auto* buffer = std::cout.rdbuf(output.rdbuf());
+        bool result  = dllp::runtime_execute(config, t, actions);
+        std::cout.rdbuf(buffer);
+
+        if (!result) {
+            return "";
+        }
+
+        std::string out(output.str());
+
+        if (!out.empty() && out.back() == '\n') {
+            out.pop_back();
+        }
+
+        return out;
+    }
+
+    //3. Generate the executable
+
+    std::string executable;
 
-    if (!dllp::compile_exe(opt, actions, source_file, t, layers)) {
+    if (!dllp::compile_exe(opt, actions, t, layers, executable)) {
         return "";
     }
 
-    //3. Execute and return the result directly
+    //4. Execute and return the result directly
 
-    return dllp::command_result("./.dbn.out");
+    return dllp::command_result("\"" + executable + "\"");
 }
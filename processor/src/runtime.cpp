@@ -0,0 +1,132 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <algorithm>
+#include <iterator>
+
+#include "runtime.hpp"
+#include "parse_utils.hpp"
+
+namespace {
+
+constexpr size_t max_depth = 3; ///< The maximum number of layers of the precompiled networks
+
+/*!
+ * \brief Convert the activation of a dense layer to a function
+ * \return true if the activation is supported at runtime, false otherwise
+ */
+bool runtime_function(const std::string& activation, dll::function& f) {
+    auto name = activation.empty() ? std::string("SIGMOID") : dllp::activation_function(activation);
+
+    if (name == "SIGMOID") {
+        f = dll::function::SIGMOID;
+    } else if (name == "TANH") {
+        f = dll::function::TANH;
+    } else if (name == "RELU") {
+        f = dll::function::RELU;
+    } else if (name == "SOFTMAX") {
+        f = dll::function::SOFTMAX;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool unsupported(bool verbose, const std::string& reason) {
+    if (verbose) {
+        std::cout << "dllp: runtime mode not possible (" << reason << "), compiling the network" << std::endl;
+    }
+
+    return false;
+}
+
+} // end of anonymous namespace
+
+bool dllp::runtime_supported(const layers_t& layers, const dll::processor::task& t, runtime_config& config, bool verbose) {
+    if (layers.empty() || layers.size() > max_depth) {
+        return unsupported(verbose, "only networks of 1 to " + std::to_string(max_depth) + " layers are precompiled");
+    }
+
+    if (t.ft_desc.trainer != "sgd" && t.ft_desc.trainer != "none") {
+        return unsupported(verbose, "only the SGD trainer is precompiled");
+    }
+
+    // The precompiled networks only use the momentum updater
+    if (t.ft_desc.updater != "none" && t.ft_desc.updater != "momentum") {
+        return unsupported(verbose, "updater " + t.ft_desc.updater);
+    }
+
+    if (t.ft_desc.decay != "none" && t.ft_desc.decay != "l1" && t.ft_desc.decay != "l2" && t.ft_desc.decay != "l1l2") {
+        return unsupported(verbose, "weight decay " + t.ft_desc.decay);
+    }
+
+    if (t.ft_desc.verbose || t.general_desc.batch_mode) {
+        return unsupported(verbose, "verbose and batch modes are not precompiled");
+    }
+
+    config.sizes.clear();
+    config.hidden     = dll::function::SIGMOID;
+    config.output     = dll::function::SIGMOID;
+    config.batch_size = t.ft_desc.batch_size > 0 ? t.ft_desc.batch_size : 1;
+
+    for (size_t i = 0; i < layers.size(); ++i) {
+        auto* dense = dynamic_cast<const dllp::dense_layer*>(layers[i].get());
+
+        if (!dense) {
+            return unsupported(verbose, "only dense layers are precompiled");
+        }
+
+        dll::function f;
+        if (!runtime_function(dense->activation, f)) {
+            return unsupported(verbose, "activation " + dense->activation);
+        }
+
+        if (i == layers.size() - 1) {
+            config.output = f;
+        } else if (i > 0 && f != config.hidden) {
+            return unsupported(verbose, "the hidden layers must share the same activation");
+        } else {
+            config.hidden = f;
+        }
+
+        if (i == 0) {
+            config.sizes.push_back(dense->visible);
+        }
+
+        config.sizes.push_back(dense->hidden);
+    }
+
+    if (config.hidden == dll::function::SOFTMAX || (config.output != dll::function::SIGMOID && config.output != dll::function::SOFTMAX)) {
+        return unsupported(verbose, "activation of the network");
+    }
+
+    if (std::find(std::begin(runtime_batch_sizes), std::end(runtime_batch_sizes), config.batch_size) == std::end(runtime_batch_sizes)) {
+        return unsupported(verbose, "batch size " + std::to_string(config.batch_size));
+    }
+
+    return true;
+}
+
+bool dllp::runtime_execute(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+    auto final_actions = actions;
+
+    if (std::find(actions.begin(), actions.end(), "auto") != actions.end()) {
+        final_actions = t.default_actions;
+    }
+
+    switch (config.sizes.size() - 1) {
+        case 1:
+            return runtime_dense_1(config, t, final_actions);
+        case 2:
+            return runtime_dense_2(config, t, final_actions);
+        case 3:
+            return runtime_dense_3(config, t, final_actions);
+        default:
+            return false;
+    }
+}
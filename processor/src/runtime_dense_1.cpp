@@ -0,0 +1,13 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "runtime_dense.hpp"
+
+bool dllp::runtime_dense_1(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+    // The hidden activation is meaningless with a single layer
+    return runtime_detail::dense_output<1, dll::function::SIGMOID>(config, t, actions);
+}
@@ -0,0 +1,12 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "runtime_dense.hpp"
+
+bool dllp::runtime_dense_2(const runtime_config& config, dll::processor::task& t, const std::vector<std::string>& actions) {
+    return runtime_detail::dense_hidden<2>(config, t, actions);
+}
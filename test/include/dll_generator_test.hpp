@@ -0,0 +1,61 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Common fixture for the tests of the data generators
+ */
+
+#pragma once
+
+#include "dll_test.hpp"
+
+#include "dll/dbn.hpp"
+#include "dll/neural/dense_layer.hpp"
+
+#include "mnist/mnist_reader.hpp"
+
+namespace dll_test {
+
+/*!
+ * \brief The network trained on the generators, a small dense network for MNIST
+ */
+template <typename... Parameters>
+using generator_dbn_t = typename dll::dbn_desc<
+    dll::dbn_layers<
+        dll::dense_layer_desc<28 * 28, 300>::layer_t,
+        dll::dense_layer_desc<300, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+    dll::batch_size<25>, Parameters...>::dbn_t;
+
+/*!
+ * \brief Read the MNIST samples the generators are built from
+ * \param n The number of samples to read
+ */
+inline auto generator_dataset(size_t n = 500) {
+    return mnist::read_dataset_direct<std::vector, etl::dyn_matrix<float, 1>>(n);
+}
+
+/*!
+ * \brief Fine-tune a network with the given training generator and check
+ * its training and test errors
+ * \param train_generator The generator of the training samples
+ * \param test_generator The generator of the test samples
+ */
+template <typename DBN = generator_dbn_t<>, typename TrainGenerator, typename TestGenerator>
+void check_generator_training(TrainGenerator& train_generator, TestGenerator& test_generator) {
+    auto dbn = std::make_unique<DBN>();
+
+    auto error = dbn->fine_tune(train_generator, 50);
+    std::cout << "error:" << error << std::endl;
+    CHECK(error < 5e-2);
+
+    auto test_error = dbn->evaluate_error(test_generator);
+    std::cout << "test_error:" << test_error << std::endl;
+    CHECK(test_error < 0.3);
+}
+
+} //end of dll_test namespace
@@ -0,0 +1,56 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <cstdint>
+#include <vector>
+
+#include "dll_test.hpp"
+
+#include "dll/util/arena.hpp"
+
+// The allocations are aligned and taken from the arena until it is exhausted
+TEST_CASE("unit/arena/1", "[unit]") {
+    dll::memory_arena arena(1024);
+
+    REQUIRE(arena.capacity() == 1024);
+
+    auto a = arena.allocate(100, alignof(float));
+    auto b = arena.allocate(100, alignof(double));
+
+    REQUIRE(arena.owns(a));
+    REQUIRE(arena.owns(b));
+    REQUIRE(reinterpret_cast<uintptr_t>(a) % dll::arena_alignment == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(b) % dll::arena_alignment == 0);
+    REQUIRE(arena.size() == 2 * dll::arena_alignment + 100);
+    REQUIRE(arena.heap_size() == 0);
+
+    auto c = arena.allocate(2048, alignof(double));
+
+    REQUIRE(!arena.owns(c));
+    REQUIRE(arena.heap_size() == 2048);
+
+    arena.deallocate(c, 2048);
+    arena.deallocate(b, 100);
+
+    REQUIRE(arena.heap_size() == 0);
+    REQUIRE(arena.size() == 2 * dll::arena_alignment + 100);
+}
+
+// Containers of different types can share the arena
+TEST_CASE("unit/arena/2", "[unit]") {
+    dll::memory_arena arena(4096);
+
+    std::vector<float, dll::arena_allocator<float>> floats(100, 1.0f, dll::arena_allocator<float>(arena));
+    std::vector<double, dll::arena_allocator<double>> doubles(100, 2.0, dll::arena_allocator<double>(arena));
+
+    REQUIRE(arena.owns(floats.data()));
+    REQUIRE(arena.owns(doubles.data()));
+    REQUIRE(arena.heap_size() == 0);
+
+    REQUIRE(floats[99] == 1.0f);
+    REQUIRE(doubles[99] == 2.0);
+}
@@ -13,6 +13,7 @@
 #include <deque>
 
 #include "dll_test.hpp"
+#include "dll_generator_test.hpp"
 
 #include "dll/dbn.hpp"
 #include "dll/rbm/rbm.hpp"
@@ -328,3 +329,23 @@ TEST_CASE("unit/augment/mnist/8", "[dbn][unit]") {
     std::cout << "test_error:" << test_error << std::endl;
     REQUIRE(test_error < 0.3);
 }
+
+// Use an in-memory generator for fine-tuning with several augmentation threads
+TEST_CASE("unit/augment/mnist/9", "[dbn][unit]") {
+    auto dataset = dll_test::generator_dataset();
+    REQUIRE(!dataset.training_images.empty());
+
+    using train_generator_t = dll::inmemory_data_generator_desc<dll::batch_size<25>, dll::big_batch_size<4>, dll::augment_threads<3>, dll::noise<20>, dll::categorical, dll::scale_pre<255>>;
+
+    auto train_generator = dll::make_generator(
+        dataset.training_images, dataset.training_labels,
+        dataset.training_images.size(), 10,
+        train_generator_t{});
+
+    auto test_generator = dll::make_generator(
+        dataset.test_images, dataset.test_labels,
+        dataset.test_images.size(), 10,
+        train_generator_t{});
+
+    dll_test::check_generator_training(*train_generator, *test_generator);
+}
@@ -6,6 +6,7 @@
 //=======================================================================
 
 #include <deque>
+#include <sstream>
 
 #include "dll_test.hpp"
 
@@ -204,3 +205,85 @@ TEST_CASE("unit/bn/5", "[unit][bn]") {
     FT_CHECK_2_VAL(net, dataset, 50, 5e-2);
     TEST_CHECK_2(net, dataset, 0.25);
 }
+
+// (Dense) BN folded into the previous layers
+TEST_CASE("unit/bn/6", "[unit][bn]") {
+    using network_t = dll::network_desc<
+        dll::network_layers<
+            dll::dense_layer_desc<28 * 28, 200, dll::no_bias, dll::no_activation>::layer_t,
+            dll::batch_normalization_2d_layer_desc<200>::layer_t,
+            dll::activation_layer_desc<dll::function::SIGMOID>::layer_t,
+
+            dll::dense_layer_desc<200, 10, dll::no_activation>::layer_t,
+            dll::batch_normalization_2d_layer_desc<10>::layer_t,
+            dll::activation_layer_desc<dll::function::SOFTMAX>::layer_t
+        >,
+        dll::updater<dll::updater_type::ADADELTA>, dll::batch_size<25>>::network_t;
+
+    auto dataset = dll::make_mnist_dataset_val(0, 1000, 2000, dll::batch_size<25>{}, dll::scale_pre<255>{});
+
+    auto net = std::make_unique<network_t>();
+
+    net->learning_rate = 0.01;
+
+    net->fine_tune_val(dataset.train(), dataset.val(), 10);
+
+    auto error = net->evaluate_error(dataset.test());
+
+    REQUIRE(net->fold_batch_normalization() == 2);
+    REQUIRE(net->fold_batch_normalization() == 0);
+
+    REQUIRE(std::abs(net->evaluate_error(dataset.test()) - error) < 1e-3);
+
+    // The folding must be saved along the weights
+
+    std::stringstream weights(std::ios::in | std::ios::out | std::ios::binary);
+    net->store(weights);
+
+    auto copy = std::make_unique<network_t>();
+    copy->load(weights);
+
+    REQUIRE(copy->template layer_get<1>().folded);
+    REQUIRE(copy->template layer_get<0>().folded_bias);
+    REQUIRE(!copy->template layer_get<3>().folded_bias);
+    REQUIRE(copy->fold_batch_normalization() == 0);
+
+    REQUIRE(copy->evaluate_error(dataset.test()) == Approx(net->evaluate_error(dataset.test())));
+}
+
+// (Dense) BN with the validation pipelined with the training
+TEST_CASE("unit/bn/7", "[unit][bn]") {
+    using network_t = dll::network_desc<
+        dll::network_layers<
+            dll::dense_layer_desc<28 * 28, 200, dll::no_bias, dll::no_activation>::layer_t,
+            dll::batch_normalization_2d_layer_desc<200>::layer_t,
+            dll::activation_layer_desc<dll::function::SIGMOID>::layer_t,
+
+            dll::dense_layer_desc<200, 10, dll::activation<dll::function::SOFTMAX>>::layer_t
+        >,
+        dll::updater<dll::updater_type::ADADELTA>, dll::early_stopping<dll::strategy::ERROR_BEST>,
+        dll::pipelined_epoch_error, dll::batch_size<25>>::network_t;
+
+    auto dataset = dll::make_mnist_dataset_val(0, 1000, 2000, dll::batch_size<25>{}, dll::scale_pre<255>{});
+
+    auto net = std::make_unique<network_t>();
+
+    net->learning_rate = 0.01;
+    net->patience      = 3;
+
+    FT_CHECK_2_VAL(net, dataset, 25, 5e-2);
+    TEST_CHECK_2(net, dataset, 0.25);
+
+    // The running statistics must be saved along the weights
+
+    std::stringstream weights(std::ios::in | std::ios::out | std::ios::binary);
+    net->store(weights);
+
+    auto copy = std::make_unique<network_t>();
+    copy->load(weights);
+
+    REQUIRE(copy->template layer_get<1>().mean == net->template layer_get<1>().mean);
+    REQUIRE(copy->template layer_get<1>().var == net->template layer_get<1>().var);
+
+    REQUIRE(copy->evaluate_error(dataset.test()) == Approx(net->evaluate_error(dataset.test())));
+}
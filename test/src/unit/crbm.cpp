@@ -160,3 +160,36 @@ TEST_CASE("unit/crbm/mnist/7", "[crbm][unit]") {
     auto error = rbm.train(dataset.training_images, 50);
     REQUIRE(error < 7e-2);
 }
+
+TEST_CASE("unit/crbm/mnist/8", "[crbm][unit]") {
+    dll::conv_rbm_square_desc<
+        1, 28, 20, 17,
+        dll::batch_size<10>,
+        dll::momentum>::layer_t rbm;
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 1, 28, 28>>(100);
+    REQUIRE(!dataset.training_images.empty());
+
+    mnist::binarize_dataset(dataset);
+
+    auto error = rbm.train(dataset.training_images, 10);
+    REQUIRE(error < 5e-2);
+
+    etl::fast_dyn_matrix<float, 8, 1, 28, 28> batch;
+
+    for (size_t i = 0; i < 8; ++i) {
+        batch(i) = dataset.training_images[i];
+    }
+
+    etl::fast_dyn_matrix<float, 8> free_energies;
+    rbm.batch_free_energy(batch, free_energies);
+
+    float sum = 0.0;
+
+    for (size_t i = 0; i < 8; ++i) {
+        REQUIRE(free_energies[i] == Approx(rbm.free_energy(dataset.training_images[i])).epsilon(1e-3));
+        sum += free_energies[i];
+    }
+
+    REQUIRE(rbm.batch_free_energy(batch) == Approx(sum).epsilon(1e-3));
+}
@@ -397,3 +397,26 @@ TEST_CASE("unit/dbn/mnist/12", "[dbn][unit]") {
 
     dll::dump_timers();
 }
+
+// Test streaming pretraining (no intermediate dataset)
+TEST_CASE("unit/dbn/mnist/13", "[dbn][unit]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::rbm_desc<28 * 28, 200, dll::momentum, dll::batch_size<20>, dll::init_weights>::layer_t,
+            dll::rbm_desc<200, 300, dll::momentum, dll::batch_size<20>>::layer_t,
+            dll::rbm_desc<300, 10, dll::momentum, dll::batch_size<20>, dll::hidden<dll::unit_type::SOFTMAX>>::layer_t>,
+        dll::streaming_pretrain, dll::batch_size<10>, dll::binarize_pre<30>, dll::trainer<dll::cg_trainer>>::dbn_t dbn_t;
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::dyn_matrix<float, 1>>(250);
+
+    REQUIRE(!dataset.training_images.empty());
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->pretrain(dataset.training_images, 20);
+
+    auto error = dbn->fine_tune(dataset.training_images, dataset.training_labels, 5);
+    REQUIRE(error < 5e-2);
+
+    TEST_CHECK(0.25);
+}
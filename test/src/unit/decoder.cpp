@@ -0,0 +1,104 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*
+ * \file
+ * \brief Tests for the parallel decoder
+ */
+
+#include <atomic>
+#include <chrono>
+
+#include "dll_test.hpp"
+
+#include "dll/util/decoder.hpp"
+
+namespace {
+
+/*!
+ * \brief A slow decoding function, recording the decoded samples
+ */
+struct recorder {
+    std::atomic<size_t> decoded{0};   ///< The number of decoded samples
+    std::atomic<size_t> read{0};      ///< The number of samples read
+    std::atomic<size_t> max_ahead{0}; ///< The maximum distance between a decoded sample and the reader
+
+    void operator()(size_t i, size_t& sample) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+        const size_t ahead = i > read ? i - read : 0;
+
+        size_t current = max_ahead;
+        while (ahead > current && !max_ahead.compare_exchange_weak(current, ahead)) {}
+
+        ++decoded;
+
+        sample = 3 * i;
+    }
+};
+
+} // end of anonymous namespace
+
+// The samples are decoded in order, in a limited window
+TEST_CASE("unit/decoder/1", "[unit][decoder]") {
+    recorder rec;
+
+    dll::parallel_decoder<size_t> decoder(100, [&rec](size_t i, size_t& sample) { rec(i, sample); }, 3, 4);
+
+    // Nothing is decoded before the first read
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(rec.decoded == 0);
+
+    for (size_t i = 0; i < 100; ++i) {
+        REQUIRE(decoder.get(i) == 3 * i);
+        ++rec.read;
+    }
+
+    REQUIRE(rec.decoded == 100);
+    REQUIRE(rec.max_ahead <= 4);
+}
+
+// Reading out of order restarts the decoding
+TEST_CASE("unit/decoder/2", "[unit][decoder]") {
+    dll::parallel_decoder<size_t> decoder(50, [](size_t i, size_t& sample) { sample = 3 * i; }, 2, 8);
+
+    for (size_t i = 0; i < 5; ++i) {
+        REQUIRE(decoder.get(i) == 3 * i);
+    }
+
+    REQUIRE(decoder.get(20) == 60);
+    REQUIRE(decoder.get(21) == 63);
+    REQUIRE(decoder.get(2) == 6);
+    REQUIRE(decoder.get(3) == 9);
+    REQUIRE(decoder.get(49) == 147);
+    REQUIRE(decoder.get(0) == 0);
+}
+
+// The decoders stop in any state
+TEST_CASE("unit/decoder/3", "[unit][decoder]") {
+    // Never read
+    {
+        dll::parallel_decoder<size_t> decoder(50, [](size_t i, size_t& sample) { sample = i; }, 2, 8);
+    }
+
+    // Waiting for free slots
+    {
+        dll::parallel_decoder<size_t> decoder(50, [](size_t i, size_t& sample) { sample = i; }, 4, 2);
+
+        REQUIRE(decoder.get(0) == 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Completely read
+    {
+        dll::parallel_decoder<size_t> decoder(3, [](size_t i, size_t& sample) { sample = i; }, 4, 8);
+
+        for (size_t i = 0; i < 3; ++i) {
+            REQUIRE(decoder.get(i) == i);
+        }
+    }
+}
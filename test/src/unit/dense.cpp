@@ -5,13 +5,16 @@
 //  http://opensource.org/licenses/MIT)
 //=======================================================================
 
+#include <algorithm>
 #include <deque>
+#include <sstream>
 
 #include "dll_test.hpp"
 
 #include "dll/neural/dense_layer.hpp"
 #include "dll/transform/shape_1d_layer.hpp"
 #include "dll/neural/activation_layer.hpp"
+#include "dll/neural/dropout_layer.hpp"
 #include "dll/dbn.hpp"
 #include "dll/datasets.hpp"
 
@@ -310,3 +313,330 @@ TEST_CASE("unit/dense/sgd/14", "[unit][dense][dbn][mnist][sgd]") {
     FT_CHECK(50, 5e-2);
     TEST_CHECK(0.2);
 }
+
+// Test data-parallel SGD
+TEST_CASE("unit/dense/sgd/15", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100, dll::activation<dll::function::RELU>>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::updater<dll::updater_type::MOMENTUM>, dll::parallel_sgd<4>, dll::trainer<dll::sgd_trainer>, dll::batch_size<20>>::dbn_t dbn_t;
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(500);
+    REQUIRE(!dataset.training_images.empty());
+
+    dll_test::mnist_scale(dataset);
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->initial_momentum = 0.9;
+    dbn->final_momentum   = 0.9;
+    dbn->learning_rate    = 0.01;
+
+    FT_CHECK(50, 5e-2);
+    TEST_CHECK(0.2);
+}
+
+// Test the memory arena of the SGD trainer
+TEST_CASE("unit/dense/sgd/16", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100, dll::activation<dll::function::RELU>>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::updater<dll::updater_type::ADAM>, dll::parallel_sgd<2>, dll::huge_pages, dll::trainer<dll::sgd_trainer>, dll::batch_size<20>>::dbn_t dbn_t;
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(500);
+    REQUIRE(!dataset.training_images.empty());
+
+    dll_test::mnist_scale(dataset);
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->learning_rate = 0.001;
+
+    {
+        dll::sgd_trainer<dbn_t> trainer(*dbn);
+
+        // All the contexts must fit in the arena
+        REQUIRE(trainer.arena.heap_size() == 0);
+        REQUIRE(trainer.arena.size() <= trainer.arena.capacity());
+
+        // The gradients and the two moments of the weights of each context
+        REQUIRE(trainer.memory_footprint() >= 3 * 3 * (28 * 28 * 100 + 100 * 10) * sizeof(float));
+    }
+
+    FT_CHECK(50, 5e-2);
+    TEST_CHECK(0.2);
+}
+
+// Test the fused updates with decay and clipping
+TEST_CASE("unit/dense/sgd/17", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100, dll::activation<dll::function::RELU>>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::updater<dll::updater_type::NESTEROV>, dll::weight_decay<dll::decay_type::L2_FULL>, dll::clip_gradients,
+        dll::parallel_sgd<4>, dll::trainer<dll::sgd_trainer>, dll::batch_size<20>>::dbn_t dbn_t;
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(500);
+    REQUIRE(!dataset.training_images.empty());
+
+    dll_test::mnist_scale(dataset);
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->momentum       = 0.9;
+    dbn->learning_rate  = 0.01;
+    dbn->l2_weight_cost = 0.0001;
+
+    FT_CHECK(50, 5e-2);
+    TEST_CHECK(0.2);
+}
+
+// Batched evaluation must match the evaluation of each sample
+TEST_CASE("unit/dense/sgd/18", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::trainer<dll::sgd_trainer>, dll::batch_size<20>>::dbn_t dbn_t;
+
+    // Not a multiple of the batch size
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(510);
+    REQUIRE(!dataset.training_images.empty());
+
+    dll_test::mnist_scale(dataset);
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->learning_rate = 0.05;
+
+    FT_CHECK(10, 0.2);
+
+    size_t errors = 0;
+
+    for (size_t i = 0; i < dataset.training_images.size(); ++i) {
+        if (dbn->predict(dataset.training_images[i]) != dataset.training_labels[i]) {
+            ++errors;
+        }
+    }
+
+    auto confusion = dll::test_confusion(*dbn, dataset.training_images, dataset.training_labels);
+
+    REQUIRE(etl::sum(confusion) == dataset.training_images.size());
+
+    auto test_error = dll::test_set(dbn, dataset.training_images, dataset.training_labels, dll::predictor());
+
+    REQUIRE(test_error == Approx(errors / double(dataset.training_images.size())));
+}
+
+
+// Streamed evaluation must match the evaluation through a generator
+TEST_CASE("unit/dense/sgd/19", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::trainer<dll::sgd_trainer>, dll::batch_size<20>, dll::normalize_pre>::dbn_t dbn_t;
+
+    // Not a multiple of the batch size
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(510);
+    REQUIRE(!dataset.training_images.empty());
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->learning_rate = 0.05;
+
+    FT_CHECK(10, 0.2);
+
+    auto generator = dll::make_generator(
+        dataset.training_images, dataset.training_labels,
+        dataset.training_images.size(), 10, dbn_t::categorical_generator_t{});
+
+    auto metrics = dbn->evaluate_metrics(*generator);
+
+    REQUIRE(dbn->evaluate_error(dataset.training_images, dataset.training_labels) == Approx(std::get<0>(metrics)));
+    REQUIRE(dbn->evaluate_error(dataset.training_images.begin(), dataset.training_images.end(), dataset.training_labels.begin(), dataset.training_labels.end()) == Approx(std::get<0>(metrics)));
+}
+
+namespace {
+
+/*!
+ * \brief Watcher recording the start (true) and the end (false) of the
+ * fine-tuning epochs
+ */
+template <typename DBN>
+struct epoch_recorder : dll::mute_dbn_watcher<DBN> {
+    static std::vector<std::pair<bool, size_t>> events; ///< The recorded events
+
+    void ft_epoch_start(size_t epoch, const DBN& /*dbn*/) {
+        events.emplace_back(true, epoch);
+    }
+
+    void ft_epoch_end(size_t epoch, double /*error*/, double /*loss*/, double /*val_error*/, double /*val_loss*/, const DBN& /*dbn*/) {
+        events.emplace_back(false, epoch);
+    }
+};
+
+template <typename DBN>
+std::vector<std::pair<bool, size_t>> epoch_recorder<DBN>::events;
+
+template <typename... Parameters>
+using pipelined_network_t = typename dll::network_desc<
+    dll::network_layers<
+        dll::dense_layer_desc<28 * 28, 100>::layer_t,
+        dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+    dll::early_stopping<dll::strategy::ERROR_BEST>, dll::watcher<epoch_recorder>,
+    dll::trainer<dll::sgd_trainer>, dll::batch_size<25>, Parameters...>::network_t;
+
+} // end of anonymous namespace
+
+// Validation pipelined with the training of the next epoch
+TEST_CASE("unit/dense/sgd/20", "[unit][dense][dbn][mnist][sgd]") {
+    using network_t   = pipelined_network_t<dll::pipelined_epoch_error>;
+    using reference_t = pipelined_network_t<>;
+
+    auto dataset = dll::make_mnist_dataset_val(0, 1000, 2000, dll::batch_size<25>{}, dll::scale_pre<255>{});
+
+    dll::set_seed(42);
+
+    auto net = std::make_unique<network_t>();
+
+    net->learning_rate = 0.05;
+    net->patience      = 3;
+
+    FT_CHECK_2_VAL(net, dataset, 25, 0.1);
+    TEST_CHECK_2(net, dataset, 0.3);
+
+    // The same network trained without the pipeline
+
+    dll::set_seed(42);
+
+    auto ref = std::make_unique<reference_t>();
+
+    ref->learning_rate = 0.05;
+    ref->patience      = 3;
+
+    ref->fine_tune_val(dataset.train(), dataset.val(), 25);
+
+    // Each epoch is started before being trained and ended once validated,
+    // after the start of the next epoch
+
+    auto& events = epoch_recorder<network_t>::events;
+
+    std::vector<size_t> starts;
+    std::vector<size_t> ends;
+
+    for (auto& event : events) {
+        if (event.first) {
+            REQUIRE(event.second == starts.size());
+            starts.push_back(event.second);
+        } else {
+            REQUIRE(event.second == ends.size());
+            REQUIRE(starts.size() >= std::min(event.second + 2, size_t(25)));
+            ends.push_back(event.second);
+        }
+    }
+
+    REQUIRE(!ends.empty());
+
+    // Only the epoch trained when the training stops is not ended
+    REQUIRE(starts.size() - ends.size() <= 1);
+
+    // The training stops at the same epoch with the same weights
+
+    std::vector<size_t> reference_ends;
+
+    for (auto& event : epoch_recorder<reference_t>::events) {
+        if (!event.first) {
+            reference_ends.push_back(event.second);
+        }
+    }
+
+    REQUIRE(ends == reference_ends);
+
+    REQUIRE(net->template layer_get<0>().w == ref->template layer_get<0>().w);
+    REQUIRE(net->template layer_get<0>().b == ref->template layer_get<0>().b);
+    REQUIRE(net->template layer_get<1>().w == ref->template layer_get<1>().w);
+    REQUIRE(net->template layer_get<1>().b == ref->template layer_get<1>().b);
+}
+
+// Parallel training must be reproducible for a given seed
+TEST_CASE("unit/dense/sgd/21", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100, dll::activation<dll::function::RELU>>::layer_t,
+            dll::dropout_layer_desc<20>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::parallel_sgd<4>, dll::shuffle, dll::trainer<dll::sgd_trainer>, dll::batch_size<20>>::dbn_t dbn_t;
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(300);
+    REQUIRE(!dataset.training_images.empty());
+
+    dll_test::mnist_scale(dataset);
+
+    auto train = [&dataset]() {
+        dll::set_seed(42);
+
+        auto dbn = std::make_unique<dbn_t>();
+
+        dbn->learning_rate = 0.01;
+
+        dbn->fine_tune(dataset.training_images, dataset.training_labels, 5);
+
+        return std::make_pair(
+            etl::dyn_matrix<float, 2>(dbn->template layer_get<0>().w),
+            etl::dyn_matrix<float, 2>(dbn->template layer_get<2>().w));
+    };
+
+    auto first  = train();
+    auto second = train();
+
+    REQUIRE(first.first == second.first);
+    REQUIRE(first.second == second.second);
+}
+
+// The parallel evaluation must give the same confusion matrix as the serial one
+TEST_CASE("unit/dense/sgd/22", "[unit][dense][dbn][mnist][sgd]") {
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::trainer<dll::sgd_trainer>, dll::batch_size<20>>::dbn_t dbn_t;
+
+    typedef dll::dbn_desc<
+        dll::dbn_layers<
+            dll::dense_layer_desc<28 * 28, 100>::layer_t,
+            dll::dense_layer_desc<100, 10, dll::activation<dll::function::SOFTMAX>>::layer_t>,
+        dll::trainer<dll::sgd_trainer>, dll::batch_size<20>, dll::serial>::dbn_t serial_dbn_t;
+
+    static_assert(dbn_t::layers_t::is_reentrant, "Dense layers can be evaluated concurrently");
+
+    // Not a multiple of the batch size
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(510);
+    REQUIRE(!dataset.training_images.empty());
+
+    dll_test::mnist_scale(dataset);
+
+    auto dbn = std::make_unique<dbn_t>();
+
+    dbn->learning_rate = 0.05;
+
+    FT_CHECK(10, 0.2);
+
+    auto serial_dbn = std::make_unique<serial_dbn_t>();
+
+    std::stringstream weights;
+    dbn->store(weights);
+    serial_dbn->load(weights);
+
+    auto confusion        = dll::test_confusion(*dbn, dataset.training_images, dataset.training_labels);
+    auto serial_confusion = dll::test_confusion(*serial_dbn, dataset.training_images, dataset.training_labels);
+
+    REQUIRE(etl::dim<0>(confusion) == etl::dim<0>(serial_confusion));
+    REQUIRE(etl::dim<1>(confusion) == etl::dim<1>(serial_confusion));
+
+    for (size_t i = 0; i < etl::size(confusion); ++i) {
+        REQUIRE(confusion[i] == serial_confusion[i]);
+    }
+}
@@ -0,0 +1,100 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*
+ * \file
+ * \brief Tests for the dropout layer
+ */
+
+#include "dll_test.hpp"
+
+#include "dll/neural/dropout_layer.hpp"
+
+namespace {
+
+/*!
+ * \brief The part of the SGD context used by the dropout layer
+ */
+struct dropout_context {
+    std::vector<uint64_t> mask;      ///< The bitmask of the kept units
+    etl::dyn_matrix<float, 2> errors; ///< The errors of the batch
+};
+
+} // end of anonymous namespace
+
+// The expectation of the output is the input
+TEST_CASE("unit/dropout/1", "[unit][dropout]") {
+    using layer_t = dll::dropout_layer_desc<30>::layer_t;
+
+    constexpr size_t N = 2000;
+
+    etl::dyn_matrix<float, 2> input(1, 100);
+    etl::dyn_matrix<float, 2> output(1, 100);
+    etl::dyn_matrix<float, 2> sum(1, 100);
+
+    input = etl::uniform_generator(1.0, 2.0);
+    sum   = 0.0;
+
+    size_t dropped = 0;
+
+    for (size_t i = 0; i < N; ++i) {
+        layer_t::train_forward_batch(output, input);
+
+        sum += output;
+
+        for (size_t j = 0; j < 100; ++j) {
+            dropped += output(0, j) == 0.0f;
+        }
+    }
+
+    for (size_t j = 0; j < 100; ++j) {
+        REQUIRE(sum(0, j) / N == Approx(input(0, j)).epsilon(0.1));
+    }
+
+    REQUIRE(double(dropped) / (N * 100) == Approx(0.3).epsilon(0.05));
+
+    // The test forward is the identity
+    layer_t::test_forward_batch(output, input);
+    REQUIRE(output == input);
+}
+
+// The errors are only propagated through the kept units
+TEST_CASE("unit/dropout/2", "[unit][dropout]") {
+    using layer_t = dll::dropout_layer_desc<50>::layer_t;
+
+    layer_t layer;
+
+    etl::dyn_matrix<float, 2> input(8, 300);
+    etl::dyn_matrix<float, 2> output(8, 300);
+    etl::dyn_matrix<float, 2> back(8, 300);
+
+    input = etl::uniform_generator(1.0, 2.0);
+
+    dropout_context context;
+    context.errors = etl::dyn_matrix<float, 2>(8, 300);
+    context.errors = 1.0;
+
+    layer_t::train_forward_batch(output, input, context);
+    layer.backward_batch(back, context);
+
+    size_t dropped = 0;
+
+    for (size_t i = 0; i < 8; ++i) {
+        for (size_t j = 0; j < 300; ++j) {
+            if (output(i, j) == 0.0f) {
+                REQUIRE(back(i, j) == 0.0f);
+                ++dropped;
+            } else {
+                REQUIRE(output(i, j) == Approx(2.0f * input(i, j)));
+                REQUIRE(back(i, j) == Approx(2.0f));
+            }
+        }
+    }
+
+    REQUIRE(dropped > 0);
+    REQUIRE(dropped < 8 * 300);
+}
@@ -0,0 +1,99 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*
+ * \file
+ * \brief Tests for the activation functions
+ */
+
+#include "dll_test.hpp"
+
+#include "dll/neural/dense_layer.hpp"
+
+namespace {
+
+/*!
+ * \brief Check the fused bias and activation of a 2D batch against the
+ * separate operations
+ */
+template <dll::function F>
+void check_bias_activate_2d() {
+    etl::fast_dyn_matrix<float, 7, 13> input;
+    etl::fast_dyn_matrix<float, 13> b;
+
+    input = etl::normal_generator(0.0, 2.0);
+    b     = etl::normal_generator(0.0, 1.0);
+
+    etl::fast_dyn_matrix<float, 7, 13> reference;
+    reference = etl::bias_add_2d(input, b);
+    reference = dll::f_activate<F>(reference);
+
+    etl::fast_dyn_matrix<float, 7, 13> output;
+    output = input;
+    dll::f_bias_activate_2d<F>(output, b);
+
+    REQUIRE(etl::approx_equals(output, reference, 1e-5));
+
+    // Without bias
+
+    reference = dll::f_activate<F>(input);
+
+    output = input;
+    dll::f_bias_activate_2d<F>(output, b, false);
+
+    REQUIRE(etl::approx_equals(output, reference, 1e-5));
+}
+
+/*!
+ * \brief Check the fused bias and activation of a 4D batch against the
+ * separate operations
+ */
+template <dll::function F>
+void check_bias_activate_4d() {
+    etl::fast_dyn_matrix<float, 3, 5, 4, 6> input;
+    etl::fast_dyn_matrix<float, 5> b;
+
+    input = etl::normal_generator(0.0, 2.0);
+    b     = etl::normal_generator(0.0, 1.0);
+
+    etl::fast_dyn_matrix<float, 3, 5, 4, 6> reference;
+    reference = etl::bias_add_4d(input, b);
+    reference = dll::f_activate<F>(reference);
+
+    etl::fast_dyn_matrix<float, 3, 5, 4, 6> output;
+    output = input;
+    dll::f_bias_activate_4d<F>(output, b);
+
+    REQUIRE(etl::approx_equals(output, reference, 1e-5));
+
+    // Without bias
+
+    reference = dll::f_activate<F>(input);
+
+    output = input;
+    dll::f_bias_activate_4d<F>(output, b, false);
+
+    REQUIRE(etl::approx_equals(output, reference, 1e-5));
+}
+
+} // end of anonymous namespace
+
+TEST_CASE("unit/function/bias_activate/2d", "[unit][function]") {
+    check_bias_activate_2d<dll::function::IDENTITY>();
+    check_bias_activate_2d<dll::function::SIGMOID>();
+    check_bias_activate_2d<dll::function::TANH>();
+    check_bias_activate_2d<dll::function::RELU>();
+    check_bias_activate_2d<dll::function::SOFTMAX>();
+}
+
+TEST_CASE("unit/function/bias_activate/4d", "[unit][function]") {
+    check_bias_activate_4d<dll::function::IDENTITY>();
+    check_bias_activate_4d<dll::function::SIGMOID>();
+    check_bias_activate_4d<dll::function::TANH>();
+    check_bias_activate_4d<dll::function::RELU>();
+    check_bias_activate_4d<dll::function::SOFTMAX>();
+}
@@ -0,0 +1,80 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <vector>
+
+#include "dll_test.hpp"
+
+#include "dll/trainer/fused_updater.hpp"
+
+namespace {
+
+template <typename T>
+dll::fused_parameter<T> sgd_parameter(std::vector<T>& w, const std::vector<T>& grad, T k) {
+    dll::fused_parameter<T> p;
+
+    p.w    = w.data();
+    p.grad = grad.data();
+    p.size = w.size();
+    p.k[0] = k;
+
+    return p;
+}
+
+} // end of anonymous namespace
+
+// The variables of each type are chunked and updated in their own type
+TEST_CASE("unit/fused_updater/1", "[unit][sgd]") {
+    const size_t n_float  = dll::fused_chunk_size + 100;
+    const size_t n_double = 2 * dll::fused_chunk_size;
+
+    std::vector<float> wf(n_float, 1.0f);
+    std::vector<float> gf(n_float, 2.0f);
+    std::vector<double> wd(n_double, 1.0);
+    std::vector<double> gd(n_double, 3.0);
+
+    dll::fused_variables variables;
+
+    variables.push_back(sgd_parameter(wf, gf, 0.5f));
+    variables.push_back(sgd_parameter(wd, gd, 0.25));
+
+    REQUIRE(variables.size() == 2);
+    REQUIRE(variables.floats.size() == 1);
+    REQUIRE(variables.doubles.size() == 1);
+    REQUIRE(variables.chunks.size() == 4);
+
+    size_t floats  = 0;
+    size_t doubles = 0;
+
+    for (auto& chunk : variables.chunks) {
+        REQUIRE(chunk.parameter == 0);
+        REQUIRE(chunk.first < chunk.last);
+        REQUIRE(chunk.last - chunk.first <= dll::fused_chunk_size);
+
+        (chunk.is_double ? doubles : floats) += chunk.last - chunk.first;
+    }
+
+    REQUIRE(floats == n_float);
+    REQUIRE(doubles == n_double);
+
+    for (size_t c = 0; c < variables.chunks.size(); ++c) {
+        variables.update<dll::updater_type::SGD>(c);
+    }
+
+    for (auto w : wf) {
+        REQUIRE(w == Approx(2.0f));
+    }
+
+    for (auto w : wd) {
+        REQUIRE(w == Approx(1.75));
+    }
+
+    variables.clear();
+
+    REQUIRE(variables.size() == 0);
+    REQUIRE(variables.chunks.empty());
+}
@@ -0,0 +1,67 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*
+ * \file
+ * \brief Tests for the storage and prefetching modes of the in-memory generator
+ */
+
+#include "dll_generator_test.hpp"
+
+// Use a compact in-memory generator for fine-tuning
+TEST_CASE("unit/inmemory_generator/compact", "[dbn][unit]") {
+    auto dataset = dll_test::generator_dataset();
+    REQUIRE(!dataset.training_images.empty());
+
+    using train_generator_t = dll::inmemory_data_generator_desc<dll::batch_size<25>, dll::categorical, dll::scale_pre<255>, dll::compact_storage>;
+
+    auto train_generator = dll::make_generator(
+        dataset.training_images, dataset.training_labels,
+        dataset.training_images.size(), 10,
+        train_generator_t{});
+
+    auto test_generator = dll::make_generator(
+        dataset.test_images, dataset.test_labels,
+        dataset.test_images.size(), 10,
+        train_generator_t{});
+
+    // The samples are expanded and scaled on the fly
+    train_generator->reset();
+    REQUIRE(train_generator->data_batch()(3)[200] == Approx(dataset.training_images[3][200] / 255.0f));
+
+    dll_test::check_generator_training(*train_generator, *test_generator);
+}
+
+// Use an in-memory generator gathering batches in the background
+TEST_CASE("unit/inmemory_generator/prefetch", "[dbn][unit]") {
+    auto dataset = dll_test::generator_dataset(510);
+    REQUIRE(!dataset.training_images.empty());
+
+    using train_generator_t = dll::inmemory_data_generator_desc<dll::batch_size<25>, dll::categorical, dll::scale_pre<255>, dll::async_prefetch>;
+    using sync_generator_t  = dll::inmemory_data_generator_desc<dll::batch_size<25>, dll::categorical, dll::scale_pre<255>>;
+
+    auto train_generator = dll::make_generator(dataset.training_images, dataset.training_labels, 10, train_generator_t{});
+    auto sync_generator  = dll::make_generator(dataset.training_images, dataset.training_labels, 10, sync_generator_t{});
+
+    // The prefetched batches must be the same as the synchronous ones
+    train_generator->reset();
+    sync_generator->reset();
+
+    while (sync_generator->has_next_batch()) {
+        REQUIRE(train_generator->has_next_batch());
+        REQUIRE(etl::dim<0>(train_generator->data_batch()) == etl::dim<0>(sync_generator->data_batch()));
+        REQUIRE(etl::approx_equals(train_generator->data_batch(), sync_generator->data_batch(), 1e-6));
+        REQUIRE(etl::approx_equals(train_generator->label_batch(), sync_generator->label_batch(), 1e-6));
+
+        train_generator->next_batch();
+        sync_generator->next_batch();
+    }
+
+    auto test_generator = dll::make_generator(dataset.test_images, dataset.test_labels, 10, train_generator_t{});
+
+    dll_test::check_generator_training<dll_test::generator_dbn_t<dll::shuffle>>(*train_generator, *test_generator);
+}
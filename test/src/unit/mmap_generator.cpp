@@ -0,0 +1,140 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*
+ * \file
+ * \brief Tests for the shards and the memory-mapped generator
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <unistd.h> // For mkstemp and close
+
+#include "dll_generator_test.hpp"
+
+namespace {
+
+/*!
+ * \brief A temporary shard file with a unique name, removed at the end of
+ * the test
+ */
+struct temporary_shard {
+    std::string path; ///< The path of the shard
+
+    explicit temporary_shard(const std::string& name) {
+        std::string pattern = "/tmp/dll_" + name + ".XXXXXX";
+
+        std::vector<char> buffer(pattern.begin(), pattern.end());
+        buffer.push_back('\0');
+
+        const int fd = mkstemp(buffer.data());
+        REQUIRE(fd != -1);
+        close(fd);
+
+        path = buffer.data();
+    }
+
+    temporary_shard(const temporary_shard& rhs) = delete;
+    temporary_shard& operator=(const temporary_shard& rhs) = delete;
+
+    ~temporary_shard() {
+        std::remove(path.c_str());
+    }
+};
+
+using mmap_generator_t = dll::mmap_data_generator_desc<dll::batch_size<25>, dll::categorical, dll::scale_pre<255>>;
+
+} // end of anonymous namespace
+
+// Use a memory-mapped shard generator for fine-tuning
+TEST_CASE("unit/mmap_generator/1", "[dbn][unit]") {
+    auto dataset = dll_test::generator_dataset();
+    REQUIRE(!dataset.training_images.empty());
+
+    temporary_shard train_shard("mnist_500_train");
+    temporary_shard test_shard("mnist_500_test");
+
+    REQUIRE(dll::write_shard(train_shard.path, dataset.training_images, dataset.training_labels, 10, dll::shard_type::UINT8));
+    REQUIRE(dll::write_shard(test_shard.path, dataset.test_images, dataset.test_labels, 10, dll::shard_type::FLOAT));
+
+    auto train_generator = dll::make_mmap_generator<1>(train_shard.path, mmap_generator_t{});
+    auto test_generator  = dll::make_mmap_generator<1>(test_shard.path, mmap_generator_t{});
+
+    REQUIRE(train_generator->size() == dataset.training_images.size());
+    REQUIRE(!train_generator->zero_copy);
+
+    // The first batch must match the scaled samples
+    train_generator->reset();
+    REQUIRE(train_generator->data_batch()(3)[100] == Approx(dataset.training_images[3][100] / 255.0f));
+    REQUIRE(train_generator->label_batch()(3, size_t(dataset.training_labels[3])) == Approx(1.0f));
+
+    dll_test::check_generator_training(*train_generator, *test_generator);
+}
+
+// Invalid shards are rejected when opened
+TEST_CASE("unit/mmap_generator/2", "[unit]") {
+    auto dataset = dll_test::generator_dataset(100);
+    REQUIRE(!dataset.training_images.empty());
+
+    temporary_shard shard("mnist_100_invalid");
+
+    // Labels out of the classes of the shard
+    REQUIRE(dll::write_shard(shard.path, dataset.training_images, dataset.training_labels, 5, dll::shard_type::UINT8));
+    REQUIRE_THROWS(dll::make_mmap_generator<1>(shard.path, mmap_generator_t{}));
+
+    // Unknown type of values
+    REQUIRE(dll::write_shard(shard.path, dataset.training_images, dataset.training_labels, 10, dll::shard_type::UINT8));
+    REQUIRE_NOTHROW(dll::make_mmap_generator<1>(shard.path, mmap_generator_t{}));
+
+    {
+        std::fstream stream(shard.path, std::ios::in | std::ios::out | std::ios::binary);
+
+        const uint32_t type = 7;
+        stream.seekp(offsetof(dll::shard_header, type));
+        stream.write(reinterpret_cast<const char*>(&type), sizeof(type));
+    }
+
+    REQUIRE_THROWS(dll::make_mmap_generator<1>(shard.path, mmap_generator_t{}));
+
+    // Missing shard
+    std::string missing;
+
+    {
+        temporary_shard removed("missing");
+        missing = removed.path;
+    }
+
+    REQUIRE_THROWS(dll::make_mmap_generator<1>(missing, mmap_generator_t{}));
+}
+
+// The uint8 values are rounded and clamped like the compact storage
+TEST_CASE("unit/mmap_generator/3", "[unit]") {
+    std::vector<etl::fast_dyn_matrix<float, 4>> samples(1);
+    std::vector<float> labels{1.0f};
+
+    samples[0][0] = 1.6f;
+    samples[0][1] = 2.4f;
+    samples[0][2] = -3.0f;
+    samples[0][3] = 300.0f;
+
+    temporary_shard shard("rounding");
+
+    REQUIRE(dll::write_shard(shard.path, samples, labels, 2, dll::shard_type::UINT8));
+
+    dll::mapped_shard mapped(shard.path);
+    REQUIRE(mapped.is_open());
+
+    const uint8_t* values = mapped.data<uint8_t>(0);
+
+    REQUIRE(values[0] == 2);
+    REQUIRE(values[1] == 2);
+    REQUIRE(values[2] == 0);
+    REQUIRE(values[3] == 255);
+}
@@ -6,6 +6,12 @@
 //=======================================================================
 
 #include <deque>
+#include <cstdio>
+#include <cstdlib>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "cpp_utils/string.hpp"
 
@@ -137,6 +143,59 @@ dll::processor::options default_options() {
     return opt;
 }
 
+/*!
+ * \brief Return the inodes of the binaries in the given cache directory
+ */
+std::vector<ino_t> cache_entries(const std::string& directory) {
+    std::vector<ino_t> entries;
+
+    if (DIR* dir = opendir(directory.c_str())) {
+        while (auto* entry = readdir(dir)) {
+            std::string name(entry->d_name);
+
+            struct stat attr;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".out") == 0 && !stat((directory + "/" + name).c_str(), &attr)) {
+                entries.push_back(attr.st_ino);
+            }
+        }
+
+        closedir(dir);
+    }
+
+    return entries;
+}
+
+/*!
+ * \brief A cache directory, emptied and removed at the end of the test
+ */
+struct temporary_cache {
+    const std::string directory; ///< The directory of the cache
+
+    explicit temporary_cache(const std::string& directory) : directory(directory) {
+        clear();
+    }
+
+    ~temporary_cache() {
+        clear();
+    }
+
+    void clear() {
+        if (DIR* dir = opendir(directory.c_str())) {
+            while (auto* entry = readdir(dir)) {
+                std::string name(entry->d_name);
+
+                if (name != "." && name != "..") {
+                    std::remove((directory + "/" + name).c_str());
+                }
+            }
+
+            closedir(dir);
+        }
+
+        rmdir(directory.c_str());
+    }
+};
+
 } // end of anonymous namespace
 
 #define FT_ERROR_BELOW(min)                                \
@@ -414,3 +473,100 @@ TEST_CASE("unit/processor/cdbn/2", "[unit][dbn][mnist][conv][proc]") {
     SPARSITY_BELOW("epoch 24", 0.4, 0);
     SPARSITY_BELOW("epoch 24", 0.35, 1);
 }
+
+// Compilation cache
+
+TEST_CASE("unit/processor/cache/1", "[unit][dense][dbn][mnist][sgd][proc]") {
+    temporary_cache cache(".dllp_test_cache");
+
+    auto opt      = default_options();
+    opt.cache     = true;
+    opt.cache_dir = cache.directory;
+
+    auto lines = get_result(opt, {"auto"}, "dense_sgd_1.conf");
+    REQUIRE(!lines.empty());
+
+    FT_ERROR_BELOW(5e-2);
+
+    auto entries = cache_entries(cache.directory);
+    REQUIRE(entries.size() == 1);
+
+    // The generated source is removed once compiled
+    struct stat attr;
+    REQUIRE(stat((cache.directory + "/.dbn." + std::to_string(getpid()) + ".cpp").c_str(), &attr) != 0);
+
+    // The second run uses the cached binary
+    lines = get_result(opt, {"auto"}, "dense_sgd_1.conf");
+    REQUIRE(!lines.empty());
+
+    FT_ERROR_BELOW(5e-2);
+    TEST_ERROR_BELOW(0.3);
+
+    REQUIRE(cache_entries(cache.directory) == entries);
+
+    // An empty cache still keeps the binary that was just built
+    opt.cache_size = 0;
+
+    lines = get_result(opt, {"train", "test"}, "dense_sgd_2.conf");
+    REQUIRE(!lines.empty());
+
+    auto new_entries = cache_entries(cache.directory);
+    REQUIRE(new_entries.size() == 1);
+    REQUIRE(new_entries != entries);
+}
+
+// Runtime mode
+
+TEST_CASE("unit/processor/runtime/1", "[unit][dense][dbn][mnist][sgd][proc]") {
+    auto opt    = default_options();
+    opt.runtime = true;
+
+    const auto source_file = "./.dbn." + std::to_string(getpid()) + ".cpp";
+
+    std::remove(".dbn.out");
+
+    // Without a compiler, only the runtime mode can run the network
+    const char* cxx = std::getenv("CXX");
+    const std::string previous_cxx(cxx ? cxx : "");
+    unsetenv("CXX");
+
+    auto lines = get_result(opt, {"auto"}, "dense_sgd_1.conf");
+
+    if (cxx) {
+        setenv("CXX", previous_cxx.c_str(), 1);
+    }
+
+    REQUIRE(!lines.empty());
+
+    // Nothing has been generated nor compiled
+    struct stat attr;
+    REQUIRE(stat(source_file.c_str(), &attr) != 0);
+    REQUIRE(stat(".dbn.out", &attr) != 0);
+
+    FT_ERROR_BELOW(5e-2);
+    TEST_ERROR_BELOW(0.3);
+}
+
+TEST_CASE("unit/processor/runtime/2", "[unit][dense][dbn][mnist][sgd][proc]") {
+    auto opt    = default_options();
+    opt.runtime = true;
+
+    // The runtime networks do not support Adagrad, so the network must be compiled
+    const char* cxx = std::getenv("CXX");
+    const std::string previous_cxx(cxx ? cxx : "");
+    unsetenv("CXX");
+
+    auto lines = get_result(opt, {"auto"}, "dense_sgd_3.conf");
+
+    if (cxx) {
+        setenv("CXX", previous_cxx.c_str(), 1);
+    }
+
+    REQUIRE(lines.empty());
+
+    // With a compiler, the network falls back to compilation
+    lines = get_result(opt, {"auto"}, "dense_sgd_3.conf");
+    REQUIRE(!lines.empty());
+
+    FT_ERROR_BELOW(0.2);
+}
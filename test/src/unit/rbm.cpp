@@ -212,3 +212,107 @@ TEST_CASE("unit/rbm/mnist/10", "[rbm][pcd][unit]") {
         REQUIRE(error < 15e-2);
     }
 }
+
+TEST_CASE("unit/rbm/mnist/11", "[rbm][batch][unit]") {
+    using rbm_t = dll::rbm_desc<
+        28 * 28, 100,
+        dll::batch_size<10>,
+        dll::momentum>::layer_t;
+
+    auto rbm = std::make_unique<rbm_t>();
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::dyn_vector<float>>(100);
+    REQUIRE(!dataset.training_images.empty());
+
+    mnist::binarize_dataset(dataset);
+
+    rbm->train(dataset.training_images, 5);
+
+    etl::fast_dyn_matrix<float, 10, 28 * 28> v;
+    etl::fast_dyn_matrix<float, 10, 100> h_a;
+    etl::fast_dyn_matrix<float, 10, 100> h_s;
+
+    for (size_t i = 0; i < 10; ++i) {
+        v(i) = dataset.training_images[i];
+    }
+
+    rbm->batch_activate_hidden(h_a, h_s, v, v);
+
+    // The fused batch activation must match the activation of each sample
+    for (size_t i = 0; i < 10; ++i) {
+        etl::fast_dyn_matrix<float, 100> h1_a;
+        etl::fast_dyn_matrix<float, 100> h1_s;
+
+        rbm->activate_hidden(h1_a, h1_s, dataset.training_images[i], dataset.training_images[i]);
+
+        REQUIRE(etl::approx_equals(h_a(i), h1_a, 1e-5));
+    }
+
+    // The samples must be binary
+    for (auto value : h_s) {
+        REQUIRE((value == 0.0f || value == 1.0f));
+    }
+
+    // The bias gradients must be the sums of the differences of each sample
+    dll::cd1_trainer_t<rbm_t> trainer(*rbm);
+
+    dll::compute_gradients_normal<false, 1>(v, v, *rbm, trainer);
+
+    etl::fast_dyn_matrix<float, 100> b_grad(0.0);
+    etl::fast_dyn_matrix<float, 28 * 28> c_grad(0.0);
+
+    for (size_t i = 0; i < 10; ++i) {
+        b_grad += trainer.h1_a(i) - trainer.h2_a(i);
+        c_grad += trainer.vf(i) - trainer.v2_a(i);
+    }
+
+    REQUIRE(etl::approx_equals(trainer.b_grad, b_grad, 1e-4));
+    REQUIRE(etl::approx_equals(trainer.c_grad, c_grad, 1e-4));
+}
+
+TEST_CASE("unit/rbm/mnist/12", "[rbm][energy][unit]") {
+    using rbm_t = dll::rbm_desc<
+        28 * 28, 100,
+        dll::batch_size<10>,
+        dll::momentum>::layer_t;
+
+    auto rbm = std::make_unique<rbm_t>();
+
+    auto dataset = mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 28 * 28>>(100);
+    REQUIRE(!dataset.training_images.empty());
+
+    mnist::binarize_dataset(dataset);
+
+    rbm->train(dataset.training_images, 5);
+
+    etl::fast_dyn_matrix<float, 8, 28 * 28> v;
+    etl::fast_dyn_matrix<float, 8, 100> h_a;
+    etl::fast_dyn_matrix<float, 8, 100> h_s;
+
+    for (size_t i = 0; i < 8; ++i) {
+        v(i) = dataset.training_images[i];
+    }
+
+    rbm->batch_activate_hidden(h_a, h_s, v, v);
+
+    etl::fast_dyn_matrix<float, 8> energies;
+    etl::fast_dyn_matrix<float, 8> free_energies;
+
+    rbm->batch_energy(v, h_s, energies);
+    rbm->batch_free_energy(v, free_energies);
+
+    float sum = 0.0;
+
+    // Each row must match the energies of the sample alone
+    for (size_t i = 0; i < 8; ++i) {
+        rbm_t::output_one_t h(100);
+        h = h_s(i);
+
+        REQUIRE(energies[i] == Approx(rbm->energy(dataset.training_images[i], h)).epsilon(1e-3));
+        REQUIRE(free_energies[i] == Approx(rbm->free_energy(dataset.training_images[i])).epsilon(1e-3));
+
+        sum += free_energies[i];
+    }
+
+    REQUIRE(rbm->batch_free_energy(v) == Approx(sum).epsilon(1e-3));
+}
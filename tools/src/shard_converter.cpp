@@ -0,0 +1,85 @@
+//=======================================================================
+// Copyright (c) 2014-2017 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file
+ * \brief Convert the standard datasets into packed shard files that can be
+ * read with the mmap_data_generator.
+ */
+
+#include <iostream>
+#include <string>
+
+#include "etl/etl.hpp"
+
+#include "dll/util/shard.hpp"
+
+#include "mnist/mnist_reader.hpp"
+#include "cifar/cifar10_reader.hpp"
+
+namespace {
+
+void usage() {
+    std::cout << "Usage: dll_shard [--float] mnist|cifar10 <output_prefix> [folder]" << std::endl;
+    std::cout << "    Writes <output_prefix>.train.shard and <output_prefix>.test.shard" << std::endl;
+}
+
+template <typename Dataset>
+bool write_dataset(const std::string& prefix, const Dataset& dataset, size_t classes, dll::shard_type type) {
+    std::cout << "Write " << dataset.training_images.size() << " training samples" << std::endl;
+
+    if (!dll::write_shard(prefix + ".train.shard", dataset.training_images, dataset.training_labels, classes, type)) {
+        return false;
+    }
+
+    std::cout << "Write " << dataset.test_images.size() << " test samples" << std::endl;
+
+    return dll::write_shard(prefix + ".test.shard", dataset.test_images, dataset.test_labels, classes, type);
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    auto type = dll::shard_type::UINT8;
+
+    if (!args.empty() && args[0] == "--float") {
+        type = dll::shard_type::FLOAT;
+        args.erase(args.begin());
+    }
+
+    if (args.size() < 2) {
+        usage();
+        return 1;
+    }
+
+    auto& name   = args[0];
+    auto& prefix = args[1];
+
+    bool result = false;
+
+    if (name == "mnist") {
+        auto dataset = args.size() > 2
+            ? mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 1, 28, 28>>(args[2])
+            : mnist::read_dataset_direct<std::vector, etl::fast_dyn_matrix<float, 1, 28, 28>>();
+
+        result = write_dataset(prefix, dataset, 10, type);
+    } else if (name == "cifar10") {
+        auto dataset = args.size() > 2
+            ? cifar::read_dataset_3d<std::vector, etl::fast_dyn_matrix<float, 3, 32, 32>>(args[2])
+            : cifar::read_dataset_3d<std::vector, etl::fast_dyn_matrix<float, 3, 32, 32>>();
+
+        result = write_dataset(prefix, dataset, 10, type);
+    } else {
+        std::cerr << "ERROR: Unknown dataset: " << name << std::endl;
+        usage();
+        return 1;
+    }
+
+    return result ? 0 : 1;
+}